@@ -0,0 +1,78 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 in Honnywell Rondostat HR20E / ATmega32 master
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       ota.h
+ * \brief      over the air firmware update, shared by slave, master and RF bootloader
+ *
+ * Slave application gets command 'U' with image id and size, it stores
+ * the request to EEPROM (block at OTA_EE_ADDR) and reboots to the
+ * bootloader; for the image it runs already it answers size 0xffff and
+ * stays. Bootloader pulls the image from master chunk by chunk:
+ *
+ *	boot frame: length, address | OTA_ADDR_FLAG, type, id, chunk (2), hold, data, CMAC
+ *
+ * Boot frames are not encrypted, CMAC is calculated like for sync packet
+ * (without RTC prefix), slave application ignores them by address flag.
+ * Chunk number size / OTA_CHUNK (rounded up) is trailer, first 4 bytes
+ * are CMAC of whole image. Bootloader starts application only when flash
+ * matches this CMAC.
+ */
+
+#pragma once
+
+#ifndef OTA
+#define OTA RFM
+#endif
+
+#define OTA_CHUNK 16            //!< image bytes in one OTA_DATA frame, fits one host command line
+#define OTA_PAGE 128            //!< flash page of ATmega169 (SPM_PAGESIZE)
+#define OTA_APP_MAX 0x3800      //!< application flash size, 2kB boot section above
+#define OTA_ADDR_FLAG 0x80      //!< address of boot frames
+
+// frame types
+#define OTA_REQ 'Q'             //!< bootloader -> master, request chunk
+#define OTA_DATA 'P'            //!< master -> bootloader, chunk follows header
+#define OTA_WAIT 'H'            //!< master -> bootloader, chunk not available or channel busy
+
+#define OTA_HDR 5               //!< type, id, chunk high, chunk low, hold
+#define OTA_HOLD_MAX 250        //!< hold time unit is 10ms, bootloader asks again after it
+
+// EEPROM block of update request, must be same in all firmware versions
+#define OTA_EE_ADDR 0x084       //!< part of former ee_reserved2_60, see src/eeprom.h
+#define OTA_EE_MAGIC 0          //!< OTA_MAGIC while update is requested or in progress
+#define OTA_EE_ID 1             //!< image id
+#define OTA_EE_SIZE_H 2         //!< image size in bytes
+#define OTA_EE_SIZE_L 3
+#define OTA_EE_PAGES 4          //!< pages written to flash, resume point after reset
+#define OTA_PAGES_RESTART 0xff  //!< OTA_EE_PAGES value: image verification failed, application is not intact
+#define OTA_EE_DEVADDR 5        //!< copy of config.RFM_devaddr
+#define OTA_EE_RATE 6           //!< copy of config.RFM_rate
+#define OTA_EE_FREQ 7           //!< copy of config.RFM_freqAdjust, 0 without RFM_TUNING
+#define OTA_EE_KEY 8            //!< copy of config.security_key[8]
+#define OTA_EE_LEN 16
+#define OTA_MAGIC 0xb7
+
+#define OTA_CHUNKS(size) (((size) + OTA_CHUNK - 1) / OTA_CHUNK)
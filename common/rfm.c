@@ -47,6 +47,15 @@ uint8_t rfm_framebuf[RFM_FRAME_MAX];
 uint8_t rfm_framesize = 6;
 uint8_t rfm_framepos = 0;
 rfm_mode_t rfm_mode = rfmmode_stop;
+uint8_t rfm_rate = RFM_RATE_DEFAULT;
+
+// data rate, receiver bandwidth and TX deviation for each RFM_RATE_xxx
+static const uint16_t rfm_rate_table[RFM_RATE_COUNT][3] PROGMEM = {
+	{ RFM_SET_DATARATE(9600), RFM_RX_CONTROL_BW(9600), RFM_TX_CONTROL_MOD(9600) },
+	{ RFM_SET_DATARATE(19200), RFM_RX_CONTROL_BW(19200), RFM_TX_CONTROL_MOD(19200) },
+	{ RFM_SET_DATARATE(38400), RFM_RX_CONTROL_BW(38400), RFM_TX_CONTROL_MOD(38400) },
+	{ RFM_SET_DATARATE(57600), RFM_RX_CONTROL_BW(57600), RFM_TX_CONTROL_MOD(57600) }
+};
 
 /*!
  *******************************************************************************
@@ -56,6 +65,38 @@ rfm_mode_t rfm_mode = rfmmode_stop;
  *  \returns the value that is clocked in from the RFM
  *
  ******************************************************************************/
+#if (SOFT_MASTER == 1) && (RFM_HW_SPI != 1)
+// soft master provides rfm_spi16 for selected radio backend
+#elif (RFM_HW_SPI == 1)
+static uint8_t rfm_spi8(uint8_t outval)
+{
+	SPDR = outval;
+	while (!(SPSR & _BV(SPIF)))
+	{
+		;
+	}
+	return SPDR;
+}
+
+uint16_t rfm_spi16(uint16_t outval)
+{
+	uint16_t ret;
+
+	RFM_SPI_SELECT;
+	if ((outval & 0xff00) == 0xb000) // receiver FIFO read
+	{
+		RFM_SPI_CLK_SLOW();
+	}
+	ret = (uint16_t)rfm_spi8(outval >> 8) << 8;
+	ret |= rfm_spi8(outval & 0xff);
+	RFM_SPI_CLK_FAST();
+
+	RFM_SPI_DESELECT;
+	RFM_SPI_SELECT;
+
+	return ret;
+}
+#else
 uint16_t rfm_spi16(uint16_t outval)
 {
 	uint8_t i;
@@ -92,6 +133,7 @@ uint16_t rfm_spi16(uint16_t outval)
 
 	return ret;
 }
+#endif // (SOFT_MASTER == 1) && (RFM_HW_SPI != 1)
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -102,7 +144,9 @@ uint16_t rfm_spi16(uint16_t outval)
 
 void RFM_init(void)
 {
-#if (NANODE == 1 || JEENODE == 1)
+#if (RFM_HW_SPI == 1)
+	RFM_SPI_CLK_FAST();
+#elif (NANODE == 1 || JEENODE == 1)
 	// disable SPI
 	SPCR &= ~(1 << SPE);
 #endif
@@ -137,16 +181,8 @@ void RFM_init(void)
 	);
 
 	// 4. Data Rate Command
-	RFM_SPI_16(RFM_SET_DATARATE(RFM_BAUD_RATE));
-
 	// 5. Receiver Control Command
-	RFM_SPI_16(
-		RFM_RX_CONTROL_P20_VDI  |
-		RFM_RX_CONTROL_VDI_MED |
-		RFM_RX_CONTROL_BW(RFM_BAUD_RATE) |
-		RFM_RX_CONTROL_GAIN_6   |
-		RFM_RX_CONTROL_RSSI_103
-	);
+	RFM_set_rate(config.RFM_rate);
 
 	// 6. Data Filter Command
 	RFM_SPI_16(
@@ -172,11 +208,7 @@ void RFM_init(void)
 		RFM_AFC_FI
 	);
 
-	// 11. TX Configuration Control Command
-	RFM_SPI_16(
-		RFM_TX_CONTROL_MOD(RFM_BAUD_RATE) |
-		RFM_TX_CONTROL_POW_0
-	);
+	// 11. TX Configuration Control Command (in RFM_set_rate)
 
 	// 12. PLL Setting Command
 	RFM_SPI_16(
@@ -206,6 +238,39 @@ void RFM_init(void)
 	// 17. Status Read Command
 }
 
+/*!
+ *******************************************************************************
+ *  set data rate and the rate dependent receiver and transmitter settings
+ *
+ *  \param rate RFM_RATE_xxx, invalid value selects RFM_RATE_DEFAULT
+ ******************************************************************************/
+void RFM_set_rate(uint8_t rate)
+{
+	if (rate >= RFM_RATE_COUNT)
+	{
+		rate = RFM_RATE_DEFAULT;
+	}
+	rfm_rate = rate;
+
+	// 4. Data Rate Command
+	RFM_SPI_16(pgm_read_word(&rfm_rate_table[rate][0]));
+
+	// 5. Receiver Control Command
+	RFM_SPI_16(
+		RFM_RX_CONTROL_P20_VDI  |
+		RFM_RX_CONTROL_VDI_MED |
+		pgm_read_word(&rfm_rate_table[rate][1]) |
+		RFM_RX_CONTROL_GAIN_6   |
+		RFM_RX_CONTROL_RSSI_103
+	);
+
+	// 11. TX Configuration Control Command
+	RFM_SPI_16(
+		pgm_read_word(&rfm_rate_table[rate][2]) |
+		RFM_TX_CONTROL_POW_0
+	);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /*!
@@ -273,8 +338,13 @@ ISR(RFM_INT_vect)
 #endif
 		RFM_INT_DIS();                          // disable RFM interrupt
 		sei();                                  // enable global interrupts
-#if (JEENODE == 0)
-		uint16_t status = RFM_READ_STATUS();    // this also clears most interrupt sources
+		// SDO shows only FFIT/RGIT, status is read only for AFC
+#if (JEENODE == 0) && (RFM_TUNING > 0)
+		uint16_t status = 0;
+		if ((rfm_mode == rfmmode_rx) && (rfm_framepos == 5))
+		{
+			status = RFM_READ_STATUS();
+		}
 #endif
 		if (rfm_mode == rfmmode_tx)
 		{
@@ -236,6 +236,23 @@
 // Using this formula as specified in the datasheet results in a slightly inflated data rate due to rounding. Original: #define RFM_SET_DATARATE_ORIG(baud)		( ((baud)<5400) ? (RFM_DATA_RATE_CS|((43104/(baud))-1)) : (RFM_DATA_RATE|((344828UL/(baud))-1)) )
 #define RFM_SET_DATARATE(baud)          (((baud) < 4800) ? (RFM_DATA_RATE_CS | ((43104 / (baud)))) : (RFM_DATA_RATE | ((344828UL / (baud)))))
 
+// data rate index used in EEPROM config and rate negotiation
+#define RFM_RATE_9600           0
+#define RFM_RATE_19200          1
+#define RFM_RATE_38400          2
+#define RFM_RATE_57600          3
+#define RFM_RATE_COUNT          4
+
+#if (RFM_BAUD_RATE >= 57600)
+#define RFM_RATE_DEFAULT        RFM_RATE_57600
+#elif (RFM_BAUD_RATE >= 38400)
+#define RFM_RATE_DEFAULT        RFM_RATE_38400
+#elif (RFM_BAUD_RATE >= 19200)
+#define RFM_RATE_DEFAULT        RFM_RATE_19200
+#else
+#define RFM_RATE_DEFAULT        RFM_RATE_9600
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // 5. Receiver Control Command
@@ -500,7 +517,9 @@
 
 #include <stdint.h>
 void RFM_init(void);
+void RFM_set_rate(uint8_t rate);
 uint16_t rfm_spi16(uint16_t outval);
+extern uint8_t rfm_rate;
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -46,6 +46,13 @@
 /* The following must be AFTER the last include line */
 #ifdef COM_UART
 
+// divisor for U2X mode rounded to nearest value
+#define UART_UBRR ((F_CPU + COM_BAUD_RATE * 4L) / (COM_BAUD_RATE * 8L) - 1)
+#define UART_BAUD_REAL (F_CPU / (8L * (UART_UBRR + 1)))
+#if ((UART_BAUD_REAL * 1000 / COM_BAUD_RATE) < 975) || ((UART_BAUD_REAL * 1000 / COM_BAUD_RATE) > 1025)
+#error "COM_BAUD_RATE can't be generated from F_CPU with error below 2.5%"
+#endif
+
 #if defined (_AVR_IOM169_H_) || defined (_AVR_IOM32_H_)
 #define UDR0 UDR
 #define RXEN0 RXEN
@@ -145,7 +152,7 @@ ISR(USART_TX_vect)
 void UART_init(void)
 {
 	// Baudrate
-	uint16_t ubrr_val = ((F_CPU) / (COM_BAUD_RATE * 8L) - 1);
+	uint16_t ubrr_val = UART_UBRR;
 
 	UCSR0A = _BV(U2X0);
 	UBRR0H = (unsigned char)(ubrr_val >> 8);
@@ -39,10 +39,12 @@
 #include "eeprom.h"
 #include "wireless.h"
 #include "cmac.h"
+#include "ota.h"
 #include "com.h"
 #include "debug.h"
 #if defined(MASTER_CONFIG_H)
 #include "queue.h"
+#include "relay.h"
 #else
 #include "controller.h"
 #include "task.h"
@@ -79,6 +81,26 @@ static void wirelessSendPacket(void);
 static void wirelessSendPacket(bool cpy);
 #endif
 
+#if !defined(__AVR__)
+/*!
+ *******************************************************************************
+ *  C version of left_roll for non AVR targets (soft master)
+ *  \note rotate 64 bit little endian value left by one bit
+ ******************************************************************************/
+static void left_roll(uint8_t *dst, const uint8_t *src)
+{
+	uint8_t i;
+	uint8_t c = src[7] >> 7;
+
+	for (i = 0; i < 8; i++)
+	{
+		uint8_t t = src[i];
+		dst[i] = (t << 1) | c;
+		c = t >> 7;
+	}
+}
+#endif
+
 
 /*!
  *******************************************************************************
@@ -102,6 +124,7 @@ void crypto_init(void)
 		K1[i] = 0;
 	}
 	xtea_enc(K1, K1, K_mac);
+#if defined(__AVR__)
 	asm (
 		"   movw  R30,%A0   \n"
 		"   rcall left_roll \n" /* generate K1 */
@@ -111,11 +134,16 @@ void crypto_init(void)
 		:: "y" (K1)
 		: "r26", "r27", "r30", "r31"
 	);
+#else
+	left_roll(K1, K1); /* generate K1 */
+	left_roll(K2, K1); /* generate K2 */
+#endif
 #if defined(MASTER_CONFIG_H)
 	LED_RX_off();
 	LED_sync_off();
 #endif
 }
+#if defined(__AVR__)
 /* internal function for crypto_init */
 /* use loop inside - short/slow */
 asm (
@@ -137,6 +165,7 @@ asm (
 	"   sbiw r28,8            \n"   // Y-=8
 	"   ret "
 );
+#endif
 
 /*!
  *******************************************************************************
@@ -194,6 +223,63 @@ void wirelessSendDone(void)
 #endif
 }
 
+#if (WL_LBT)
+uint8_t wl_lbt_busy = 0;        //!< busy channel detections (wrap around)
+static uint8_t wl_lbt_tries = 0;        //!< back-offs of current packet
+static uint8_t wl_lbt_rnd = 0;          //!< back-off random generator state
+#if defined(MASTER_CONFIG_H)
+static bool wl_lbt_sync = false;        //!< sync packet waits for free channel
+#endif
+
+/*!
+ *******************************************************************************
+ *  listen before talk
+ *
+ *  \note receiver must be on (slave turns it on on first call), RFM interrupt disabled
+ *  \note returns true when channel is busy and timer is set to try it again
+ ******************************************************************************/
+static bool wireless_lbt_busy(void)
+{
+#if defined(MASTER_CONFIG_H)
+	if ((wl_lbt_tries < WL_LBT_TRIES)
+	    && (RFM_READ_STATUS() & (RFM_STATUS_RSSI | RFM_STATUS_DQD)))
+	{
+		wl_lbt_tries++;
+		wl_lbt_busy++;
+		wl_lbt_rnd = wl_lbt_rnd * 109 + 89 + RTC_s100;
+		RTC_timer_set(RTC_TIMER_RFM2, (uint8_t)(RTC_s100 + 1 + (wl_lbt_rnd % WLTIME_LBT_BACKOFF)));
+		return true;
+	}
+#else
+	uint8_t t = 0;
+	if (wl_lbt_tries == 0)
+	{
+		RFM_RX_ON(); // RSSI and DQD are valid only in receive mode
+		t = WLTIME_LBT_SETTLE;
+	}
+	else if ((wl_lbt_tries <= WL_LBT_TRIES)
+		 && (RFM_READ_STATUS() & (RFM_STATUS_RSSI | RFM_STATUS_DQD)))
+	{
+		wl_lbt_busy++;
+		wl_lbt_rnd = wl_lbt_rnd * 109 + 89 + config.RFM_devaddr;
+		t = 1 + (wl_lbt_rnd % WLTIME_LBT_BACKOFF);
+	}
+	if (t != 0)
+	{
+		wl_lbt_tries++;
+		while (ASSR & (_BV(TCR2UB)))
+		{
+			;
+		}
+		RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s256 + t));
+		return true;
+	}
+#endif
+	wl_lbt_tries = 0;
+	return false;
+}
+#endif
+
 /*!
  *******************************************************************************
  *  wireless Timer
@@ -205,6 +291,12 @@ void wirelessTimer(void)
 	switch (wirelessTimerCase)
 	{
 	case WL_TIMER_FIRST:
+#if (WL_LBT)
+		if (wireless_lbt_busy())
+		{
+			return; // timer case stay WL_TIMER_FIRST
+		}
+#endif
 		wirelessSendPacket(true);
 		break;
 	case WL_TIMER_SYNC:
@@ -244,6 +336,13 @@ void wirelessTimer(void)
 
 void wirelessTimer2(void)
 {
+#if (WL_LBT)
+	if (wl_lbt_sync)
+	{
+		wirelessSendSync(); // back-off is over
+		return;
+	}
+#endif
 	LED_sync_off();
 }
 #endif
@@ -307,13 +406,100 @@ static void wirelessSendPacket(bool cpy)
 uint8_t wl_force_addr1;
 uint8_t wl_force_addr2;
 uint32_t wl_force_flags;
+#if (WL_SHARES)
+uint8_t wl_shares[2 * WL_SHARE_N];      //!< address, seconds in second half-minute
+
+/*!
+ *******************************************************************************
+ *  seconds of addr by wl_shares, bit n is second 30+n
+ *
+ *  \note smooth weighted round robin, seconds of one address are spread
+ ******************************************************************************/
+uint32_t wl_share_mask(uint8_t addr)
+{
+	int8_t credit[WL_SHARE_N];
+	uint8_t total = 0;
+	uint8_t i, n;
+	uint32_t mask = 0;
+
+	for (i = 0; i < WL_SHARE_N; i++)
+	{
+		credit[i] = 0;
+		total += wl_shares[2 * i + 1];
+	}
+	for (n = 1; (n <= total) && (n < 30); n++)
+	{
+		uint8_t best = 0;
+		for (i = 0; i < WL_SHARE_N; i++)
+		{
+			credit[i] += wl_shares[2 * i + 1];
+			if (credit[i] > credit[best])
+			{
+				best = i;
+			}
+		}
+		credit[best] -= total;
+		if (wl_shares[2 * best] == addr)
+		{
+			mask |= (uint32_t)1 << n;
+		}
+	}
+	return mask;
+}
+#endif
+#if (WL_GROUP_CMD)
+#if defined(MASTER_CONFIG_H)
+uint32_t wl_group_mask;         //!< addresses for group command
+uint8_t wl_group_cmd[3];        //!< sequence, command, argument
+uint8_t wl_group_repeat;        //!< sync packets to carry group command
+#else
+uint8_t wl_group_seq;           //!< sequence of last applied group command, 0 = none
+#endif
+#endif
+
+#if defined(MASTER_CONFIG_H) && (OTA == 1)
+/*!
+ *******************************************************************************
+ *  wireless send boot frame to slave in RF bootloader
+ *
+ *  \note data are not encrypted, CMAC without prefix like sync packet
+ ******************************************************************************/
+void wirelessSendBoot(uint8_t addr)
+{
+	RFM_INT_DIS();
+	RFM_TX_ON_PRE();
+	memcpy_P(rfm_framebuf, wl_header, 4);
+	rfm_framebuf[5] = addr;
+	memcpy(rfm_framebuf + 6, wireless_framebuf, wireless_buf_ptr);
+	rfm_framesize = wireless_buf_ptr + 2 + 4;
+	rfm_framebuf[4] = rfm_framesize; // length
+	cmac_calc(rfm_framebuf + 5, rfm_framesize - 5, NULL, false);
+	rfm_framesize += 4 + 2; //4 MAC + 2 dummy
+
+	rfm_framepos = 0;
+	rfm_mode = rfmmode_tx;
+	RFM_TX_ON();
+	RFM_SPI_SELECT; // set nSEL low: from this moment SDO indicate FFIT or RGIT
+	RFM_INT_EN();   // enable RFM interrupt
+}
+#endif
 
 #if defined(MASTER_CONFIG_H)
 void wirelessSendSync(void)
 {
+	RFM_INT_DIS();
+#if (WL_LBT)
+	wl_lbt_sync = wireless_lbt_busy();
+	if (wl_lbt_sync)
+	{
+		// keep FIFO drained during back-off, frames received now are dropped
+		rfm_mode = rfmmode_rx_owf;
+		RFM_INT_EN();   // enable RFM interrupt
+		return; // wirelessTimer2 calls it again
+	}
+#endif
 	LED_sync_on();
 	RTC_timer_set(RTC_TIMER_RFM2, (uint8_t)(RTC_s100 + WLTIME_LED_TIMEOUT));
-	RFM_INT_DIS();
 	RFM_TX_ON_PRE();
 	memcpy_P(rfm_framebuf, wl_header, 4);
 
@@ -334,12 +520,62 @@ void wirelessSendSync(void)
 	RFM_INT_EN();   // enable RFM interrupt
 }
 
-uint8_t wl_packet_bank = 0;
 #else
 int8_t time_sync_tmo = 0;
 #if (WL_SKIP_SYNC)
 uint8_t wl_skip_sync = 0;
 #endif
+
+#if (WL_RATE)
+static uint8_t wl_rate_next = 0xff;     //!< announced data rate change (group command argument), 0xff = none
+
+/*!
+ *******************************************************************************
+ *  schedule data rate change announced by master
+ ******************************************************************************/
+void wirelessRateSchedule(uint8_t arg)
+{
+	wl_rate_next = arg;
+}
+
+/*!
+ *******************************************************************************
+ *  switch data rate before sync packet of announced minute
+ *
+ *  \note call it on second 59, announcement older than few minutes is dropped
+ ******************************************************************************/
+void wirelessRateCheck(void)
+{
+	uint8_t m;
+
+	if (wl_rate_next == 0xff)
+	{
+		return;
+	}
+	m = ((wl_rate_next >> 2) + 59 - RTC_GetMinute()) % 60;
+	if (m == 0)
+	{
+		RFM_set_rate(wl_rate_next & (RFM_RATE_COUNT - 1));
+	}
+	if (m == 0 || m > 4)
+	{
+		wl_rate_next = 0xff;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  keep data rate of received sync packet for next power on
+ ******************************************************************************/
+static void wireless_rate_store(void)
+{
+	if (config.RFM_rate != rfm_rate)
+	{
+		config.RFM_rate = rfm_rate;
+		eeprom_config_save((uint8_t)(&config.RFM_rate - config_raw));
+	}
+}
+#endif
 #endif
 
 #if DEBUG_PRINT_ADDITIONAL_TIMESTAMPS
@@ -388,6 +624,21 @@ void wirelessReceivePacket(void)
 
 			{
 				bool mac_ok;
+#if defined(MASTER_CONFIG_H) && (OTA == 1)
+				if ((rfm_framebuf[1] & OTA_ADDR_FLAG) == OTA_ADDR_FLAG)
+				{
+					// slave in RF bootloader, no encryption and no RTC prefix
+					mac_ok = cmac_calc(rfm_framebuf + 1, rfm_framepos - 1 - 4, NULL, true);
+					if (mac_ok && OTA_packet(rfm_framebuf + 1, rfm_framepos - 1 - 4))
+					{
+						LED_RX_on();
+						RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s100 + WLTIME_LED_TIMEOUT));
+						wirelessSendBoot(rfm_framebuf[1]);
+						return;
+					}
+				}
+				else
+#endif
 #if !defined(MASTER_CONFIG_H)
 				if ((rfm_framebuf[0] & 0x80) == 0x80)
 				{
@@ -400,17 +651,39 @@ void wirelessReceivePacket(void)
 						RFM_OFF();
 						RTC_timer_destroy(WL_TIMER_RX_TMO);
 
-						if (rfm_framebuf[0] == 0x8b)
+						uint8_t sync_len = rfm_framebuf[0];
+#if (WL_GROUP_CMD)
+						uint8_t *group = NULL;
+						if (sync_len >= 0x89 + WL_GROUP_SIZE)
+						{
+							sync_len -= WL_GROUP_SIZE;
+							group = rfm_framebuf + (sync_len & 0x7f) - 4;
+						}
+						else
+						{
+							wl_group_seq = 0; // repeating is over, next sequence can be the same
+						}
+#endif
+						if (sync_len == 0x8b)
 						{
 							wl_force_addr1 = rfm_framebuf[5];
 							wl_force_addr2 = rfm_framebuf[6];
 						}
-						else if (rfm_framebuf[0] == 0x8d)
+						else if (sync_len == 0x8d)
 						{
 							wl_force_addr1 = 0xff;
 							// wl_force_addr2=0xff;
 							memcpy(&wl_force_flags, rfm_framebuf + 5, 4);
 						}
+#if (WL_SHARES)
+						else if (sync_len == 0x89 + 2 * WL_SHARE_N)
+						{
+							wl_force_addr1 = WL_FORCE_SHARES;
+							wl_force_addr2 = 0;
+							memcpy(wl_shares, rfm_framebuf + 5, 2 * WL_SHARE_N);
+							wl_force_flags = wl_share_mask(config.RFM_devaddr);
+						}
+#endif
 						else
 						{
 #if (WL_SKIP_SYNC)
@@ -445,6 +718,9 @@ void wirelessReceivePacket(void)
 							// ATmega169 datasheet chapter 17.8.1
 						}
 						CTL_clear_error(CTL_ERR_RFM_SYNC);
+#if (WL_RATE)
+						wireless_rate_store();
+#endif
 						RTC_SetYear(rfm_framebuf[1]);
 						RTC_SetMonth(rfm_framebuf[2] >> 4);
 						RTC_SetDay((rfm_framebuf[3] >> 5) + ((rfm_framebuf[2] << 3) & 0x18));
@@ -452,6 +728,18 @@ void wirelessReceivePacket(void)
 						RTC_SetMinute(rfm_framebuf[4] >> 1);
 						RTC_SetSecond((rfm_framebuf[4] & 1) ? 30 : 00);
 						cli(); RTC_timer_done &= ~_BV(RTC_TIMER_RTC); sei(); // do not add one second
+#if (WL_GROUP_CMD)
+						if ((group != NULL) && (group[4] != wl_group_seq))
+						{
+							uint32_t mask;
+							memcpy(&mask, group, 4);
+							if ((mask >> config.RFM_devaddr) & 1)
+							{
+								wl_group_seq = group[4];
+								COM_wireless_group_command(group[5], group[6]);
+							}
+						}
+#endif
 						return;
 					}
 				}
@@ -471,16 +759,21 @@ void wirelessReceivePacket(void)
 						LED_RX_on();
 						RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s100 + WLTIME_LED_TIMEOUT));
 						q_item_t *p;
-						uint8_t skip = 0;
+						uint8_t weight = 0;
 						uint8_t i = 0;
-						while ((p = Q_get(addr, wl_packet_bank, skip++)) != NULL)
+						Q_retry(addr);
+						while ((p = Q_get(addr, &weight)) != NULL)
 						{
+							if ((*p).tag != 0)
+							{
+								wireless_putchar('#'); // slave echoes tag, see COM_wireless_command_parse
+								wireless_putchar((*p).tag);
+							}
 							for (i = 0; i < (*p).len; i++)
 							{
 								wireless_putchar((*p).data[i]);
 							}
 						}
-						wl_packet_bank++;
 						wirelessSendPacket();
 						return;
 					}
@@ -534,8 +827,15 @@ void wirelesTimeSyncCheck(void)
 	{
 		if ((time_sync_tmo == 0) || (time_sync_tmo < -30))
 		{
-			time_sync_tmo = 0;
 			RFM_INT_DIS();
+#if (WL_RATE)
+			if (time_sync_tmo != 0)
+			{
+				// repeated search, network can use other data rate
+				RFM_set_rate((rfm_rate + 1) % RFM_RATE_COUNT);
+			}
+#endif
+			time_sync_tmo = 0;
 			RFM_FIFO_OFF();
 			RFM_FIFO_ON();
 			RFM_RX_ON(); //re-enable RX
@@ -44,7 +44,7 @@ void crypto_init(void);
 void wirelessReceivePacket(void);
 #if defined(MASTER_CONFIG_H)
 void wirelessSendSync(void);
-extern uint8_t wl_packet_bank;
+void wirelessSendBoot(uint8_t addr);
 void wirelessTimer2(void);
 #else
 extern bool wireless_async;
@@ -66,6 +66,53 @@ extern uint8_t wl_force_addr1;
 extern uint8_t wl_force_addr2;
 extern uint32_t wl_force_flags;
 
+/* group command in sync packet: 4 bytes address mask, sequence, command, argument
+ * it is appended after force data, slaves recognize it by packet length
+ */
+#ifndef WL_GROUP_CMD
+#define WL_GROUP_CMD 1
+#endif
+#define WL_GROUP_SIZE 7
+#define WL_GROUP_REPEAT 4       // master: number of sync packets with the same group command
+#if (WL_GROUP_CMD)
+#if defined(MASTER_CONFIG_H)
+extern uint32_t wl_group_mask;
+extern uint8_t wl_group_cmd[3];
+extern uint8_t wl_group_repeat;
+#else
+extern uint8_t wl_group_seq;
+#endif
+#endif
+
+/* shared slots: force data of sync packet are WL_SHARE_N pairs address, seconds;
+ * seconds 31..59 are dealt to them by smooth weighted round robin, master and
+ * slaves compute the same plan by wl_share_mask; force data must stay shorter
+ * than WL_GROUP_SIZE, group command is recognized by packet length
+ */
+#ifndef WL_SHARES
+#define WL_SHARES 1
+#endif
+#define WL_SHARE_N 3
+#define WL_FORCE_SHARES 0xfd    // wl_force_addr1 of shared slots
+#if (WL_SHARES)
+extern uint8_t wl_shares[2 * WL_SHARE_N];
+uint32_t wl_share_mask(uint8_t addr);
+#endif
+
+/* data rate change is a group command, argument is minute of switch << 2 | RFM_RATE_xxx
+ * master and slaves switch just before sync packet of this minute; slave without
+ * sync tries next data rate on each new search for sync packet
+ */
+#ifndef WL_RATE
+#define WL_RATE WL_GROUP_CMD
+#endif
+#define WL_RATE_CMD 'R'
+#define WL_RATE_ARG(minute, rate) (((minute) << 2) | (rate))
+#if (WL_RATE) && !defined(MASTER_CONFIG_H)
+void wirelessRateSchedule(uint8_t arg);
+void wirelessRateCheck(void);
+#endif
+
 #if !defined(MASTER_CONFIG_H)
 #define WLTIME_SYNC (0xfa)                              // prepare to receive timesync / slave only
 #define WLTIME_START (RTC_TIMER_CALC(200))              // communication start
@@ -81,6 +128,24 @@ extern uint32_t wl_force_flags;
 #define WL_SKIP_SYNC 3
 extern uint8_t wl_skip_sync;
 
+/* listen before talk: slave time slot start and master sync packet are
+ * postponed by random back-off while RSSI or DQD shows busy channel,
+ * after WL_LBT_TRIES back-offs packet is send anyway (it is our time slot)
+ */
+#ifndef WL_LBT
+#define WL_LBT 1
+#endif
+#define WL_LBT_TRIES 3
+#if defined(MASTER_CONFIG_H)
+#define WLTIME_LBT_BACKOFF 2    // maximum back-off in timer ticks (10 ms)
+#else
+#define WLTIME_LBT_BACKOFF 4    // maximum back-off in timer ticks (1/256 s)
+#define WLTIME_LBT_SETTLE 1     // receiver start-up before first check
+#endif
+#if (WL_LBT)
+extern uint8_t wl_lbt_busy;
+#endif
+
 #if !defined(MASTER_CONFIG_H)
 typedef enum
 {
@@ -3,6 +3,21 @@
 // config part
 $RRD_HOME="/tmp/openhr20/";
 $TIMEZONE="Europe/Warsaw";
+$QUEUE_REPUSH=240; // master keeps commands until ack/expiry, push same command again after (s)
+$SERIAL="/dev/ttyUSB0";
+$SERIAL_STTY=""; // e.g. "115200 ixon" to match master COM_BAUD_RATE and honor its XON/XOFF
+$MASTERS=array(); // several masters: port => address base, e.g. array("/dev/ttyUSB0"=>0,"/dev/ttyUSB1"=>32), slave aa of master is base+aa in database; empty is $SERIAL with base 0
+$MASTER_PHASE=25; // 1/100 s, clock offset between masters, sync packets of neighbouring masters don't overlap
+$DB_BATCH=1; // s, database writes are committed when all ports are idle, at latest after it
+$LINK_QUALITY_MIN=70; // % of good packets in forced slots, below it interactive commands get whole half-minute
+$AFC_TRIM_LIMIT=3; // mean AFC steps, above it device is reported for RFM_freqAdjust trim
+$SECURITY_KEY="0123456789abcdef"; // SECURITY_KEY_0..7 of firmware build (default of src/Makefile), image CMAC for RF bootloader, "" = no rollout
+$OTA_TIMEOUT=3600; // s, firmware update without progress is failed, next one in table ota starts
+$ALERT_NO_EFFECT=3; // h, valve open at least 70% below wanted temperature without warming is stuck valve
+$ALERT_FLAT=12; // h, same temperature reading is stuck sensor
+$ALERT_DRIFT=0.5; // C/h, mean deviation from learned temperature response
+$ALERT_BAT_DAYS=30; // days, battery forecast reaching bat_low_thld earlier is reported
+$METRICS="tcp://127.0.0.1:9520"; // Prometheus text format on http://127.0.0.1:9520/metrics from memory, "" = off
 
 // NOTE: this file is hudge dirty hack, will be rewriteln
 echo "OpenHR20 PHP Daemon\n";
@@ -16,123 +31,708 @@ function weights($char) {
         'W' => 4,
         'G' => 2,
         'R' => 2,
-	'T' => 2
+	'T' => 2,
+	'U' => 4
     );
     if (isset($weights_table[$char]))
         return $weights_table[$char];
     else 
         return 10;
 }
-function sendRTC($fp) {
-        list($usec, $sec) = explode(" ", microtime());
+function linkStats($db,$addr,$data) {
+        // "C tAAAA pPP eEE xXX fFF:LL:HH -..." counters wrap at 256, window is delta to previous dump
+        global $AFC_TRIM_LIMIT,$linkQuality;
+        if (!preg_match('/ p([0-9a-f]{2}) e([0-9a-f]{2}) x([0-9a-f]{2}) f([0-9a-f]{2}):([0-9a-f]{2}):([0-9a-f]{2})/',$data,$m)) return;
+        $ok=hexdec($m[1]); $err=hexdec($m[2]); $missed=hexdec($m[3]);
+        $afc=array();
+        for ($i=4;$i<=6;$i++) $afc[$i]=(hexdec($m[$i])^0x80)-0x80;
+        $prev = $db->querySingle("SELECT * FROM link_stats WHERE addr=$addr",true);
+        if (empty($prev)) {
+            $prev = array('ok'=>0,'err'=>0,'missed'=>0,'raw_ok'=>0,'raw_err'=>0,'raw_missed'=>0,'quality'=>100);
+            $db->query("INSERT INTO link_stats (addr) VALUES ($addr)");
+        }
+        $d_ok=($ok-$prev['raw_ok'])&0xff;
+        $d_err=($err-$prev['raw_err'])&0xff;
+        $d_missed=($missed-$prev['raw_missed'])&0xff;
+        $n=$d_ok+$d_err+$d_missed;
+        $quality = ($n>=3) ? (int)(100*$d_ok/$n) : (int)$prev['quality'];
+        $linkQuality[$addr] = $quality;
+        $trim = (int)round($db->querySingle("SELECT total(afc*count)/total(count) FROM afc_hist WHERE addr=$addr"));
+        if (abs($trim)<$AFC_TRIM_LIMIT) $trim=0;
+        else echo " addr $addr needs RFM_freqAdjust trim by $trim\n";
+        $db->query("UPDATE link_stats SET time=".time().",ok=".($prev['ok']+$d_ok).",err=".($prev['err']+$d_err)
+            .",missed=".($prev['missed']+$d_missed).",raw_ok=$ok,raw_err=$err,raw_missed=$missed,quality=$quality"
+            .",afc=".$afc[4].",afc_min=".$afc[5].",afc_max=".$afc[6].",freq_trim=$trim WHERE addr=$addr");
+}
+function xteaEnc($v,$k) {
+        // same as common/xtea-asm.S, little endian words
+        $a=unpack('V2',$v); $v0=$a[1]; $v1=$a[2];
+        $key=array_values(unpack('V4',$k));
+        $sum=0;
+        for ($i=0;$i<32;$i++) {
+            $v0=($v0+(((($v1<<4)^($v1>>5))+$v1)^($sum+$key[$sum&3])))&0xffffffff;
+            $sum=($sum+0x9e3779b9)&0xffffffff;
+            $v1=($v1+(((($v0<<4)^($v0>>5))+$v0)^($sum+$key[($sum>>11)&3])))&0xffffffff;
+        }
+        return pack('V2',$v0,$v1);
+}
+function leftRoll($s) {
+        $c=ord($s[7])>>7; $o='';
+        for ($i=0;$i<8;$i++) { $t=ord($s[$i]); $o.=chr((($t<<1)|$c)&0xff); $c=$t>>7; }
+        return $o;
+}
+function otaMac($m) {
+        // CMAC without prefix, keys as crypto_init in common/wireless.c
+        global $SECURITY_KEY;
+        $km=pack('H*',$SECURITY_KEY."0123456789abcdef");
+        $k=''; for ($i=0;$i<16;$i++) $k.=chr(0xc0+$i);
+        $kmac=xteaEnc(substr($k,0,8),$km).xteaEnc(substr($k,8,8),$km);
+        $k1=leftRoll(xteaEnc(str_repeat("\0",8),$kmac));
+        $k2=leftRoll($k1);
+        $n=strlen($m); $buf=str_repeat("\0",8);
+        for ($i=0;$i<$n;) {
+            $x=$i; $i+=8;
+            for ($j=0;$j<8;$j++,$x++) {
+                $t = ($x<$n) ? ord($m[$x]) : (($x==$n) ? 0x80 : 0);
+                if ($i>=$n) $t ^= ord(($i==$n) ? $k1[$j] : $k2[$j]);
+                $buf[$j]=chr(ord($buf[$j])^$t);
+            }
+            $buf=xteaEnc($buf,$kmac);
+        }
+        return substr($buf,0,4);
+}
+function otaUnqueue($addr) {
+        // 'U' left 'req' state, slave must not get it again after reboot
+        global $queue;
+        if (empty($queue[$addr])) return;
+        for ($i=count($queue[$addr])-1;$i>=0;$i--) if ($queue[$addr][$i]['data']{0}=='U') queueDel($addr,$i);
+}
+function otaRollout($db) {
+        // one slave at time, command 'U' reboots it to RF bootloader, see common/ota.h
+        global $OTA_TIMEOUT,$SECURITY_KEY;
+        $result = $db->query("SELECT addr FROM ota WHERE state='req' AND time<".(time()-$OTA_TIMEOUT));
+        while ($row = $result->fetchArray(SQLITE3_ASSOC)) otaUnqueue($row['addr']);
+        $db->query("UPDATE ota SET state='failed' WHERE state IN ('req','run','verify') AND time<".(time()-$OTA_TIMEOUT));
+        if ($db->querySingle("SELECT count(*) FROM ota WHERE state IN ('req','run','verify')")>0) return;
+        if (!preg_match('/^[0-9a-f]{16}$/i',$SECURITY_KEY)) {
+            // image CMAC with other key than firmware is never accepted by bootloader
+            if ($db->querySingle("SELECT count(*) FROM ota WHERE state='new'")>0) echo " OTA: \$SECURITY_KEY is not set, no rollout\n";
+            return;
+        }
+        $row = $db->querySingle("SELECT o.addr,f.id,length(f.image) AS size FROM ota o JOIN firmware f ON f.id=o.firmware "
+            ."WHERE o.state='new' ORDER BY o.time LIMIT 1",true);
+        if (empty($row)) return;
+        $db->query("INSERT INTO command_queue (addr,time,data) VALUES (".$row['addr'].",".time()
+            .",'".sprintf("U%02x%04x",$row['id']%255+1,$row['size'])."')");
+        $db->query("UPDATE ota SET state='req',time=".time().",chunk=0 WHERE addr=".$row['addr']);
+}
+function otaChunks($db,$line,$base) {
+        // "U: aa ii cccc nn" master needs nn chunks of image ii for slave aa
+        global $otaMacs;
+        $u = sscanf($line,"U: %x %x %x %x");
+        $u[0] += $base;
+        $fw = $db->querySingle("SELECT f.id,f.image FROM ota o JOIN firmware f ON f.id=o.firmware "
+            ."WHERE o.addr=".$u[0]." AND f.id%255+1=".$u[1],true);
+        if (empty($fw)) return array();
+        otaUnqueue($u[0]); // slave is in bootloader
+        if (!isset($otaMacs[$fw['id']])) $otaMacs[$fw['id']]=otaMac($fw['image']);
+        $chunks=(int)((strlen($fw['image'])+15)/16);
+        $lines=array();
+        for ($c=$u[2];($c<$u[2]+$u[3])&&($c<=$chunks);$c++) {
+            // chunk after image is trailer with image CMAC
+            $d = ($c<$chunks) ? substr($fw['image'],$c*16,16) : $otaMacs[$fw['id']];
+            $lines[] = sprintf("U%02x%04x%s\n",$u[1],$c,bin2hex(str_pad($d,16,"\xff")));
+        }
+        $db->query("UPDATE ota SET time=".time().",chunk=".$u[2].",state='".(($u[2]+$u[3]>$chunks)?"verify":"run")
+            ."' WHERE addr=".$u[0]);
+        return $lines;
+}
+function alert($db,$addr,$time,$type,$text) {
+        // one open alert per device and type, null text clears it
+        if ($text===null) {
+            $db->query("UPDATE alerts SET cleared=$time WHERE addr=$addr AND type='$type' AND cleared=0");
+            return;
+        }
+        $db->query("UPDATE alerts SET last=$time,text='$text' WHERE addr=$addr AND type='$type' AND cleared=0");
+        if ($db->changes()>0) return;
+        $db->query("INSERT INTO alerts (addr,time,last,type,text) VALUES ($addr,$time,$time,'$type','$text')");
+        echo " addr $addr alert $type: $text\n";
+}
+function anomaly($db,$addr,$time,$st) {
+        // online detectors over status records, fixed size state per device in table detect
+        global $ALERT_NO_EFFECT,$ALERT_FLAT,$ALERT_DRIFT,$ALERT_BAT_DAYS;
+        $row = $db->querySingle("SELECT time,state FROM detect WHERE addr=$addr",true);
+        $s = empty($row) ? array() : json_decode($row['state'],true);
+        if (!empty($row) && ($time<=$row['time'])) return; // snapshot of already seen record
+        $err = isset($st['error']) ? $st['error'] : 0;
+        alert($db,$addr,$time,'motor',($err&0x08) ? 'motor error' : null);
+        alert($db,$addr,$time,'montage',($err&0x04) ? 'not mounted / calibration failed' : null);
+        $ok = isset($st['real'],$st['valve']) && ($st['real']>0) && !isset($st['window']) && ($err&0x0c)==0;
+        $dt = empty($row) ? 0 : $time-$row['time'];
+        if ($ok && !empty($s['ok']) && ($dt>=30) && ($dt<=1800)) {
+            $h = $dt/3600;
+            $y = ($st['real']-$s['real'])/100/$h; // C/h
+            $x = array($s['valve'],-$s['real']/100,1);
+            // temperature response dT/dt = gain*valve - loss*T + c, normal equations with 1 week half-life
+            $l = pow(0.5,$h/168);
+            if (!isset($s['xx'])) { $s['xx']=array_fill(0,9,0); $s['xy']=array_fill(0,3,0); $s['n']=0; $s['rm']=0; $s['rv']=0; $s['cold']=0; $s['flat']=0; }
+            $b = ($s['n']>=100) ? solve3($s['xx'],$s['xy']) : null;
+            if ($b!==null) {
+                $r = $y-($b[0]*$x[0]+$b[1]*$x[1]+$b[2]);
+                $s['rm'] = 0.95*$s['rm']+0.05*$r;
+                $s['rv'] = 0.99*$s['rv']+0.01*$r*$r;
+                $lim = max($ALERT_DRIFT,3*sqrt($s['rv']*0.05/1.95));
+                alert($db,$addr,$time,'sensor',(abs($s['rm'])>$lim) ? sprintf('temperature response off by %.2f C/h',$s['rm']) : null);
+            }
+            for ($i=0;$i<3;$i++) {
+                for ($j=0;$j<3;$j++) $s['xx'][$i*3+$j] = $l*$s['xx'][$i*3+$j]+$x[$i]*$x[$j];
+                $s['xy'][$i] = $l*$s['xy'][$i]+$x[$i]*$y;
+            }
+            $s['n'] = $l*$s['n']+1;
+            // valve without effect, open and cold room not warming up
+            if (($s['valve']>=70) && ($s['real']<$s['wanted']-100) && ($y<=0.1)) $s['cold'] += $h;
+            else if ($y>0.3) $s['cold'] = 0;
+            alert($db,$addr,$time,'valve',($s['cold']>=$ALERT_NO_EFFECT) ? sprintf('valve %d%% without effect for %.1f h',$s['valve'],$s['cold']) : null);
+            // stuck sensor, averaged reading of a heated room never stays the same for hours
+            if ($st['real']==$s['real']) $s['flat'] += $h;
+            else $s['flat'] = 0;
+            alert($db,$addr,$time,'flat',($s['flat']>=$ALERT_FLAT) ? sprintf('temperature %.2f C for %.1f h',$st['real']/100,$s['flat']) : null);
+        }
+        if (isset($st['battery']) && ($st['battery']>0)) {
+            // battery trend, weighted linear regression over days with 30 days half-life
+            $d = $time/86400;
+            if (!isset($s['bw'])) { $s['bw']=0; $s['bt']=0; $s['by']=0; $s['btt']=0; $s['bty']=0; $s['bd']=$d; $s['b0']=$d; }
+            $t = $d-$s['b0'];
+            $l = pow(0.5,($d-$s['bd'])/30);
+            $s['bw'] = $l*$s['bw']+1; $s['bt'] = $l*$s['bt']+$t; $s['by'] = $l*$s['by']+$st['battery'];
+            $s['btt'] = $l*$s['btt']+$t*$t; $s['bty'] = $l*$s['bty']+$t*$st['battery'];
+            $s['bd'] = $d;
+            $den = $s['bw']*$s['btt']-$s['bt']*$s['bt'];
+            $text = null;
+            if (($t>=7) && ($den>0)) {
+                $slope = ($s['bw']*$s['bty']-$s['bt']*$s['by'])/$den; // mV/day
+                $now = $s['by']/$s['bw']+$slope*($t-$s['bt']/$s['bw']);
+                // bat_low_thld of EEPROM layouts 0x14 to 0x17, unit 20 mV
+                $low = $db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=36 "
+                    ."AND (SELECT value FROM eeprom WHERE addr=$addr AND idx=255) IN (20,21,22,23)");
+                $low = ($low===null) ? 2000 : $low*20;
+                if (($slope<0) && ($now-$low<-$slope*$ALERT_BAT_DAYS))
+                    $text = 'battery low around '.date('Y-m-d',$time+86400*max(0,($now-$low)/-$slope));
+            }
+            if ($err&0x80) $text = 'battery low';
+            alert($db,$addr,$time,'battery',$text);
+        }
+        if ($ok) { $s['real']=$st['real']; $s['valve']=$st['valve']; $s['wanted']=isset($st['wanted'])?$st['wanted']:0; }
+        $s['ok'] = $ok;
+        $db->query("INSERT OR REPLACE INTO detect (addr,time,state) VALUES ($addr,$time,'".json_encode($s)."')");
+}
+function solve3($a,$y) {
+        // 3x3 linear system, null when singular
+        $m = array(array($a[0],$a[1],$a[2],$y[0]),array($a[3],$a[4],$a[5],$y[1]),array($a[6],$a[7],$a[8],$y[2]));
+        for ($i=0;$i<3;$i++) {
+            $p=$i;
+            for ($j=$i+1;$j<3;$j++) if (abs($m[$j][$i])>abs($m[$p][$i])) $p=$j;
+            if (abs($m[$p][$i])<1e-9) return null;
+            $t=$m[$i]; $m[$i]=$m[$p]; $m[$p]=$t;
+            for ($j=$i+1;$j<3;$j++) {
+                $f=$m[$j][$i]/$m[$i][$i];
+                for ($k=$i;$k<4;$k++) $m[$j][$k]-=$f*$m[$i][$k];
+            }
+        }
+        $b=array(0,0,0);
+        for ($i=2;$i>=0;$i--) {
+            $b[$i]=$m[$i][3];
+            for ($j=$i+1;$j<3;$j++) $b[$i]-=$m[$i][$j]*$b[$j];
+            $b[$i]/=$m[$i][$i];
+        }
+        return $b;
+}
+function sendRTC($k) {
+        // each master runs late by its phase, slots of neighbouring masters are shifted
+        global $masters;
+        $t = microtime(true)-$masters[$k]['phase'];
+        $sec = (int)$t;
+        $usec = min(0.99,$t-$sec);
         $items = getdate($sec);
         $time = sprintf("H%02x%02x%02x%02x\n",
             $items['hours'], $items['minutes'], $items['seconds'], round($usec*100));
         $date = sprintf("Y%02x%02x%02x\n",
             $items['year']-2000, $items['mon'], $items['mday']);
         echo $time ." ". $date;
-        fwrite($fp,$date); fwrite($fp,$time);  // was other way around
+        send($k,$date); send($k,$time);  // was other way around
+}
+function send($k,$s) {
+        // ports are non-blocking, rest is written when port is writable again
+        global $masters;
+        $m =& $masters[$k];
+        $m['out'] .= $s;
+        if ($m['out']==='') return;
+        $n = fwrite($m['fp'],$m['out']);
+        if ($n>0) $m['out'] = (string)substr($m['out'],$n);
+}
+function queueCmp($a,$b) {
+        return ($a['time']!=$b['time']) ? $a['time']-$b['time'] : $a['id']-$b['id'];
+}
+function queueNew($db) {
+        // rows inserted by frontend or otaRollout since last look, returns their count
+        global $queue,$queueIa,$queueMax;
+        $n0=$queueMax;
+        $result = $db->query("SELECT id,addr,time,data,send FROM command_queue WHERE id>$queueMax ORDER BY time,id");
+        while ($row = $result->fetchArray(SQLITE3_ASSOC)) {
+            $a = $row['addr'];
+            if (!isset($queue[$a])) { $queue[$a]=array(); $queueIa[$a]=0; }
+            $n = count($queue[$a]);
+            $queue[$a][] = $row;
+            if (($n>0) && (queueCmp($queue[$a][$n-1],$row)>0)) usort($queue[$a],'queueCmp');
+            if (strpos('AMLB',$row['data']{0})!==false) $queueIa[$a]++;
+            $queueMax = max($queueMax,$row['id']);
+        }
+        return $queueMax-$n0;
+}
+function queueLoad($db) {
+        // whole table again, rows deleted by frontend disappear, so do their expired pushes
+        global $queue,$queueIa,$queueMax,$queueLoaded,$pushed,$QUEUE_REPUSH;
+        $queue=array(); $queueIa=array(); $queueMax=0;
+        queueNew($db);
+        $queueLoaded=time();
+        foreach ($pushed as $id=>$t) if ($t<=time()-$QUEUE_REPUSH) unset($pushed[$id]);
+}
+function queueDel($addr,$i) {
+        global $queue,$queueIa,$journal,$pushed;
+        $journal[] = "DELETE FROM command_queue WHERE id=".$queue[$addr][$i]['id'];
+        unset($pushed[$queue[$addr][$i]['id']]);
+        if (strpos('AMLB',$queue[$addr][$i]['data']{0})!==false) $queueIa[$addr]--;
+        array_splice($queue[$addr],$i,1);
+}
+function queueAck($addr,$tag,$c) {
+        // tagged: oldest row with tag and letter, untagged: first pushed row with letter,
+        // by time of push then id; push time of expired or earlier run counts as oldest
+        global $queue,$pushed;
+        if (empty($queue[$addr])) return;
+        $best = -1;
+        foreach ($queue[$addr] as $i=>$row) {
+            if ($row['data']{0}!=$c) continue;
+            if ($tag>0) {
+                if (($row['id']%255+1==$tag) && (($best<0) || ($row['id']<$queue[$addr][$best]['id']))) $best=$i;
+            } else if (($row['send']>0) || isset($pushed[$row['id']])) {
+                $key = array(isset($pushed[$row['id']]) ? $pushed[$row['id']] : 0, $row['id']);
+                if (($best<0) || ($key<$bestKey)) { $best=$i; $bestKey=$key; }
+            }
+        }
+        if ($best>=0) queueDel($addr,$best);
+}
+function stage($k,$a0,$credit) {
+        // commands of slot a0 and of next lookahead slots, master keeps them until their slot
+        // and a late answer of host to "(aa)?" doesn't leave the slot empty
+        global $masters,$queue,$pushed,$journal,$QUEUE_REPUSH;
+        $base=$masters[$k]['base'];
+        $q='';
+        for ($n=0;($n<=$masters[$k]['lookahead'])&&($n<29);$n++) {
+            $addr=$base+($a0-1+$n)%29+1;
+            $weight=0;
+            $bank=0;
+            $send=0;
+            foreach ((isset($queue[$addr]) ? array_slice($queue[$addr],0,25) : array()) as $i=>$row) {
+               if (isset($pushed[$row['id']]) && ($pushed[$row['id']]>time()-$QUEUE_REPUSH)) continue;
+               $cw = weights($row['data']{0})+2; // tag goes to slave and back as "#tt"
+               $weight += $cw;
+               if ($weight>10) {
+                    if (++$bank>=7) break;
+                    $weight=$cw;
+               }
+               $r = sprintf("(%02x#%02x)%s\n",$addr-$base,$row['id']%255+1,$row['data']);
+               if ($row['data']{0}=='U') $r = $row['data']."\n".$r; // "Uiissss" announces image to relay, see rfm-master/relay.c
+               if (strlen($q)+strlen($r)>$credit) break 2; // rest in next slot
+               $q.=$r;
+               echo $r;
+               $pushed[$row['id']]=time();
+               $send++;
+               $queue[$addr][$i]['send']=$send;
+               $journal[]="UPDATE command_queue SET send=$send WHERE id=".$row['id'];
+            }
+        }
+        send($k,$q);
+}
+function commit($db) {
+        // queue journal goes to database with the batch, then rows of frontend are picked up
+        // and new commands are staged at once when their slot is in lookahead of master
+        global $journal,$trans,$queueLoaded,$masters;
+        $t0=microtime(true);
+        foreach ($journal as $sql) $db->query($sql);
+        $journal=array();
+        if ($queueLoaded<time()-60) queueLoad($db);
+        else if (queueNew($db)>0) {
+            foreach ($masters as $j=>$m) if (($m['slot']>0) && ($m['lookahead']>0)) stage($j,$m['slot'],$m['credit']);
+        }
+        $db->query("COMMIT");
+        metricObserve('commit',microtime(true)-$t0);
+        metricObserve('batch',microtime(true)-$trans);
+        $trans=0;
+}
+function metricObserve($stage,$v) {
+        // latency histogram of ingestion stage, buckets are not cumulative here
+        global $metrics,$METRIC_BUCKETS;
+        if (!isset($metrics['lat'][$stage])) $metrics['lat'][$stage]=array('sum'=>0,'count'=>0,'b'=>array_fill(0,count($METRIC_BUCKETS)+1,0));
+        $metrics['lat'][$stage]['sum']+=$v;
+        $metrics['lat'][$stage]['count']++;
+        for ($i=0;($i<count($METRIC_BUCKETS))&&($v>$METRIC_BUCKETS[$i]);$i++);
+        $metrics['lat'][$stage]['b'][$i]++;
+}
+function metricFamily(&$o,$name,$type,$help,$samples) {
+        if (count($samples)==0) return;
+        $o.="# HELP $name $help\n# TYPE $name $type\n";
+        foreach ($samples as $l=>$v) $o.=$name.(($l!=='') ? "{".$l."}" : "")." ".$v."\n";
+}
+function metricsText() {
+        // Prometheus text format 0.0.4 from memory, database is not touched
+        global $metrics,$masters,$queue,$queueIa,$journal,$linkQuality,$METRIC_BUCKETS;
+        $o="";
+        metricFamily($o,"openhr20_daemon_start_time_seconds","gauge","Start of daemon.",array(''=>$metrics['start']));
+        $f=array('temperature_celsius'=>array(),'setpoint_celsius'=>array(),'valve_percent'=>array(),
+            'battery_volts'=>array(),'error_bits'=>array(),'window_open'=>array(),'manual_mode'=>array(),
+            'status_time_seconds'=>array(),'link_quality_percent'=>array());
+        ksort($metrics['dev']);
+        foreach ($metrics['dev'] as $a=>$st) {
+            $l="addr=\"$a\"";
+            if (isset($st['real'])) $f['temperature_celsius'][$l]=$st['real']/100;
+            if (isset($st['wanted'])) $f['setpoint_celsius'][$l]=$st['wanted']/100;
+            if (isset($st['valve'])) $f['valve_percent'][$l]=$st['valve'];
+            if (isset($st['battery'])) $f['battery_volts'][$l]=$st['battery']/1000;
+            $f['error_bits'][$l]=isset($st['error']) ? $st['error'] : 0;
+            $f['window_open'][$l]=isset($st['window']) ? 1 : 0;
+            $f['manual_mode'][$l]=(isset($st['mode']) && ($st['mode']=='MANU')) ? 1 : 0;
+            $f['status_time_seconds'][$l]=$st['time'];
+        }
+        foreach ($linkQuality as $a=>$q) $f['link_quality_percent']["addr=\"$a\""]=$q;
+        $help=array('temperature_celsius'=>"Measured temperature of last D record.",
+            'setpoint_celsius'=>"Wanted temperature of last D record.",'valve_percent'=>"Valve position of last D record.",
+            'battery_volts'=>"Battery voltage of last D record.",'error_bits'=>"Error byte of last D record (E).",
+            'window_open'=>"Window open flag of last D record.",'manual_mode'=>"1 in manual mode, 0 in automatic.",
+            'status_time_seconds'=>"Time of last D record.",'link_quality_percent'=>"Good packets in forced slots.");
+        foreach ($f as $n=>$v) metricFamily($o,"openhr20_".$n,"gauge",$help[$n],$v);
+        $q=array(); $qi=array();
+        foreach ($queue as $a=>$rows) if (count($rows)>0) { $q["addr=\"$a\""]=count($rows); $qi["addr=\"$a\""]=$queueIa[$a]; }
+        metricFamily($o,"openhr20_queue_commands","gauge","Commands in command_queue.",$q);
+        metricFamily($o,"openhr20_queue_interactive_commands","gauge","A, M, L and B commands in command_queue.",$qi);
+        metricFamily($o,"openhr20_queue_journal","gauge","Queue changes waiting for commit.",array(''=>count($journal)));
+        $c=array('lines'=>"Lines received from master.",'bytes'=>"Bytes received from master.",
+            'packets'=>"PKT lines, packets received.",'packet_errors'=>"ERR lines, packets with bad MAC or length.",
+            'incomplete_records'=>"Records with !xx! mark of truncated packet.",'tx_overflow_markers'=>"Lines cut by output buffer overflow of master.");
+        $g=array('tx_lost_chars'=>"Chars lost on output buffer of master (F: T).",'rx_lost_chars'=>"Chars lost on input buffer of master (F: R).",
+            'credit_bytes'=>"Free input buffer of master (F: C).",'queue_free'=>"Free command queue items of master (F: Q).");
+        foreach ($c as $n=>$h) {
+            $v=array();
+            foreach ($masters as $m) $v["master=\"".$m['port']."\""]=$m['stats'][$n];
+            metricFamily($o,"openhr20_master_".$n."_total","counter",$h,$v);
+        }
+        foreach ($g as $n=>$h) {
+            $v=array();
+            foreach ($masters as $m) if (isset($m['stats'][$n])) $v["master=\"".$m['port']."\""]=$m['stats'][$n];
+            metricFamily($o,"openhr20_master_".$n,"gauge",$h,$v);
+        }
+        if (count($metrics['lat'])>0) {
+            $o.="# HELP openhr20_stage_seconds Ingestion latency: line handling, answer to (aa)? since read, commit, batch open to commit.\n";
+            $o.="# TYPE openhr20_stage_seconds histogram\n";
+            foreach ($metrics['lat'] as $stage=>$h) {
+                $n=0;
+                foreach ($METRIC_BUCKETS as $i=>$le) {
+                    $n+=$h['b'][$i];
+                    $o.="openhr20_stage_seconds_bucket{stage=\"$stage\",le=\"$le\"} $n\n";
+                }
+                $o.="openhr20_stage_seconds_bucket{stage=\"$stage\",le=\"+Inf\"} ".$h['count']."\n";
+                $o.="openhr20_stage_seconds_sum{stage=\"$stage\"} ".sprintf("%.6f",$h['sum'])."\n";
+                $o.="openhr20_stage_seconds_count{stage=\"$stage\"} ".$h['count']."\n";
+            }
+        }
+        return $o;
+}
+function metricsAccept() {
+        global $metricsSrv,$clients,$clientId;
+        $fp=@stream_socket_accept($metricsSrv,0);
+        if ($fp===false) return;
+        stream_set_blocking($fp,false);
+        $clients["h".(++$clientId)]=array('fp'=>$fp,'in'=>'','out'=>'');
+}
+function metricsRead($id) {
+        // one request per connection, any path but /metrics is 404
+        global $clients;
+        $d=fread($clients[$id]['fp'],4096);
+        if (($d===false) || ($d==='') || (strlen($clients[$id]['in'])>8192)) {
+            fclose($clients[$id]['fp']);
+            unset($clients[$id]);
+            return;
+        }
+        $clients[$id]['in'].=$d;
+        if ((strpos($clients[$id]['in'],"\r\n\r\n")===false) && (strpos($clients[$id]['in'],"\n\n")===false)) return;
+        if (preg_match('#^GET /metrics[ ?]#',$clients[$id]['in'])) {
+            $body=metricsText();
+            $h="HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+        } else {
+            $body="not found\n";
+            $h="HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+        }
+        $clients[$id]['out']=$h."Content-Length: ".strlen($body)."\r\nConnection: close\r\n\r\n".$body;
+        $clients[$id]['in']='';
+}
+function metricsWrite($id) {
+        global $clients;
+        $n=@fwrite($clients[$id]['fp'],$clients[$id]['out']);
+        if ($n===false) $n=strlen($clients[$id]['out']);
+        $clients[$id]['out']=(string)substr($clients[$id]['out'],$n);
+        if ($clients[$id]['out']==='') {
+            fclose($clients[$id]['fp']);
+            unset($clients[$id]);
+        }
 }
 
+require __DIR__.'/schema.php';
 $db = new SQLite3("/tmp/openhr20.sqlite");
-$db->query("PRAGMA synchronous=OFF");
+if ($db->querySingle("PRAGMA user_version")<DB_VERSION) die("database schema v1, run migrate_db.php\n");
+dbPragmas($db);
 
 //$fp=fsockopen("192.168.62.230",3531);
 //$fp=fopen("php://stdin","r"); 
-$fp=fopen("/dev/ttyUSB0","w+"); 
-
-//while(($line=stream_get_line($fp,256,"\n"))!=FALSE) {
+if (count($MASTERS)==0) $MASTERS=array($SERIAL=>0);
+$masters=array();
+foreach ($MASTERS as $port=>$base) {
+    if ($SERIAL_STTY!="") system("stty -F ".$port." ".$SERIAL_STTY);
+    $fp=fopen($port,"w+");
+    if ($fp===false) die("can't open $port\n");
+    stream_set_blocking($fp,false);
+    stream_set_read_buffer($fp,0); // stream_select must see all received bytes
+    $masters[]=array(
+        'port'=>$port,
+        'fp'=>$fp,
+        'base'=>$base,
+        'phase'=>(count($masters)*$MASTER_PHASE%100)/100,
+        'in'=>'', // received, not complete line
+        'out'=>'', // not written yet
+        'addr'=>-1,
+        'credit'=>63, // free space in master input buffer, updated by "F:" line
+        'lookahead'=>0, // slots after requested one master takes commands for, "W" of "F:" line
+        'slot'=>0, // last "(aa)?" request
+        'shares'=>false, // master takes backlog by N command, "S" of "F:" line
+        'stats'=>array('lines'=>0,'bytes'=>0,'packets'=>0,'packet_errors'=>0,'incomplete_records'=>0,'tx_overflow_markers'=>0),
+        'afc'=>null, // AFC from last "PKT" line, belongs to next "(aa){" line
+        'otaq'=>array(), // firmware chunk lines for master, next one after its "OK"
+        'otaSent'=>0); // time of last chunk line
+}
 
-$addr=-1;
-$trans=false;
+$trans=0; // start of open write batch
+$pushed=array(); // command_queue id => time of last push to master
+// command_queue is kept in memory, slot requests are answered without database access
+$queue=array(); // addr => rows ordered by time
+$queueIa=array(); // addr => number of interactive commands (A, M, L, B)
+$queueMax=0; // highest id in $queue
+$queueLoaded=0; // time of last full load
+$journal=array(); // changes of $queue, written with next commit
+queueLoad($db);
+$linkQuality=array(); // addr => quality of link_stats
+$result = $db->query("SELECT addr,quality FROM link_stats");
+while ($row = $result->fetchArray()) $linkQuality[$row['addr']]=$row['quality'];
+$otaMacs=array(); // firmware id => image CMAC
+$metrics=array('start'=>time(),'dev'=>array(),'lat'=>array()); // dev: addr => last D record and its time
+$METRIC_BUCKETS=array(0.0005,0.001,0.005,0.01,0.05,0.1,0.5,1,5); // s
+$clients=array(); // metrics connections "hN" => fp, in, out
+$clientId=0;
+$metricsSrv=false;
+if ($METRICS!="") {
+    $metricsSrv=stream_socket_server($METRICS,$errno,$errstr);
+    if ($metricsSrv===false) echo " <metrics $METRICS: $errstr>\n";
+    else stream_set_blocking($metricsSrv,false);
+}
 
 echo " <Starting>..\n";
-sendRTC($fp);
+foreach ($masters as $k=>$m) {
+    sendRTC($k);
+    send($k,"F\n"); // ask master for input buffer size
+    send($k,"C\n"); // ask master for last known status of all slaves
+}
 
-while(($line=fgets($fp,256))!==FALSE) {
+while (count($masters)>0) {
+  $rd=array(); $wr=array(); $e=null;
+  foreach ($masters as $k=>$m) {
+    $rd[$k]=$m['fp'];
+    if ($m['out']!=='') $wr[$k]=$m['fp'];
+  }
+  if ($metricsSrv!==false) $rd['srv']=$metricsSrv;
+  foreach ($clients as $id=>$c) {
+    if ($c['out']!=='') $wr[$id]=$c['fp'];
+    else $rd[$id]=$c['fp'];
+  }
+  // open batch is committed as soon as no port has input
+  if (stream_select($rd,$wr,$e,($trans>0) ? 0 : null)===false) break;
+  foreach ($rd as $k=>$fp) if (!is_int($k)) {
+    if ($k=='srv') metricsAccept();
+    else metricsRead($k);
+    unset($rd[$k]);
+  }
+  foreach ($wr as $k=>$fp) if (!is_int($k)) {
+    if (isset($clients[$k])) metricsWrite($k);
+    unset($wr[$k]);
+  }
+  if ((count($rd)==0) && ($trans>0)) commit($db);
+  foreach ($wr as $k=>$fp) send($k,'');
+  foreach ($rd as $k=>$fp) {
+   $d=fread($fp,4096);
+   $tr=microtime(true);
+   if (($d===false) || (($d==='') && feof($fp))) {
+     echo " <".$masters[$k]['port']." closed>\n";
+     unset($masters[$k]);
+     continue;
+   }
+   $masters[$k]['in'].=$d;
+   $masters[$k]['stats']['bytes']+=strlen($d);
+   $base=$masters[$k]['base'];
+   $addr=$masters[$k]['addr'];
+   $credit=$masters[$k]['credit'];
+   $afc=$masters[$k]['afc'];
+   $otaq=$masters[$k]['otaq'];
+   $otaSent=$masters[$k]['otaSent'];
+   $ts=0;
+   while (($p=strpos($masters[$k]['in'],"\n"))!==false) {
+    if ($ts>0) metricObserve('line',microtime(true)-$ts); // previous line, its branch can end by continue
+    $ts=0;
+    $line=substr($masters[$k]['in'],0,$p);
+    $masters[$k]['in']=(string)substr($masters[$k]['in'],$p+1);
     $line=trim($line);
     if ($line == "") continue; // ignore empty lines
+    if ($trans==0) {
+        // writes of lines are batched, serial ports never wait for a commit
+        $db->query("BEGIN TRANSACTION");
+        $trans=microtime(true);
+    }
     $debug=true;
     echo " < ".$line."\n";
 	$force=false;
     $ts=microtime(true);
+    $masters[$k]['stats']['lines']++;
+    if (substr($line,-1)=='*') $masters[$k]['stats']['tx_overflow_markers']++; // end of line lost in master
+    if (strpos($line,'!')!==false && preg_match('/![0-9a-f]{2}!/',$line)) $masters[$k]['stats']['incomplete_records']++;
     if ($line{0}=='(' && $line{3}==')') {
-	   $addr = hexdec(substr($line,1,2));
+	   $addr = $base+hexdec(substr($line,1,2));
 	   $data = substr($line,4);
        if ($line{4}=='{') {
-    	   if (!$trans) $db->query("BEGIN TRANSACTION");
-    	   $trans=true;
+    	   if ($afc!==null) $db->query("INSERT INTO afc_hist (addr,afc,count) VALUES ($addr,$afc,1) "
+    	       ."ON CONFLICT(addr,afc) DO UPDATE SET count=count+1");
+    	   $afc=null;
        }
 
     } else if ($line{0}=='*') {
-	   $db->query("DELETE FROM command_queue WHERE id=(SELECT id FROM command_queue WHERE addr=$addr AND send>0 ORDER BY send LIMIT 1)");
-	   $force=true;
        $data = substr($line,1);
+	   if ($data{0}=='#') {
+	       // "*#ii X..." ack of command pushed as "(aa#ii)X..", ii is id%255+1
+	       $tag = hexdec(substr($data,1,2));
+	       $data = substr($data,4);
+	       queueAck($addr,$tag,$data{0});
+	   } else {
+	       // untagged command, ack oldest send command with same letter
+	       queueAck($addr,0,$data{0});
+	   }
+	   $force=true;
     } else if ($line{0}=='-') {
 	   $data = substr($line,1);
     } else if ($line=='}') { 
-        if ($trans) $db->query("COMMIT TRANSACTION");
-        $trans=false;
  	    $data = substr($line,1);
         $addr=0;
     } else {
         $addr=0;
+        if ($line{0}=='@') $masters[$k]['stats'][(strpos($line,' ERR')!==false) ? 'packet_errors' : 'packets']++;
+        // "@ss.ss PKTxxxx AFCxx", AFC only with RFM_TUNING master
+        $afc = (($line{0}=='@') && preg_match('/ AFC([0-9a-f]{2})$/',$line,$m)) ? (hexdec($m[1])^0x80)-0x80 : null;
     }
     
     if ($line=="RTC?") {
-        sendRTC($fp);
+        sendRTC($k);
+        if ((int)date('i')%10==0) send($k,"C\n"); // refresh link statistics
+        send($k,"F\n"); // refresh credit and queue state
+        otaRollout($db);
+        // command_queue rows with addr 0 are group commands (A, M, L) for all slaves,
+        // master send it in sync packets, result is visible in next status records
+        if (!empty($queue[0])) {
+            $row = $queue[0][0];
+            if (preg_match('/^[AML][0-9a-f]{2}$/',$row['data'])) {
+                $v = "Kfeffff3f".$row['data']."\n";
+                echo $v;
+                foreach ($masters as $j=>$m) send($j,$v); // all slaves of all masters
+            }
+            queueDel(0,0);
+        }
     	$debug=false;
+    } else if (substr($line,0,4)=="F: C") {
+        // master flow state "F: Ccc Thhhh Rhhhh Lll Qqq Www", overflows stay in debug log
+        $credit=hexdec(substr($line,4,2));
+        if (preg_match('/^F: C([0-9a-f]{2}) T([0-9a-f]{4}) R([0-9a-f]{4})/',$line,$m)) {
+            $masters[$k]['stats']['credit_bytes']=hexdec($m[1]);
+            $masters[$k]['stats']['tx_lost_chars']=hexdec($m[2]);
+            $masters[$k]['stats']['rx_lost_chars']=hexdec($m[3]);
+        }
+        if (preg_match('/ Q([0-9a-f]{2})/',$line,$m)) $masters[$k]['stats']['queue_free']=hexdec($m[1]);
+        if (preg_match('/ W([0-9a-f]{2})( S)?$/',$line,$m)) $masters[$k]['lookahead']=hexdec($m[1]);
+        $masters[$k]['shares']=(substr($line,-2)==" S");
+        if (preg_match('/^F: C[0-9a-f]{2} T0000 R0000( L[0-9a-f]{2})?( Q[0-9a-f]{2} W[0-9a-f]{2}( S)?)?$/',$line)) $debug=false;
+    } else if (substr($line,0,2)=="N:") {
+        // seconds of second half-minute dealt by master "N: aa:ss aa:ss"
+        $debug=false;
     } else if (($line=="OK") || (($line{0}=='d') && ($line{2}==' '))) {
+        if (($line=="OK") && (count($otaq)>0)) {
+            send($k,array_shift($otaq)); $otaSent=time();
+        }
+        $debug=false;
+    } else if (substr($line,0,3)=="U: ") {
+        // one chunk line at time, 40 characters fill most of master input buffer
+        $otaq=array_merge($otaq,otaChunks($db,$line,$base));
+        if ((count($otaq)>0) && ($otaSent<time()-1)) {
+            send($k,array_shift($otaq)); $otaSent=time();
+        }
         $debug=false;
     } else if (($line=="N0?") || ($line=="N1?")) {
-        $result = $db->query("SELECT addr,count(*) AS c FROM command_queue GROUP BY addr ORDER BY c");
-        // $result = $db->query("SELECT addr,count(*) AS c FROM command_queue WHERE send=0 GROUP BY addr ORDER BY c");
+        // queue length per address of this master, shortest first
+        $cnt = array();
+        for ($a=1;$a<30;$a++) if (!empty($queue[$base+$a])) $cnt[$a]=count($queue[$base+$a]);
+        asort($cnt);
     	$req = array(0,0,0,0);
     	$v = "O0000\n";
-	$pr = 0;
-        while ($row = $result->fetchArray()) {
-            $addr = $row['addr'];
-            if (($addr>0) && ($addr<30)) {
-                unset($v);
-                if (($line=="N1?")&&($row['c']>20)) {
-                    $v=sprintf("O%02x%02x\n",$addr,$pr);
-		    $pr=$addr;
-                    continue;
-                }
-                $req[(int)$addr/8] |= (int)pow(2,($addr%8));
+	$o = array();
+	if ($line=="N1?") {
+	    // interactive commands for flaky link: retry in each odd/even second of second half-minute
+	    for ($a=1;$a<30;$a++) {
+	        if (!empty($queueIa[$base+$a]) && isset($linkQuality[$base+$a]) && ($linkQuality[$base+$a]<$LINK_QUALITY_MIN)) $o[] = $a;
+	    }
+	}
+	$flaky = count($o);
+        foreach ($cnt as $a=>$c) {
+            unset($v);
+            if (($line=="N1?")&&($c>20)) {
+                // bulk transfer, biggest queue first after flaky links
+                if (!in_array($a,$o)) array_splice($o,$flaky,0,array($a));
+                continue;
             }
+            $req[(int)$a/8] |= (int)pow(2,($a%8));
         }
+        if (count($o)>0) $v=sprintf("O%02x%02x\n",$o[0],isset($o[1])?$o[1]:0);
         if (!isset($v)) $v = sprintf("P%02x%02x%02x%02x\n",$req[0],$req[1],$req[2],$req[3]);
-        echo $v; fwrite($fp,$v);
-        //fwrite($fp,"P14000000\n");
+        if (($line=="N1?") && $masters[$k]['shares'] && ((count($cnt)>0) || ($flaky>0))) {
+            // master shares second half-minute by backlog, flaky link counts as full queue
+            $b = array();
+            foreach ($cnt as $a=>$c) $b[$a]=min($c,254);
+            for ($i=0;$i<$flaky;$i++) $b[$o[$i]]=255;
+            arsort($b);
+            $v = "N";
+            foreach (array_slice($b,0,8,true) as $a=>$c) $v.=sprintf("%02x%02x",$a,$c);
+            $v.="\n";
+        }
+        echo $v; send($k,$v);
+        //send($k,"P14000000\n");
         $debug=false;
     } else {
     	if ($addr>0) {
     	  if ($data{0}=='?') {
     	    $debug=false;
     	    // echo "data req addr $addr\n";
-    	    $db->query("BEGIN TRANSACTION");
-    	    $result = $db->query("SELECT id,data FROM command_queue WHERE addr=".($addr&0x7f)." ORDER BY time LIMIT 25");
-    	    $weight=0;
-    	    $bank=0;
-    	    $send=0;
-    	    $q='';
-    	    while ($row = $result->fetchArray()) {
-    	       $cw = weights($row['data']{0});
-    	       $weight += $cw;
-               weights($row['data']{0});
-    	       if ($weight>10) {
-                    if (++$bank>=7) break;
-                    $weight=$cw;
-               }
-    	       $r = sprintf("(%02x-%x)%s\n",$addr,$bank,$row['data']);
-    	       $q.=$r;
-               echo $r;
-               $send++;
-               $db->query("UPDATE command_queue SET send=$send WHERE id=".$row['id']);
-            }
-            fwrite($fp,$q);
-    	    $db->query("COMMIT");
+    	    $masters[$k]['slot']=$addr-$base;
+    	    stage($k,$addr-$base,$credit);
+    	    metricObserve('answer',microtime(true)-$tr);
     
     	    //$debug=false;
     	  } else if (strlen($data) >= 5 && $data{1}=='[' && $data{4}==']' && $data{5}=='=') {
@@ -150,22 +750,39 @@ while(($line=fgets($fp,256))!==FALSE) {
     	    case 'T':
     		$table='trace';
     		break;
+    	    case 'U':
+    		// firmware update accepted (size), refused (0) or image is running already (ffff)
+    		$db->query("UPDATE ota SET time=".time().",state='".(($value==0xffff)?'done':($value?'run':'failed'))."' WHERE addr=$addr AND state='req'");
+    		otaUnqueue($addr);
+    		$table=null;
+    		break;
     	    default:
     		$table=null;
     	    }
     	    echo " table $table\n";
     	    if ($table!==null) {
-    	      $db->query("UPDATE $table SET time=".time().",value=$value WHERE addr=$addr AND idx=$idx");
-    	      $changes=$db->changes();
-    	      if ($changes==0)
-    	        $db->query("INSERT INTO $table (time,addr,idx,value) VALUES (".time().",$addr,$idx,$value)");
+    	      $db->query("INSERT INTO $table (time,addr,idx,value) VALUES (".time().",$addr,$idx,$value) "
+    	        ."ON CONFLICT(addr,idx) DO UPDATE SET time=excluded.time,value=excluded.value");
     	    }
     	  } else if ($data{0}=='V') {
-    	      $db->query("UPDATE versions SET time=".time().",data='$data' WHERE addr=$addr");
-    	      $changes=$db->changes();
-    	      if ($changes==0)
-    	        $db->query("INSERT INTO versions (addr,time,data) VALUES ($addr,".time().",'$data')");
-	  } else if (($data{0}=='D'||$data{0}=='A') && $data{1}==' ') {
+    	      $db->query("INSERT INTO versions (addr,time,data) VALUES ($addr,".time().",'$data') "
+    	        ."ON CONFLICT(addr) DO UPDATE SET time=excluded.time,data=excluded.data");
+	  } else if (($data{0}=='D'||$data{0}=='A'||$data{0}=='C') && $data{1}==' ') {
+    	    $now = time();
+    	    $snapshot = false;
+    	    if ($data{0}=='C') {
+    	      // status from master cache: "C tAAAA pPP eEE xXX fFF:LL:HH -D m.. s.. ..."
+    	      linkStats($db,$addr,$data);
+    	      $p = strpos($data,' -');
+    	      $age = hexdec(substr($data,3,4));
+    	      if (($p===false) || ($age==0xffff)) continue;
+    	      $data = substr($data,$p+2);
+    	      if (($data{0}!='D') && ($data{0}!='A')) continue;
+    	      $now -= $age;
+    	      $snapshot = true;
+    	    }
+    	    // first status of new application ends update
+    	    if (!$snapshot) $db->query("UPDATE ota SET state='done',time=$now WHERE addr=$addr AND state='verify'");
     	    $items = explode(' ',$data);
     	    unset($items[0]);
     	    $t=0;
@@ -212,15 +829,20 @@ while(($line=fgets($fp,256))!==FALSE) {
                 if ($force) $st['force']=1;
     	    }
             $vars=""; $val="";
-            foreach ($st as $k=>$v) {
-                $vars.=",".$k;
+            foreach ($st as $col=>$v) {
+                $vars.=",".$col;
                 if (is_int($v)) $val.=",".$v;
                 else $val.=",'".$v."'";
             }
-            $time = time();
+            $time = $now;
             if (($time % 3600)<$t) $time-=3600;
             $time = (int)($time/3600)*3600+$t;
-        	$db->query("INSERT INTO log (time,addr$vars) VALUES ($time,$addr$val)\n");
+            if (!isset($metrics['dev'][$addr]) || ($metrics['dev'][$addr]['time']<=$time)) $metrics['dev'][$addr]=$st+array('time'=>$time);
+            // snapshot after reconnect, record can be already stored
+            $part = logPartition($db,$time);
+            if ($snapshot && $db->querySingle("SELECT count(*) FROM $part WHERE addr=$addr AND time=$time")>0) continue;
+        	$db->query("INSERT INTO $part (time,addr$vars) VALUES ($time,$addr$val)\n");
+            anomaly($db,$addr,$time,$st);
 		$rrd_file = $RRD_HOME."/openhr20_".$addr.".rrd";
 		if (file_exists ($rrd_file)) {
         		$cmnd = "rrdtool update ".$rrd_file." ".$time.":".(int)$st['real'].":".(int)$st['wanted'].":".(int)$st['valve'].":".(int)$st['window'];
@@ -239,5 +861,15 @@ while(($line=fgets($fp,256))!==FALSE) {
 	$db->query("DELETE FROM debug_log WHERE id<$deleteThld");	
     }
 	// echo "         duration ".(microtime(true)-$ts)."\n";
+   }
+   if ($ts>0) metricObserve('line',microtime(true)-$ts);
+   $masters[$k]['addr']=$addr;
+   $masters[$k]['credit']=$credit;
+   $masters[$k]['afc']=$afc;
+   $masters[$k]['otaq']=$otaq;
+   $masters[$k]['otaSent']=$otaSent;
+  }
+  if (($trans>0) && (microtime(true)-$trans>$DB_BATCH)) commit($db);
 } 
+if ($trans>0) commit($db);
 echo " <STOPPED>";
@@ -0,0 +1,188 @@
+<?php
+
+// Timer programs learned from manual overrides in table log.
+// Proposals go to table timer_proposals, page "timers" of the frontend
+// shows them and sends approved ones as W commands (changed slots only).
+//
+// usage: php learn_timers.php [weeks] [addr]
+
+$WEEKS = isset($argv[1]) ? (int)$argv[1] : 8; // history used for learning
+$ONLY = isset($argv[2]) ? (int)$argv[2] : 0;
+$BIN = 15; // minutes, time resolution of learned switch points
+$MIN_SAMPLES = 3; // status records in one bin over all weeks, below it schedule is kept
+$MIN_SHARE = 0.5; // share of records with same override, above it override becomes schedule
+$MIN_RUN = 2; // bins, shorter learned segments are noise
+$TIMERS_PER_DOW = 8; // RTC_TIMERS_PER_DOW
+$UNUSED = 0xfff; // time of unused timer slot
+$TIMEZONE="Europe/Warsaw";
+
+date_default_timezone_set($TIMEZONE);
+
+require __DIR__.'/schema.php';
+$db = new SQLite3("/tmp/openhr20.sqlite");
+dbPragmas($db); // busy timeout too, daemon commits its writes in batches
+
+// type active at minute of day, same search as RTC_FindTimerRawIndex (common/rtc.c)
+function active($rows,$mode,$dow,$min) {
+    $d = ($mode==1) ? $dow : 0;
+    for ($i=0;$i<($d ? 8 : 2);$i++) {
+        $best = -1; $type = null;
+        foreach ($rows[$d] as $v) {
+            $t = $v&0xfff;
+            if ($t>=24*60) continue;
+            if (($t>=$best) && ($t<=$min)) { $best=$t; $type=($v>>12)&3; }
+        }
+        if ($type!==null) return $type;
+        if ($d>0) $d = ($d+5)%7+1;
+        $min = 24*60;
+    }
+    return null;
+}
+
+// switch points of one day from bin types, previous day end type decides point at 00:00
+function points($bins,$prev) {
+    global $BIN;
+    $p = array();
+    $last = $prev;
+    foreach ($bins as $b=>$type) {
+        if ($type!==$last) $p[] = ($type<<12)|($b*$BIN);
+        $last = $type;
+    }
+    if (count($p)==0) $p[] = $last<<12; // whole day same type
+    return $p;
+}
+
+// keep slots which already hold a wanted value, fewest W commands
+function placeSlots($old,$points) {
+    global $TIMERS_PER_DOW,$UNUSED;
+    $new = array();
+    $rest = array();
+    foreach ($points as $v) {
+        $s = array_search($v,$old,true);
+        if (($s!==false) && !isset($new[$s])) $new[$s]=$v;
+        else $rest[]=$v;
+    }
+    for ($s=0;$s<$TIMERS_PER_DOW;$s++) {
+        if (isset($new[$s])) continue;
+        $o = isset($old[$s]) ? $old[$s] : $UNUSED;
+        if (count($rest)>0) $new[$s] = array_shift($rest);
+        else $new[$s] = (($o&0xfff)>=24*60) ? $o : $UNUSED; // free slot, already unused one stays
+    }
+    ksort($new);
+    return $new;
+}
+
+$result = $db->query("SELECT DISTINCT addr FROM timers".($ONLY ? " WHERE addr=$ONLY" : ""));
+$addrs = array();
+while ($row = $result->fetchArray()) $addrs[] = $row['addr'];
+
+foreach ($addrs as $addr) {
+    $layout = $db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=255");
+    if ($layout===null) continue;
+    include __DIR__.'/../www/ee_layouts/'.sprintf("%02x",$layout).'.php';
+    $mode = $db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=".$layout_names['timer_mode']);
+    $temps = array();
+    for ($i=0;$i<4;$i++) {
+        $v = $db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=".$layout_names["temperature$i"]);
+        if ($v!==null) $temps[$i] = $v*50; // 1/100 C as in log
+    }
+    if (($mode===null) || (count($temps)<4)) continue;
+    $rows = array_fill(0,8,array());
+    $result = $db->query("SELECT idx,value FROM timers WHERE addr=$addr");
+    while ($row = $result->fetchArray()) $rows[$row['idx']>>4][$row['idx']&0xf] = $row['value'];
+    if (active($rows,$mode,1,0)===null) continue; // no program to learn from
+
+    // per weekday and bin: records and overrides by preset they are closest to
+    $total = array(); $over = array(); $n = 0;
+    $result = $db->query("SELECT time,mode,wanted FROM log WHERE addr=$addr AND time>".(time()-$WEEKS*7*86400)
+        ." AND window=0 AND wanted>0 AND mode IN ('AUTO','MANU')");
+    while ($row = $result->fetchArray()) {
+        $dow = (int)date('N',$row['time']);
+        $min = (int)date('G',$row['time'])*60+(int)date('i',$row['time']);
+        $b = (int)($min/$BIN);
+        $sched = active($rows,$mode,$dow,$min);
+        if ($sched===null) continue;
+        $obs = 0;
+        for ($i=1;$i<4;$i++) if (abs($temps[$i]-$row['wanted'])<abs($temps[$obs]-$row['wanted'])) $obs=$i;
+        if (!isset($total[$dow][$b])) $total[$dow][$b]=0;
+        $total[$dow][$b]++;
+        if (($row['mode']=='MANU') || ($row['wanted']!=$temps[$sched])) {
+            if ($obs!=$sched) {
+                if (!isset($over[$dow][$b][$obs])) $over[$dow][$b][$obs]=0;
+                $over[$dow][$b][$obs]++;
+            }
+            $n++;
+        }
+    }
+
+    // learned type of each bin
+    $learned = array();
+    for ($dow=1;$dow<=7;$dow++) {
+        for ($b=0;$b<24*60/$BIN;$b++) {
+            $type = active($rows,$mode,$dow,$b*$BIN);
+            if (isset($over[$dow][$b]) && ($total[$dow][$b]>=$MIN_SAMPLES)) {
+                arsort($over[$dow][$b]);
+                $o = key($over[$dow][$b]);
+                if ($over[$dow][$b][$o]>=$MIN_SHARE*$total[$dow][$b]) $type=$o;
+            }
+            $learned[$dow][$b] = $type;
+        }
+        // short segments back to neighbour, then at most 8 switch points
+        do {
+            $runs = array(); $s = 0;
+            foreach ($learned[$dow] as $b=>$type) {
+                if (($b>0) && ($type!==$learned[$dow][$b-1])) { $runs[] = array($s,$b); $s=$b; }
+            }
+            $runs[] = array($s,count($learned[$dow]));
+            $short = null;
+            foreach ($runs as $k=>$r) {
+                if (($k>0) && (($r[1]-$r[0]<$MIN_RUN) || (count($runs)>$TIMERS_PER_DOW))
+                    && (($short===null) || ($r[1]-$r[0]<$runs[$short][1]-$runs[$short][0]))) $short=$k;
+            }
+            if ($short!==null) {
+                for ($b=$runs[$short][0];$b<$runs[$short][1];$b++) $learned[$dow][$b]=$learned[$dow][$runs[$short][0]-1];
+            }
+        } while ($short!==null);
+    }
+
+    // one program for all days when weekdays agree
+    $same = true;
+    for ($dow=2;$dow<=7;$dow++) if ($learned[$dow]!==$learned[1]) $same=false;
+    $prop = array();
+    if ($same && ($mode==0)) {
+        $p = points($learned[1],$learned[1][count($learned[1])-1]);
+        $prop[0] = placeSlots($rows[0],$p);
+    } else {
+        for ($dow=1;$dow<=7;$dow++) {
+            $prev = $learned[($dow+5)%7+1];
+            $p = points($learned[$dow],$prev[count($prev)-1]);
+            $prop[$dow] = placeSlots($rows[$dow],$p);
+        }
+    }
+
+    // store only rows with different program, all differing rows when mode changes to weekdays
+    $switch = ($mode==0) && !$same;
+    $db->query("BEGIN TRANSACTION");
+    $db->query("DELETE FROM timer_proposals WHERE addr=$addr");
+    $changed = 0;
+    foreach ($prop as $d=>$slots) {
+        $diff = false;
+        for ($dow=($d ? $d : 1);$dow<=($d ? $d : 7);$dow++) {
+            for ($b=0;$b<24*60/$BIN;$b++) if (active($rows,$mode,$dow,$b*$BIN)!==$learned[$dow][$b]) $diff=true;
+        }
+        if ($switch) {
+            $diff = false;
+            foreach ($slots as $s=>$v) if (!isset($rows[$d][$s]) || ($rows[$d][$s]!=$v)) $diff=true;
+        }
+        if (!$diff) continue;
+        foreach ($slots as $s=>$v) {
+            $db->query("INSERT INTO timer_proposals (addr,idx,value,time,overrides) VALUES ($addr,".(($d<<4)|$s).",$v,".time().",$n)");
+        }
+        $changed++;
+    }
+    if ($switch) {
+        $db->query("INSERT INTO timer_proposals (addr,idx,value,time,overrides) VALUES ($addr,255,1,".time().",$n)");
+    }
+    $db->query("COMMIT");
+    echo "addr $addr: $n overrides, ".($changed ? "$changed day programs proposed" : "program kept")."\n";
+}
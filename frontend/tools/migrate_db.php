@@ -0,0 +1,136 @@
+<?php
+
+// Online migration of database schema v1 (create_db.php before v2) to v2.
+// Daemon of v1 and pages may keep running: log is copied in short
+// transactions, tables are switched in one short transaction at the end.
+// Old daemon keeps working after it (updates of eeprom/timers/trace find
+// their row, insert into log goes through trigger of the view), restart
+// daemon of v2 afterwards.
+//
+// usage: php migrate_db.php [database]
+
+require __DIR__.'/schema.php';
+
+$FILE = isset($argv[1]) ? $argv[1] : "/tmp/openhr20.sqlite";
+$BATCH = 5000; // log rows per transaction
+$PAUSE = 50000; // us between transactions, writers of daemon get their turn
+$TIMEZONE="Europe/Warsaw";
+
+date_default_timezone_set($TIMEZONE);
+
+$db = new SQLite3($FILE);
+$db->busyTimeout(10000);
+$version = $db->querySingle("PRAGMA user_version");
+if ($version>=DB_VERSION) die("$FILE has schema v$version already\n");
+dbPragmas($db);
+$db->busyTimeout(10000);
+$mode = $db->querySingle("PRAGMA journal_mode");
+if ($mode!="wal") echo "journal mode $mode (other connection open), daemon of v2 sets WAL\n";
+
+// first failure rolls back open transaction and stops, database stays v1
+function fail($db,$err) {
+    @$db->exec("ROLLBACK");
+    die("migration failed: $err\n");
+}
+
+// statement of migration, checked
+function step($db,$sql) {
+    if (!@$db->exec($sql)) fail($db,$db->lastErrorMsg()."\n  in: ".preg_replace('/\s+/',' ',$sql));
+}
+
+function tableExists($db,$name) {
+    return $db->querySingle("SELECT count(*) FROM sqlite_master WHERE type='table' AND name='$name'")>0;
+}
+
+// one row per (addr,idx), newest of duplicates wins
+function kvMigrate($db,$name) {
+    if (!tableExists($db,$name)) return; // created by dbTables
+    step($db,"BEGIN IMMEDIATE");
+    step($db,"DROP TABLE IF EXISTS {$name}_v2");
+    step($db,"CREATE TABLE {$name}_v2 (
+        addr INTEGER,
+        idx INTEGER,
+        time INTEGER,
+        value INTEGER,
+        PRIMARY KEY (addr,idx)) WITHOUT ROWID");
+    step($db,"INSERT OR REPLACE INTO {$name}_v2 (addr,idx,time,value) SELECT addr,idx,time,value FROM $name ORDER BY id");
+    step($db,"DROP TABLE $name");
+    step($db,"ALTER TABLE {$name}_v2 RENAME TO $name");
+    if ($name=="trace") step($db,"CREATE INDEX _trace_time_addr on trace (time,addr)");
+    step($db,"COMMIT");
+    echo "$name: ".$db->querySingle("SELECT count(*) FROM $name")." rows\n";
+}
+
+// same columns, primary key table without rowid; tables of databases
+// older than the table are created by dbTables
+function pkMigrate($db,$name,$create,$cols) {
+    if (!tableExists($db,$name)) return;
+    step($db,"BEGIN IMMEDIATE");
+    step($db,"DROP TABLE IF EXISTS {$name}_v2");
+    step($db,str_replace("TABLE $name ","TABLE {$name}_v2 ",$create));
+    step($db,"INSERT OR REPLACE INTO {$name}_v2 ($cols) SELECT $cols FROM $name");
+    step($db,"DROP TABLE $name");
+    step($db,"ALTER TABLE {$name}_v2 RENAME TO $name");
+    step($db,"COMMIT");
+    echo "$name: without rowid\n";
+}
+
+function copyLog($db,$last,$limit) {
+    // rows after id last to their month, returns id of last copied row;
+    // id is kept, run again after a failure skips rows copied before
+    $result = $db->query("SELECT * FROM log WHERE id>$last ORDER BY id".(($limit>0) ? " LIMIT $limit" : ""));
+    if ($result===false) fail($db,$db->lastErrorMsg()."\n  in: select from log");
+    $stmt = array();
+    $cols = array('id','addr','time','mode','valve','real','wanted','battery','error','window','force');
+    while ($row = $result->fetchArray(SQLITE3_ASSOC)) {
+        $t = logPartition($db,$row['time']);
+        if (!isset($stmt[$t])) $stmt[$t] = $db->prepare("INSERT OR IGNORE INTO $t (".implode(",",$cols).") VALUES (:".implode(",:",$cols).")");
+        foreach ($cols as $c) $stmt[$t]->bindValue(":$c",$row[$c]);
+        if (!@$stmt[$t]->execute()) fail($db,$db->lastErrorMsg()."\n  in: insert into $t");
+        $stmt[$t]->reset();
+        $last = $row['id'];
+    }
+    return $last;
+}
+
+foreach (array('eeprom','timers','trace') as $t) kvMigrate($db,$t);
+pkMigrate($db,"afc_hist","CREATE TABLE afc_hist (
+    addr INTEGER,
+    afc INTEGER,
+    count INTEGER,
+    PRIMARY KEY (addr,afc)) WITHOUT ROWID","addr,afc,count");
+pkMigrate($db,"timer_proposals","CREATE TABLE timer_proposals (
+    addr INTEGER,
+    idx INTEGER,
+    value INTEGER,
+    time INTEGER,
+    overrides INTEGER,
+    PRIMARY KEY (addr,idx)) WITHOUT ROWID","addr,idx,value,time,overrides");
+
+// log in batches while daemon keeps appending, switch with the rest
+$last = 0;
+$total = $db->querySingle("SELECT count(*) FROM log");
+while (true) {
+    step($db,"BEGIN IMMEDIATE");
+    $n = $last;
+    $last = copyLog($db,$last,$BATCH);
+    step($db,"COMMIT");
+    if ($last==$n) break;
+    echo "log: copied up to id $last of about $total rows\r";
+    usleep($PAUSE);
+}
+step($db,"BEGIN IMMEDIATE");
+$last = copyLog($db,$last,0);
+step($db,"ALTER TABLE log RENAME TO log_v1");
+dbTables($db); // tables added after v1: link_stats, firmware, ota, detect, alerts, ...
+logView($db);
+foreach (array('debug_log','timers','eeprom','trace','command_queue','versions','link_stats','afc_hist',
+    'firmware','ota','detect','alerts','timer_proposals') as $t)
+    if (!tableExists($db,$t)) fail($db,"table $t not created: ".$db->lastErrorMsg());
+if (!$db->querySingle("SELECT count(*) FROM sqlite_master WHERE type='view' AND name='log'")) fail($db,"view log not created");
+step($db,"PRAGMA user_version=".DB_VERSION);
+step($db,"COMMIT");
+echo "\nlog: view over ".$db->querySingle("SELECT count(*) FROM sqlite_master WHERE type='table' AND name GLOB 'log_[0-9]*'")
+    ." monthly tables, ".$db->querySingle("SELECT count(*) FROM log")." rows\n";
+step($db,"DROP TABLE log_v1");
+echo "done, restart daemon.php; free pages stay in file until VACUUM\n";
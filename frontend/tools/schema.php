@@ -0,0 +1,164 @@
+<?php
+
+// Database schema v2, shared by create_db.php, migrate_db.php, daemon.php
+// and learn_timers.php.
+//
+// Table log is a view over monthly tables log_YYYYMM, writers insert into
+// table of month of the record (logPartition), old months can be dropped
+// as whole tables. Insert into view goes to newest month by a trigger,
+// pages and tools read the view.
+
+define('DB_VERSION',2); // PRAGMA user_version
+define('DB_WAL_PAGES',1000); // WAL is checkpointed by commit reaching this size
+define('DB_WAL_LIMIT',4*1024*1024); // bytes, WAL file is truncated to it after checkpoint
+
+// connection settings of writers, WAL itself is stored in database file
+function dbPragmas($db) {
+    $db->busyTimeout(3000);
+    $db->query("PRAGMA journal_mode=WAL");
+    $db->query("PRAGMA synchronous=NORMAL"); // WAL: crash loses last commits only, never corrupts
+    $db->query("PRAGMA wal_autocheckpoint=".DB_WAL_PAGES);
+    $db->query("PRAGMA journal_size_limit=".DB_WAL_LIMIT);
+}
+
+// tables with one row per (addr,idx), written by upsert
+function kvTable($db,$name) {
+    $db->query("CREATE TABLE IF NOT EXISTS $name (
+        addr INTEGER,
+        idx INTEGER,
+        time INTEGER,
+        value INTEGER,
+        PRIMARY KEY (addr,idx)) WITHOUT ROWID");
+}
+
+// all tables of v2, existing ones are kept (database of migrate_db.php)
+function dbTables($db) {
+    $db->query("CREATE TABLE IF NOT EXISTS debug_log (
+        id INTEGER PRIMARY KEY,
+        time INTEGER,
+        addr INTEGER,
+        data CHAR(80))");
+    $db->query("CREATE INDEX IF NOT EXISTS debug_time_addr on debug_log (time,addr)");
+
+    // view log over tables log_YYYYMM
+    logPartition($db,time());
+
+    kvTable($db,"timers");
+    kvTable($db,"eeprom");
+    kvTable($db,"trace");
+    $db->query("CREATE INDEX IF NOT EXISTS _trace_time_addr on trace (time,addr)");
+
+    $db->query("CREATE TABLE IF NOT EXISTS command_queue (
+        id INTEGER PRIMARY KEY,
+        addr INTEGER,
+        time INTEGER,
+        send INTEGER DEFAULT 0,
+        data char(20) )");
+    $db->query("CREATE INDEX IF NOT EXISTS command_time_addr on command_queue (time,addr)");
+
+    $db->query("CREATE TABLE IF NOT EXISTS versions (
+        addr INTEGER PRIMARY KEY,
+        time INTEGER,
+        data char(80))");
+
+    $db->query("CREATE TABLE IF NOT EXISTS link_stats (
+        addr INTEGER PRIMARY KEY,
+        time INTEGER,
+        ok INTEGER DEFAULT 0,
+        err INTEGER DEFAULT 0,
+        missed INTEGER DEFAULT 0,
+        raw_ok INTEGER DEFAULT 0,
+        raw_err INTEGER DEFAULT 0,
+        raw_missed INTEGER DEFAULT 0,
+        quality INTEGER DEFAULT 100,
+        afc INTEGER,
+        afc_min INTEGER,
+        afc_max INTEGER,
+        freq_trim INTEGER DEFAULT 0)");
+
+    $db->query("CREATE TABLE IF NOT EXISTS afc_hist (
+        addr INTEGER,
+        afc INTEGER,
+        count INTEGER,
+        PRIMARY KEY (addr,afc)) WITHOUT ROWID");
+
+    // firmware images for RF bootloader, image is application binary (objcopy -O binary)
+    $db->query("CREATE TABLE IF NOT EXISTS firmware (
+        id INTEGER PRIMARY KEY,
+        time INTEGER,
+        name CHAR(80),
+        image BLOB)");
+
+    // update rollout, row with state 'new' is started when no other is running
+    $db->query("CREATE TABLE IF NOT EXISTS ota (
+        addr INTEGER PRIMARY KEY,
+        firmware INTEGER,
+        time INTEGER,
+        state CHAR(10) DEFAULT 'new',
+        chunk INTEGER DEFAULT 0)");
+
+    // state of online detectors in daemon.php, JSON of fixed size per device
+    $db->query("CREATE TABLE IF NOT EXISTS detect (
+        addr INTEGER PRIMARY KEY,
+        time INTEGER,
+        state TEXT)");
+
+    // detected problems, cleared is time of recovery or of manual clear (0 = open)
+    $db->query("CREATE TABLE IF NOT EXISTS alerts (
+        id INTEGER PRIMARY KEY,
+        addr INTEGER,
+        time INTEGER,
+        last INTEGER,
+        type CHAR(10),
+        text CHAR(80),
+        cleared INTEGER DEFAULT 0)");
+    $db->query("CREATE INDEX IF NOT EXISTS alerts_addr_type on alerts (addr,type,cleared)");
+
+    // timer programs learned by learn_timers.php, idx as in timers, idx 255 is timer_mode
+    $db->query("CREATE TABLE IF NOT EXISTS timer_proposals (
+        addr INTEGER,
+        idx INTEGER,
+        value INTEGER,
+        time INTEGER,
+        overrides INTEGER,
+        PRIMARY KEY (addr,idx)) WITHOUT ROWID");
+}
+
+// table of month of time, created on first use
+function logPartition($db,$time) {
+    static $known=array();
+    $name = "log_".date('Ym',$time);
+    if (isset($known[$name])) return $name;
+    if (!$db->querySingle("SELECT count(*) FROM sqlite_master WHERE type='table' AND name='$name'")) {
+        $db->query("CREATE TABLE $name (
+            id INTEGER PRIMARY KEY,
+            addr INTEGER,
+            time INTEGER,
+            mode CHAR(10),
+            valve INTEGER,
+            real INTEGER,
+            wanted INTEGER,
+            battery INTEGER,
+            error INTEGER DEFAULT 0,
+            window INTEGER DEFAULT 0,
+            force INTEGER DEFAULT 0)");
+        $db->query("CREATE INDEX {$name}_addr_time on $name (addr,time)");
+        logView($db);
+    }
+    $known[$name]=true;
+    return $name;
+}
+
+// view log over all months; not while v1 table log exists (migration)
+function logView($db) {
+    if ($db->querySingle("SELECT count(*) FROM sqlite_master WHERE type='table' AND name='log'")) return;
+    $parts = array();
+    $result = $db->query("SELECT name FROM sqlite_master WHERE type='table' AND name GLOB 'log_[0-9]*' ORDER BY name");
+    while ($row = $result->fetchArray()) $parts[] = $row['name'];
+    if (count($parts)==0) return;
+    $cols = "addr,time,mode,valve,real,wanted,battery,error,window,force";
+    $db->query("DROP VIEW IF EXISTS log");
+    $db->query("CREATE VIEW log AS SELECT * FROM ".implode(" UNION ALL SELECT * FROM ",$parts));
+    $db->query("CREATE TRIGGER log_insert INSTEAD OF INSERT ON log BEGIN "
+        ."INSERT INTO ".end($parts)." ($cols) VALUES (NEW.".str_replace(",",",NEW.",$cols)."); END");
+}
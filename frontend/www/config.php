@@ -1,6 +1,7 @@
 <?php
 
 $db = new SQLite3("/tmp/openhr20.sqlite");
+$db->busyTimeout(3000); // daemon commits its writes in batches
 $TIMEZONE="Europe/Warsaw";
 $RRD_ENABLE=true;
 $PLOTS_DIR = "plots";
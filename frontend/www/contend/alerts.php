@@ -0,0 +1,47 @@
+<?php
+
+class contend_alerts extends contend {
+
+  public function controller() {
+    global $db,$_GET;
+    // manual clear, alert opens again when detector still sees the problem
+    $clear_id = (int)($_GET['clear_id']);
+    if ($clear_id>0) {
+	$db->query("UPDATE alerts SET cleared=".time()." WHERE id=$clear_id AND cleared=0");
+    }
+    return null;
+  }
+
+  public function view() {
+    global $db,$_GET,$room_name;
+
+    $limit = (int)($_GET['limit']);
+    if ($limit<=0) $limit=50;
+
+    if ($this->addr) {
+	$where= ' WHERE addr='. $this->addr;
+    } else {
+	$where='';
+    }
+
+    // open alerts first, then recently cleared
+    $result = $db->query("SELECT * FROM alerts$where ORDER BY cleared>0, last DESC LIMIT $limit");
+
+    echo "<table>";
+    echo "<tr><th>valve</th><th>type</th><th>problem</th><th>since</th><th>last seen</th><th>cleared</th><th></th></tr>";
+    while ($row = $result->fetchArray()) {
+	$a = $row['addr'];
+	$name = isset($room_name[$a]) ? $room_name[$a] : $a;
+	echo "<tr><td><a href=\"?page=history&addr=$a\">$name</a></td>";
+	echo '<td'.(($row['cleared']==0)?' class="warning"':'').'>'.$row['type'].'</td>';
+	echo '<td>'.htmlspecialchars($row['text']).'</td>';
+	echo '<td>'.format_time($row['time']).'</td><td>'.format_time($row['last']).'</td>';
+	if ($row['cleared']==0)
+	    echo "<td>-</td><td><a href=\"?page=alerts&addr=$this->addr&clear_id=".$row['id']."\">clear</a></td>";
+	else
+	    echo '<td>'.format_time($row['cleared']).'</td><td></td>';
+	echo "</tr>\n";
+    }
+    echo "</table>\n";
+  }
+}
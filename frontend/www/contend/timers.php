@@ -8,6 +8,8 @@ class contend_timers extends contend {
   private $timer_mode;
   private $temperatures=array();
   private $layout_names;
+  private $proposal=array();
+  private $overrides=0;
 
   function __construct($addr) {
       global $db;
@@ -33,6 +35,13 @@ class contend_timers extends contend {
     }
     $this->timer_mode=get_config($this->layout_names,$this->addr,'timer_mode');
     
+    // program learned from manual overrides (tools/learn_timers.php)
+    $result = $db->query("SELECT idx,value,overrides FROM timer_proposals WHERE addr=$this->addr");
+    while ($row = $result->fetchArray()) {
+	$this->proposal[$row['idx']]=$row['value'];
+	$this->overrides=$row['overrides'];
+    }
+
     for ($i=0;$i<4;$i++) {
       $c = get_config($this->layout_names,$this->addr,'temperature'.$i);
       if ($c != 'NA') $this->temperatures[$i] = $c;
@@ -41,7 +50,24 @@ class contend_timers extends contend {
   }
 
   public function controller() {
-  
+    global $db;
+
+    if (isset($_POST['proposal'])) {
+      $cmd=null;
+      if ($_POST['proposal']=='apply') {
+	// only slots which differ from known table
+	foreach ($this->proposal as $idx=>$v) {
+	  if ($idx==255) {
+	    if ($v != $this->timer_mode) $cmd[] = sprintf("S%02x%02x",$this->layout_names['timer_mode'],$v);
+	  } else if (!isset($this->timers[$idx>>4][$idx&0xf]) || ($this->timers[$idx>>4][$idx&0xf] != $v)) {
+	    $cmd[] = sprintf("W%d%d%04x",$idx>>4,$idx&0xf,$v);
+	  }
+	}
+      }
+      $db->query("DELETE FROM timer_proposals WHERE addr=$this->addr");
+      $this->proposal=array();
+      return $cmd;
+    }
     if (!isset($_POST['temp_0'])) return;
     $cmd=null;
     //timmer table
@@ -86,6 +112,20 @@ class contend_timers extends contend {
     return $cmd;
   }
 
+  private function proposal_row($i) {
+    global $timer_names,$symbols;
+    echo '<tr><td>'.$timer_names[$i].'</td>';
+    for ($j=0; $j<8; $j++) {
+	$x = $this->proposal[($i<<4)|$j];
+	$changed = !isset($this->timers[$i][$j]) || ($this->timers[$i][$j] != $x);
+	echo '<td'.($changed?' class="warning"':'').'>';
+	if (($x&0xfff) < 24*60)
+	  printf("%s %02d:%02d",$symbols[$x>>12],(int)(($x&0xfff)/60),(int)(($x&0xfff)%60));
+	echo '</td>';
+    }
+    echo '</tr>';
+  }
+
   private function table_row($i) {
     global $timer_names,$symbols;
     echo '<tr><td>'.$timer_names[$i].'</td>';
@@ -151,6 +191,21 @@ class contend_timers extends contend {
       echo '<input type="reset" value="Reset">';
       echo '<input type="submit" value="Submit">';
       echo "</form>";
+
+      if (count($this->proposal)>0) {
+	echo '<h2>Learned program</h2>';
+	echo "<div>from $this->overrides manual overrides, changed slots are marked";
+	if (isset($this->proposal[255])) echo ', switches to individual program for week day';
+	echo '</div><table>';
+	for ($i=0; $i<8; $i++) {
+	  if (isset($this->proposal[$i<<4])) $this->proposal_row($i);
+	}
+	echo '</table>';
+	echo '<form method="post" action="?page=timers&amp;addr='.$this->addr.'">';
+	echo '<button type="submit" name="proposal" value="apply">Apply</button>';
+	echo '<button type="submit" name="proposal" value="discard">Discard</button>';
+	echo "</form>";
+      }
   }
 }
-        
+        
@@ -6,6 +6,7 @@
     array( 0 => false, 'page'=>'eeprom', 'text' => 'setting'),
     array( 0 => false, 'page'=>'trace', 'text' => 'trace points'),
     array( 0 => true, 'page'=>'queue', 'text' => 'queue'),
+    array( 0 => true, 'page'=>'alerts', 'text' => 'alerts'),
     array( 0 => true, 'page'=>'debug_log', 'text' => 'Debug LOG'),
     array( 0 => false, 'page'=>'raw_command_queue', 'text' => 'command queue - RAW'),
   );
@@ -43,6 +43,12 @@
 //define uart buffer's length
 #define BUFFERSIZE         128
 
+//RF mode: pull firmware from OpenHR20 master when application requested it
+//set by Makefile, see rfboot.h
+#ifndef RFBOOT
+#define RFBOOT             0
+#endif
+
 //system clock(Hz)
 #ifndef F_CPU
 #define F_CPU              8000000UL
@@ -53,8 +59,12 @@
 
 //Boot section start address(byte)
 //define BootStart to 0 will disable this function
+#if RFBOOT
+//RF mode (rfboot.c) needs whole 2kB boot section
+#define BootStart          0x1C00 * 2
+#else
 #define BootStart          0x1E00 * 2
-//#define BootStart          0x1C00 * 2
+#endif
 
 //verify flash's data while write
 //ChipCheck will only take effect while BootStart enable also
@@ -111,6 +121,10 @@ unsigned char KEY[] = {0x64};
 //communication checksum method   0:CRC16  1:add up
 #define CRCMODE            0
 
+//page delta mode: host reads CRC of each page, sends changed pages only
+//needs CRCMODE 0 and BootStart, host tool tools/hr20flash
+#define DELTAMODE          1
+
 //Verbose mode: display more prompt message
 #define VERBOSE            0
 
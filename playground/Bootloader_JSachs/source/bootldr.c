@@ -37,6 +37,9 @@
 
 #include "bootcfg.h"
 #include "bootldr.h"
+#if RFBOOT
+#include "rfboot.h"
+#endif
 
 //user's application start address
 #define PROG_START         0x0000
@@ -121,6 +124,23 @@ void putstr(const char *str)
 }
 #endif
 
+#if CRCMODE == 0
+//CRC1021 lookup table for one nibble, 32 bytes of flash instead of 512
+const unsigned int crctab[16] PROGMEM =
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+//add one byte to CRC1021 checksum
+unsigned int crc16_update(unsigned int crc, unsigned char dat)
+{
+  crc = (crc << 4) ^ pgm_read_word(&crctab[(crc >> 12) ^ (dat >> 4)]);
+  crc = (crc << 4) ^ pgm_read_word(&crctab[(crc >> 12) ^ (dat & 0x0F)]);
+  return crc;
+}
+#endif
+
 //calculate CRC checksum
 #if BUFSIZE > 255
 void crc16(unsigned char *buf)
@@ -132,10 +152,6 @@ void crc16(unsigned char *buf)
   unsigned char j;
 #endif
 
-#if CRCMODE == 0
-  unsigned char i;
-  unsigned int t;
-#endif
   unsigned int crc;
 
   crc = 0;
@@ -143,14 +159,7 @@ void crc16(unsigned char *buf)
   {
 #if CRCMODE == 0
     //CRC1021 checksum
-    crc = (crc ^ (((unsigned int) *buf) << 8));
-    for(i = 8; i > 0; i--)
-    {
-      t = crc << 1;
-      if(crc & 0x8000)
-        t = t ^ 0x1021;
-      crc = t;
-    }
+    crc = crc16_update(crc, *buf);
 #elif CRCMODE == 1
     //word add up checksum
     crc += (unsigned int)(*buf);
@@ -163,6 +172,77 @@ void crc16(unsigned char *buf)
   cl = crc % 256;
 }
 
+#if DELTAMODE
+//page delta transfer, unchanged pages are neither sent nor written
+void delta(void)
+{
+  unsigned char page;
+  unsigned int crc;
+
+  //close timer1
+  TCCR1B = 0;
+
+  WriteCom(BootStart / SPM_PAGESIZE);
+  WriteCom(SPM_PAGESIZE / 2);
+  boot_rww_enable();
+  for(FlashAddr = 0; FlashAddr < BootStart; FlashAddr += SPM_PAGESIZE)
+  {
+    crc = 0;
+    for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr++)
+      crc = crc16_update(crc, pgm_read_byte(FlashAddr + pagptr));
+    WriteCom(crc / 256);
+    WriteCom(crc % 256);
+  }
+
+  while(1)
+  {
+#if WDGEn
+    wdt_reset();
+#endif
+    //frame start, after a lost byte the rest of the frame is skipped here
+    if(WaitCom() != DELTA_SOF)
+      continue;
+    page = WaitCom();
+    if(WaitCom() != (unsigned char)~page)
+      continue;
+    //page number is in CRC, corrupted number is not written to other page
+    crc = crc16_update(0, page);
+    if(page != DELTA_END)
+    {
+      for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr++)
+      {
+        buf[pagptr] = WaitCom();
+        crc = crc16_update(crc, buf[pagptr]);
+      }
+    }
+    ch = WaitCom();
+    cl = WaitCom();
+    if((ch != crc / 256) || (cl != crc % 256))
+    {
+      WriteCom(XMODEM_NAK);
+      continue;
+    }
+    if(page == DELTA_END)
+      break;
+    if(page < BootStart / SPM_PAGESIZE)
+    {
+      FlashAddr = (unsigned int)page * SPM_PAGESIZE;
+      write_one_page(buf);
+      WriteCom(XMODEM_ACK);
+    }
+    else
+    {
+      WriteCom(XMODEM_NAK);
+    }
+#if LEDEn
+    LEDAlt();
+#endif
+  }
+  WriteCom(XMODEM_ACK);
+  quit();
+}
+#endif
+
 int main(void)
 {
   unsigned char cnt;
@@ -184,6 +264,16 @@ int main(void)
   //disable interrupt
   __asm__ __volatile__("cli": : );
 
+#if RFBOOT
+  //watchdog stays on after reset by application
+  MCUSR = 0;
+  wdt_disable();
+
+  //update requested by application, rfboot() does not return
+  if(rfboot_pending())
+    rfboot();
+#endif
+
 #if WDGEn
   //if enable watchdog, setup timeout
   wdt_enable(WDTO_1S);
@@ -326,8 +416,13 @@ int main(void)
 
     if(DataInCom())
     {
-      if(ReadCom() == XMODEM_SOH)  //XMODEM command <soh>
+      ch = ReadCom();
+      if(ch == XMODEM_SOH)         //XMODEM command <soh>
         break;
+#if DELTAMODE
+      if(ch == DELTA_CMD)          //page delta command, does not return
+        delta();
+#endif
     }
   }
   //close timer1
@@ -192,6 +192,21 @@ const char msg5[] = "update fail.";
 #define XMODEM_EOF         0x1A
 #define XMODEM_RWC         'C'
 
+//page delta command, instead of <soh>
+//boot -> host: page count, page size / 2, CRC16 of each page (high, low)
+//host -> boot: DELTA_SOF, page number, ~page number, page data, CRC16 of
+//              page number and data; boot answers <ack> or <nak>
+//host -> boot: DELTA_SOF, DELTA_END, ~DELTA_END, CRC16 of DELTA_END;
+//              boot answers <ack> and starts application
+//bytes outside of a frame are skipped, boot is silent on a bad frame start
+#define DELTA_CMD          'P'
+#define DELTA_SOF          XMODEM_SOH
+#define DELTA_END          0xFF
+
+#if DELTAMODE && ((CRCMODE != 0) || (BootStart == 0))
+#error "DELTAMODE needs CRCMODE 0 and BootStart"
+#endif
+
 #if RS485
 #define RS485Enable()      PORTREG(RS485PORT) |= (1 << RS485TXEn)
 #define RS485Disable()     PORTREG(RS485PORT) &= ~(1 << RS485TXEn)
@@ -0,0 +1,521 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 @ 4 MHz in Honnywell Rondostat HR20E
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       rfboot.c
+ * \brief      RF mode of bootloader, pulls firmware image from master
+ *
+ * Application stores update request to EEPROM (see common/ota.h) and
+ * resets. Bootloader requests image chunk by chunk, writes each complete
+ * page and stores the page count, transfer continues after reset. Radio
+ * is polled, no interrupts are used.
+ *
+ * Application is started only after CMAC of whole flash image matches
+ * trailer. When master is not reachable and flash was not touched yet,
+ * the old application is started after RFB_GIVE_UP ticks.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "rfboot.h"
+#include "common/ota.h"
+#include "common/xtea.h"
+#include "common/rfm.h"
+
+#define RFB_PAGE_CHUNKS (OTA_PAGE / OTA_CHUNK)
+#define RFB_FRAME_MIN (1 + 1 + OTA_HDR + 4)     //!< length, address, header, MAC
+#define RFB_DATA (2 + OTA_HDR)                  //!< data offset in received frame
+
+static uint8_t rfb_frame[4 + RFB_FRAME_MIN + OTA_CHUNK + 2];
+static uint8_t rfb_keys[3 * 8];                 //!< K_mac is first 16 bytes
+static uint8_t rfb_k1[8];
+static uint8_t rfb_k2[8];
+static uint16_t rfb_idle;                       //!< ticks without progress
+
+static const uint8_t rfb_header[4] PROGMEM = { 0xaa, 0xaa, 0x2d, 0xd4 };
+static const uint8_t rfb_km_upper[8] PROGMEM = {
+	0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef
+};
+
+// data rate, receiver bandwidth and TX deviation, same as common/rfm.c
+static const uint16_t rfb_rate_table[RFM_RATE_COUNT][3] PROGMEM = {
+	{ RFM_SET_DATARATE(9600), RFM_RX_CONTROL_BW(9600), RFM_TX_CONTROL_MOD(9600) },
+	{ RFM_SET_DATARATE(19200), RFM_RX_CONTROL_BW(19200), RFM_TX_CONTROL_MOD(19200) },
+	{ RFM_SET_DATARATE(38400), RFM_RX_CONTROL_BW(38400), RFM_TX_CONTROL_MOD(38400) },
+	{ RFM_SET_DATARATE(57600), RFM_RX_CONTROL_BW(57600), RFM_TX_CONTROL_MOD(57600) }
+};
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/boot.h>
+#include "src/rfm_config.h"
+
+/*!
+ *******************************************************************************
+ *  RFM pins and timer1 as tick source
+ ******************************************************************************/
+void rfb_init(void)
+{
+	RFM_SPI_DESELECT;
+	RFM_NSEL_DDR |= _BV(RFM_NSEL_BITPOS);
+	RFM_SCK_DDR |= _BV(RFM_SCK_BITPOS);
+	RFM_SDI_DDR |= _BV(RFM_SDI_BITPOS);
+
+	// CTC mode, prescaler 1024
+	OCR1A = F_CPU / 1024 / RFB_TICK_HZ - 1;
+	TCCR1A = 0;
+	TCCR1B = _BV(WGM12) | _BV(CS12) | _BV(CS10);
+}
+
+bool rfb_tick(void)
+{
+	if (TIFR1 & _BV(OCF1A))
+	{
+		TIFR1 = _BV(OCF1A);
+		return true;
+	}
+	return false;
+}
+
+uint8_t rfb_ee_read(uint8_t ofs)
+{
+	return eeprom_read_byte((uint8_t *)(OTA_EE_ADDR + ofs));
+}
+
+void rfb_ee_write(uint8_t ofs, uint8_t val)
+{
+	eeprom_write_byte((uint8_t *)(OTA_EE_ADDR + ofs), val);
+	eeprom_busy_wait(); // SPM must not start during EEPROM write
+}
+
+uint8_t rfb_flash_read(uint16_t addr)
+{
+	return pgm_read_byte(addr);
+}
+
+void rfb_flash_enable(void)
+{
+	boot_rww_enable();
+}
+
+/*!
+ *******************************************************************************
+ *  RFM SPI access, same as common/rfm.c
+ ******************************************************************************/
+uint16_t rfm_spi16(uint16_t outval)
+{
+	uint8_t i;
+	uint16_t ret = 0;
+
+	RFM_SPI_SELECT;
+	for (i = 16; i != 0; i--)
+	{
+		if (0x8000 & outval)
+		{
+			RFM_SPI_MOSI_HIGH;
+		}
+		else
+		{
+			RFM_SPI_MOSI_LOW;
+		}
+		outval <<= 1;
+		RFM_SPI_SCK_HIGH;
+		ret <<= 1;
+		if (RFM_SPI_MISO_GET)
+		{
+			ret |= 1;
+		}
+		RFM_SPI_SCK_LOW;
+	}
+	RFM_SPI_DESELECT;
+	return ret;
+}
+#endif // defined(__AVR__)
+
+/*!
+ *******************************************************************************
+ *  left roll of 8 bytes, same as left_roll in common/wireless.c
+ ******************************************************************************/
+static void rfb_roll(uint8_t *d, const uint8_t *s)
+{
+	uint8_t i;
+	uint8_t c = s[7] >> 7;
+
+	for (i = 0; i < 8; i++)
+	{
+		uint8_t t = s[i];
+		d[i] = (t << 1) | c;
+		c = t >> 7;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  derive keys from security key copy, same as crypto_init
+ ******************************************************************************/
+static void rfb_crypto_init(void)
+{
+	uint8_t km[16];
+	uint8_t i;
+
+	for (i = 0; i < 8; i++)
+	{
+		km[i] = rfb_ee_read(OTA_EE_KEY + i);
+	}
+	memcpy_P(km + 8, rfb_km_upper, 8);
+	for (i = 0; i < 3 * 8; i++)
+	{
+		rfb_keys[i] = 0xc0 + i;
+	}
+	for (i = 0; i < 3 * 8; i += 8)
+	{
+		xtea_enc(rfb_keys + i, rfb_keys + i, km);
+	}
+	memset(rfb_k1, 0, 8);
+	xtea_enc(rfb_k1, rfb_k1, rfb_keys);
+	rfb_roll(rfb_k1, rfb_k1);
+	rfb_roll(rfb_k2, rfb_k1);
+}
+
+/*!
+ *******************************************************************************
+ *  CMAC without prefix, like cmac_calc(m, bytes, NULL, ...)
+ *
+ *  \param m message, NULL for application flash from address 0
+ *  \note 16 bit length covers whole application
+ ******************************************************************************/
+static void rfb_cmac(uint8_t *mac, const uint8_t *m, uint16_t bytes)
+{
+	uint16_t i, x;
+	uint8_t j;
+
+	memset(mac, 0, 8);
+	for (i = 0; i < bytes; )   // i modification inside loop
+	{
+		x = i;
+		i += 8;
+		for (j = 0; j < 8; j++, x++)
+		{
+			uint8_t tmp;
+			if (x < bytes)
+			{
+				tmp = (m != NULL) ? m[x] : rfb_flash_read(x);
+			}
+			else
+			{
+				tmp = ((x == bytes) ? 0x80 : 0);
+			}
+			if (i >= bytes)
+			{
+				tmp ^= ((i == bytes) ? rfb_k1 : rfb_k2)[j];
+			}
+			mac[j] ^= tmp;
+		}
+		xtea_enc(mac, mac, rfb_keys);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  RFM setup, same as RFM_init with radio settings copied by application
+ ******************************************************************************/
+static void rfb_rfm_init(void)
+{
+	uint8_t rate = rfb_ee_read(OTA_EE_RATE);
+
+	if (rate >= RFM_RATE_COUNT)
+	{
+		rate = RFM_RATE_DEFAULT;
+	}
+	RFM_READ_STATUS();
+	RFM_SPI_16(
+		RFM_CONFIG_EL |
+		RFM_CONFIG_EF |
+		RFM_CONFIG_Band(RFM_FREQ_MAIN) |
+		RFM_CONFIG_X_12_0pf
+	);
+	RFM_SPI_16(
+		RFM_FREQUENCY |
+		(RFM_FREQ_Band(RFM_FREQ_MAIN)(RFM_FREQ_DEC) + (int8_t)rfb_ee_read(OTA_EE_FREQ))
+	);
+	RFM_SPI_16(pgm_read_word(&rfb_rate_table[rate][0]));
+	RFM_SPI_16(
+		RFM_RX_CONTROL_P20_VDI  |
+		RFM_RX_CONTROL_VDI_MED |
+		pgm_read_word(&rfb_rate_table[rate][1]) |
+		RFM_RX_CONTROL_GAIN_6   |
+		RFM_RX_CONTROL_RSSI_103
+	);
+	RFM_SPI_16(RFM_DATA_FILTER_DQD(4));
+	RFM_SPI_16(RFM_FIFO_IT(8) | RFM_FIFO_DR);
+	RFM_SPI_16(
+		RFM_AFC_AUTO_VDI |
+		RFM_AFC_RANGE_LIMIT_7_8 |
+		RFM_AFC_EN |
+		RFM_AFC_OE |
+		RFM_AFC_FI
+	);
+	RFM_SPI_16(
+		pgm_read_word(&rfb_rate_table[rate][2]) |
+		RFM_TX_CONTROL_POW_0
+	);
+	RFM_SPI_16(
+		RFM_PLL |
+		RFM_PLL_uC_CLK_10 |
+		RFM_PLL_DELAY_OFF |
+		RFM_PLL_DITHER_OFF |
+		RFM_PLL_BIRATE_LOW
+	);
+}
+
+/*!
+ *******************************************************************************
+ *  next tick, counts time without progress
+ ******************************************************************************/
+static bool rfb_next_tick(void)
+{
+	if (rfb_tick())
+	{
+		if (rfb_idle != 0xffff)
+		{
+			rfb_idle++;
+		}
+		return true;
+	}
+	return false;
+}
+
+static void rfb_wait(uint8_t ticks)
+{
+	while (ticks != 0)
+	{
+		if (rfb_next_tick())
+		{
+			ticks--;
+		}
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  send chunk request
+ ******************************************************************************/
+static void rfb_request(uint8_t addr, uint8_t id, uint16_t chunk)
+{
+	uint8_t i;
+
+	memcpy_P(rfb_frame, rfb_header, 4);
+	rfb_frame[4] = RFB_FRAME_MIN;
+	rfb_frame[5] = addr | OTA_ADDR_FLAG;
+	rfb_frame[6] = OTA_REQ;
+	rfb_frame[7] = id;
+	rfb_frame[8] = chunk >> 8;
+	rfb_frame[9] = chunk & 0xff;
+	rfb_frame[10] = 0;
+	rfb_cmac(rfb_frame + 11, rfb_frame + 5, 1 + OTA_HDR);
+	rfb_frame[15] = 0xaa; // 2 dummy
+	rfb_frame[16] = 0xaa;
+
+	RFM_TX_ON_PRE();
+	RFM_TX_ON();
+	for (i = 0; i < 4 + RFB_FRAME_MIN + 2; i++)
+	{
+		while (!(RFM_READ_STATUS() & RFM_STATUS_RGIT))
+		{
+			;
+		}
+		RFM_WRITE(rfb_frame[i]);
+	}
+	while (!(RFM_READ_STATUS() & RFM_STATUS_RGIT))
+	{
+		;
+	}
+	RFM_OFF();
+}
+
+/*!
+ *******************************************************************************
+ *  wait for reply to chunk request
+ *
+ *  \returns frame type, 0 when no valid reply; data from RFB_DATA
+ ******************************************************************************/
+static uint8_t rfb_receive(uint8_t addr, uint8_t id, uint16_t chunk)
+{
+	uint8_t wait = RFB_REPLY_WAIT;
+	uint8_t pos = 0;
+
+	RFM_FIFO_OFF();
+	RFM_FIFO_ON();
+	RFM_RX_ON();
+	while (wait != 0)
+	{
+		if (rfb_next_tick())
+		{
+			wait--;
+		}
+		if (!(RFM_READ_STATUS() & RFM_STATUS_FFIT))
+		{
+			continue;
+		}
+		rfb_frame[pos++] = RFM_READ_FIFO();
+		if ((rfb_frame[0] < RFB_FRAME_MIN) || (rfb_frame[0] > RFB_FRAME_MIN + OTA_CHUNK))
+		{
+			pos = 0; // noise, restart sync pattern search
+		}
+		else if (pos < rfb_frame[0])
+		{
+			continue;
+		}
+		else
+		{
+			uint8_t mac[8];
+			uint8_t len = rfb_frame[0];
+			pos = 0;
+			rfb_cmac(mac, rfb_frame + 1, len - 1 - 4);
+			if ((memcmp(mac, rfb_frame + len - 4, 4) == 0)
+			    && (rfb_frame[1] == (addr | OTA_ADDR_FLAG))
+			    && (rfb_frame[3] == id)
+			    && (rfb_frame[4] == (chunk >> 8))
+			    && (rfb_frame[5] == (chunk & 0xff))
+			    && ((rfb_frame[2] == OTA_WAIT)
+				|| ((rfb_frame[2] == OTA_DATA) && (len == RFB_FRAME_MIN + OTA_CHUNK))))
+			{
+				RFM_OFF();
+				return rfb_frame[2];
+			}
+		}
+		RFM_FIFO_OFF();
+		RFM_FIFO_ON();
+	}
+	RFM_OFF();
+	return 0;
+}
+
+/*!
+ *******************************************************************************
+ *  leave bootloader
+ ******************************************************************************/
+static void rfb_start(void)
+{
+	RFM_OFF();
+	quit();
+}
+
+bool rfboot_pending(void)
+{
+	return rfb_ee_read(OTA_EE_MAGIC) == OTA_MAGIC;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief transfer image from master, never returns
+ ******************************************************************************/
+void rfboot(void)
+{
+	uint8_t addr, id, pages, type;
+	uint16_t size, chunks, chunk;
+	bool intact;
+	uint8_t mac[8];
+
+	rfb_init();
+	size = ((uint16_t)rfb_ee_read(OTA_EE_SIZE_H) << 8) | rfb_ee_read(OTA_EE_SIZE_L);
+	if ((size == 0) || (size > OTA_APP_MAX))
+	{
+		rfb_ee_write(OTA_EE_MAGIC, 0xff);
+		rfb_start();
+	}
+	rfb_crypto_init();
+	rfb_rfm_init();
+	addr = rfb_ee_read(OTA_EE_DEVADDR);
+	id = rfb_ee_read(OTA_EE_ID);
+	chunks = OTA_CHUNKS(size);
+	pages = rfb_ee_read(OTA_EE_PAGES);
+	intact = (pages == 0);
+	if (pages == OTA_PAGES_RESTART)
+	{
+		pages = 0;
+	}
+	chunk = pages * RFB_PAGE_CHUNKS;
+	if (chunk > chunks)
+	{
+		chunk = chunks; // all pages written, trailer is missing
+	}
+	rfb_idle = 0;
+
+	while (1)
+	{
+		if (intact && (rfb_idle >= RFB_GIVE_UP))
+		{
+			// no master, keep old application
+			rfb_ee_write(OTA_EE_MAGIC, 0xff);
+			rfb_start();
+		}
+		rfb_request(addr, id, chunk);
+		type = rfb_receive(addr, id, chunk);
+		if (type == 0)
+		{
+			rfb_wait(RFB_RETRY);
+			continue;
+		}
+		if (type == OTA_DATA)
+		{
+			rfb_idle = 0;
+			if (chunk < chunks)
+			{
+				memcpy(buf + (chunk % RFB_PAGE_CHUNKS) * OTA_CHUNK, rfb_frame + RFB_DATA, OTA_CHUNK);
+				chunk++;
+				if (((chunk % RFB_PAGE_CHUNKS) == 0) || (chunk == chunks))
+				{
+					if ((chunk % RFB_PAGE_CHUNKS) != 0)
+					{
+						memset(buf + (chunk % RFB_PAGE_CHUNKS) * OTA_CHUNK, 0xff,
+						       OTA_PAGE - (chunk % RFB_PAGE_CHUNKS) * OTA_CHUNK);
+					}
+					FlashAddr = ((chunk - 1) / RFB_PAGE_CHUNKS) * OTA_PAGE;
+					write_one_page(buf);
+					intact = false;
+					rfb_ee_write(OTA_EE_PAGES, (chunk + RFB_PAGE_CHUNKS - 1) / RFB_PAGE_CHUNKS);
+				}
+			}
+			else
+			{
+				// trailer, verify whole image
+				rfb_flash_enable();
+				rfb_cmac(mac, NULL, size);
+				if (memcmp(mac, rfb_frame + RFB_DATA, 4) == 0)
+				{
+					rfb_ee_write(OTA_EE_MAGIC, 0xff);
+					rfb_start();
+				}
+				rfb_ee_write(OTA_EE_PAGES, OTA_PAGES_RESTART);
+				chunk = 0;
+			}
+		}
+		rfb_wait(rfb_frame[RFB_DATA - 1]); // hold
+	}
+}
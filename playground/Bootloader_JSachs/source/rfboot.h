@@ -0,0 +1,67 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 @ 4 MHz in Honnywell Rondostat HR20E
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       rfboot.h
+ * \brief      RF mode of bootloader, pulls firmware image from master
+ *
+ * Hardware access is split to few rfb_ functions, they are implemented
+ * in rfboot.c for AVR and in tools/softmaster/softboot.c for host test.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef RFM
+#define RFM 1
+#endif
+#ifndef RFM_CLK_OUTPUT
+#define RFM_CLK_OUTPUT 0
+#endif
+
+#define RFB_TICK_HZ 100         //!< rfb_tick() rate, same unit as hold time of master
+#define RFB_REPLY_WAIT 15       //!< ticks to wait for reply of master
+#define RFB_RETRY 50            //!< ticks to next request after no reply
+#define RFB_GIVE_UP 60000U      //!< ticks without progress, then untouched application is started
+
+// provided by bootldr.c (or softboot.c)
+extern unsigned char buf[];
+extern unsigned int FlashAddr;
+void write_one_page(unsigned char *buf);
+void quit(void);
+
+// hardware access
+void rfb_init(void);
+uint16_t rfm_spi16(uint16_t outval);
+uint8_t rfb_ee_read(uint8_t ofs);
+void rfb_ee_write(uint8_t ofs, uint8_t val);
+uint8_t rfb_flash_read(uint16_t addr);
+void rfb_flash_enable(void);
+bool rfb_tick(void);
+
+bool rfboot_pending(void);
+void rfboot(void);
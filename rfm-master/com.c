@@ -40,6 +40,7 @@
 
 #include "config.h"
 #include "main.h"
+#include "master.h"
 #include "com.h"
 #include "common/uart.h"
 #include "common/rtc.h"
@@ -47,14 +48,21 @@
 #include "task.h"
 #include "eeprom.h"
 #include "queue.h"
+#include "status.h"
+#include "relay.h"
+#include "common/ota.h"
 
 
+#ifndef TX_BUFF_SIZE
 #if defined(_AVR_IOM32_H_) || defined(__AVR_ATmega328P__)
 #define TX_BUFF_SIZE 512
 #else
 #define TX_BUFF_SIZE 256
 #endif
+#endif
+#ifndef RX_BUFF_SIZE
 #define RX_BUFF_SIZE 64
+#endif
 
 static char tx_buff[TX_BUFF_SIZE];
 static char rx_buff[RX_BUFF_SIZE];
@@ -69,7 +77,25 @@ static uint8_t tx_buff_out = 0;
 static uint8_t rx_buff_in = 0;
 static uint8_t rx_buff_out = 0;
 
-extern uint8_t onsync;
+static uint16_t com_tx_ovf = 0;         //!< chars lost on output buffer overflow
+static uint16_t com_rx_ovf = 0;         //!< chars lost on input buffer overflow
+static volatile bool com_ovf_report = false;
+
+#if (COM_XONXOFF == 1)
+#define XON  0x11
+#define XOFF 0x13
+#define RX_XOFF_LEVEL (RX_BUFF_SIZE - 16)   //!< send XOFF, host can send few more chars before it stop
+#define RX_XON_LEVEL (RX_BUFF_SIZE / 4)     //!< send XON
+static volatile bool com_rx_stopped = false;    //!< we sent XOFF
+static volatile bool com_tx_stopped = false;    //!< host sent XOFF
+static volatile char com_flow_char = '\0';      //!< XON/XOFF waiting for send, it bypass buffer
+#endif
+
+#if (STATUS_CACHE == 1)
+static uint8_t status_dump = 0; //!< next address for status dump, 0 = no dump running
+#define STATUS_LINE_MAX 96      //!< longest status dump line
+#endif
+
 
 /*!
  *******************************************************************************
@@ -87,6 +113,8 @@ static void COM_putchar(char c)
 	}
 	else
 	{
+		com_tx_ovf++;
+		com_ovf_report = true;
 		// mark end on buffer owerflow to recognize this situation
 		if (tx_buff_in == 0)
 		{
@@ -117,11 +145,33 @@ char COM_tx_char_isr(void)
 {
 	wdt_reset();
 	char c = '\0';
+#if (COM_XONXOFF == 1)
+	if (com_flow_char != '\0')
+	{
+		c = com_flow_char;
+		com_flow_char = '\0';
+		return c;
+	}
+	if (com_tx_stopped)
+	{
+		return c;
+	}
+#endif
 	if (tx_buff_in != tx_buff_out)
 	{
 		c = tx_buff[tx_buff_out++];
 		tx_buff_out %= TX_BUFF_SIZE;
 	}
+	else if (com_ovf_report)
+	{
+		task |= TASK_COM; // buffer is empty, report overflow
+	}
+#if (STATUS_CACHE == 1)
+	else if (status_dump != 0)
+	{
+		task |= TASK_COM; // buffer is empty, continue status dump
+	}
+#endif
 	return c;
 }
 
@@ -134,6 +184,14 @@ static volatile uint8_t COM_requests;
  ******************************************************************************/
 void COM_rx_char_isr(char c)
 {
+#if (COM_XONXOFF == 1)
+	if ((c == XON) || (c == XOFF))
+	{
+		com_tx_stopped = (c == XOFF);
+		task |= TASK_COM; // restart output
+		return;
+	}
+#endif
 	if (c != '\0')                          // ascii based protocol, \0 char is not alloweed, ignore it
 	{
 		if (c == '\r')
@@ -146,7 +204,18 @@ void COM_rx_char_isr(char c)
 		{
 			rx_buff_out++;
 			rx_buff_out %= RX_BUFF_SIZE;
+			com_rx_ovf++;
+			com_ovf_report = true;
 		}
+#if (COM_XONXOFF == 1)
+		if (!com_rx_stopped
+		    && ((rx_buff_in - rx_buff_out + RX_BUFF_SIZE) % RX_BUFF_SIZE >= RX_XOFF_LEVEL))
+		{
+			com_rx_stopped = true;
+			com_flow_char = XOFF;
+			task |= TASK_COM; // send XOFF
+		}
+#endif
 		if (c == '\n')
 		{
 			task |= TASK_COM;
@@ -174,6 +243,14 @@ static char COM_getchar(void)
 		{
 			COM_requests--;
 		}
+#if (COM_XONXOFF == 1)
+		if (com_rx_stopped
+		    && ((rx_buff_in - rx_buff_out + RX_BUFF_SIZE) % RX_BUFF_SIZE <= RX_XON_LEVEL))
+		{
+			com_rx_stopped = false;
+			com_flow_char = XON;
+		}
+#endif
 	}
 	else
 	{
@@ -184,6 +261,24 @@ static char COM_getchar(void)
 	return c;
 }
 
+#if (STATUS_CACHE == 1)
+/*!
+ *******************************************************************************
+ *  \brief free space in output buffer
+ *
+ *  \note
+ ******************************************************************************/
+static uint16_t COM_tx_free(void)
+{
+	uint16_t f;
+
+	cli();
+	f = (TX_BUFF_SIZE - 1 + tx_buff_out - tx_buff_in) % TX_BUFF_SIZE;
+	sei();
+	return f;
+}
+#endif
+
 /*!
  *******************************************************************************
  *  \brief flush output buffer
@@ -192,7 +287,11 @@ static char COM_getchar(void)
  ******************************************************************************/
 static void COM_flush(void)
 {
+#if (COM_XONXOFF == 1)
+	if ((tx_buff_in != tx_buff_out) || (com_flow_char != '\0'))
+#else
 	if (tx_buff_in != tx_buff_out)
+#endif
 	{
 #ifdef COM_UART
 		UART_startSend();
@@ -429,6 +528,165 @@ static void print_incomplete_mark(int8_t len)
 
 
 
+/*!
+ *******************************************************************************
+ *  \brief print flow control state
+ *
+ *  \note   F: Ccc Thhhh Rhhhh Lll Qqq Www
+ *  \note   cc free space in input buffer (credit for host), hex
+ *  \note   T/R chars lost on output/input buffer overflow since reset, hex
+ *  \note   ll busy radio channel detections before sync packet (wrap around), hex
+ *  \note   qq free command queue items, ww slots after requested one host may push, hex
+ *  \note   S is printed when master takes N command
+ *  \note printed on F command and after any overflow
+ ******************************************************************************/
+static void COM_print_flow(void)
+{
+	uint8_t credit;
+
+	cli();
+	com_ovf_report = false;
+	credit = (RX_BUFF_SIZE - 1 + rx_buff_out - rx_buff_in) % RX_BUFF_SIZE;
+	sei();
+	print_s_p(PSTR("F: C"));
+	print_hexXX(credit);
+	print_s_p(PSTR(" T"));
+	print_hexXXXX(com_tx_ovf);
+	print_s_p(PSTR(" R"));
+	print_hexXXXX(com_rx_ovf);
+#if (RFM == 1) && (WL_LBT)
+	print_s_p(PSTR(" L"));
+	print_hexXX(wl_lbt_busy);
+#endif
+	print_s_p(PSTR(" Q"));
+	print_hexXX(Q_free());
+	print_s_p(PSTR(" W"));
+	print_hexXX(Q_LOOKAHEAD);
+#if (RFM == 1) && (WL_SHARES)
+	print_s_p(PSTR(" S"));
+#endif
+	COM_putchar('\n');
+}
+
+#if (RFM == 1) && (WL_SHARES)
+/*!
+ *******************************************************************************
+ *  \brief print shared seconds of second half-minute
+ *
+ *  \note   N: aa:ss aa:ss aa:ss
+ *  \note   ss seconds of slave aa, hex; only slaves with seconds are printed
+ ******************************************************************************/
+static void COM_print_shares(void)
+{
+	uint8_t i;
+
+	print_s_p(PSTR("N:"));
+	for (i = 0; i < WL_SHARE_N; i++)
+	{
+		if (wl_shares[2 * i + 1] != 0)
+		{
+			COM_putchar(' ');
+			print_hexXX(wl_shares[2 * i]);
+			COM_putchar(':');
+			print_hexXX(wl_shares[2 * i + 1]);
+		}
+	}
+}
+#endif
+
+#if (OTA == 1)
+/*!
+ *******************************************************************************
+ *  \brief request image chunks for RF bootloader from host
+ *
+ *  \note   U: aa ii cccc nn
+ *  \note   aa address of slave in bootloader, ii image id, cccc first chunk,
+ *  \note   nn count of chunks, host answers by U command for each chunk
+ ******************************************************************************/
+void COM_ota_request(uint8_t addr, uint8_t id, uint16_t chunk, uint8_t count)
+{
+	print_s_p(PSTR("U: "));
+	print_hexXX(addr);
+	COM_putchar(' ');
+	print_hexXX(id);
+	COM_putchar(' ');
+	print_hexXXXX(chunk);
+	COM_putchar(' ');
+	print_hexXX(count);
+	COM_putchar('\n');
+	COM_flush();
+}
+#endif
+
+#if (STATUS_CACHE == 1)
+static void print_status_rec(uint8_t *d);
+
+/*!
+ *******************************************************************************
+ *  \brief continue status dump
+ *
+ *  \note one line per slave which was heard since master reset:
+ *  \note   (aa)C tAAAA pPP eEE xXX fFF:LL:HH @SS -D m.. s.. ...
+ *  \note   AAAA age of status record in seconds (ffff = too old or none),
+ *  \note   PP/EE good/bad packet counters, XX forced slots without good packet,
+ *  \note   FF AFC of last good packet, LL/HH lowest/highest AFC (hex, signed),
+ *  \note   SS 1/100 s (hex) when last time slot of slave started
+ *  \note   status record part is missing if no status was received
+ *  \note dump is terminated by "C end rRR" line, RR is current RFM_RATE_xxx
+ *  \note dump is send in parts, next part when output buffer is empty
+ ******************************************************************************/
+static void COM_status_dump(void)
+{
+	while (status_dump != 0)
+	{
+		if (COM_tx_free() < STATUS_LINE_MAX)
+		{
+			break;
+		}
+		status_item_t *s = STATUS_get(status_dump);
+		if (s == NULL)
+		{
+			print_s_p(PSTR("C end r"));
+			print_hexXX(rfm_rate);
+			COM_putchar('\n');
+			status_dump = 0;
+			break;
+		}
+		if ((s->pkt_ok != 0) || (s->pkt_err != 0) || (s->missed != 0) || (s->cmd != 0))
+		{
+			COM_putchar('(');
+			print_hexXX(status_dump);
+			print_s_p(PSTR(")C t"));
+			print_hexXXXX((s->cmd != 0) ? s->age : 0xffff);
+			print_s_p(PSTR(" p"));
+			print_hexXX(s->pkt_ok);
+			print_s_p(PSTR(" e"));
+			print_hexXX(s->pkt_err);
+			print_s_p(PSTR(" x"));
+			print_hexXX(s->missed);
+			print_s_p(PSTR(" f"));
+			print_hexXX(s->afc);
+			COM_putchar(':');
+			print_hexXX(s->afc_min);
+			COM_putchar(':');
+			print_hexXX(s->afc_max);
+			print_s_p(PSTR(" @"));
+			print_hexXX(s->phase);
+			if (s->cmd != 0)
+			{
+				COM_putchar(' ');
+				COM_putchar('-');
+				COM_putchar(s->cmd);
+				print_status_rec(&s->cmd);
+			}
+			COM_putchar('\n');
+		}
+		status_dump++;
+	}
+	COM_flush();
+}
+#endif
+
 /*!
  *******************************************************************************
  *  \brief parse command
@@ -440,6 +698,17 @@ static void print_incomplete_mark(int8_t len)
  *  \note   D\n - print status line
  *  \note   Yyymmdd\n - set, year yy, month mm, day dd; HEX values!!!
  *  \note   HhhmmSSss\n - set, hour hh, minute mm, second SS, 1/100 second ss; HEX values!!!
+ *  \note   C\n - dump last known status of all slaves, see \ref COM_status_dump
+ *  \note   F\n - print flow control state, see \ref COM_print_flow
+ *  \note   Kmmmmmmmmcaa\n - group command c (A, M or L) with argument aa for slaves in
+ *  \note        address mask mmmmmmmm (same format as P), send in next sync packets,
+ *  \note        after data rate switch when it is announced
+ *  \note   Uiiccccdd..dd\n - chunk cccc of firmware image ii for RF bootloader,
+ *  \note        OTA_CHUNK bytes dd, answer to "U: " line, see \ref COM_ota_request
+ *  \note   Uiissss\n - announce image ii of ssss bytes, (aa)Uiissss for slave is
+ *  \note        refused for other images
+ *  \note   Naacc..aacc\n - backlog cc of slave aa, up to MASTER_BACKLOG_MAX pairs, answer
+ *  \note        to "N1?" instead of O/P; seconds 31..59 are shared, see \ref COM_print_shares
  *
  ******************************************************************************/
 void COM_commad_parse(void)
@@ -464,6 +733,22 @@ void COM_commad_parse(void)
 			}
 			c = '\0';
 			break;
+#if (STATUS_CACHE == 1)
+		case 'C':
+			if (COM_getchar() == '\n')
+			{
+				status_dump = 1;
+			}
+			c = '\0';
+			break;
+#endif
+		case 'F':
+			if (COM_getchar() == '\n')
+			{
+				com_ovf_report = true;
+			}
+			c = '\0';
+			break;
 		case 'Y':
 			if (COM_hex_parse(3 * 2, true) != '\0')
 			{
@@ -505,6 +790,90 @@ void COM_commad_parse(void)
 			wl_force_addr1 = 0xff;
 			print_s_p(PSTR("OK"));
 			break;
+#if (WL_SHARES)
+		case 'N':
+		{
+			uint8_t b[2 * MASTER_BACKLOG_MAX];
+			uint8_t n = 0;
+			char r;
+			while ((r = COM_hex_parse(2 * 2, false)) == '\0')
+			{
+				if (n < MASTER_BACKLOG_MAX)
+				{
+					b[2 * n] = com_hex[0];
+					b[2 * n + 1] = com_hex[1];
+					n++;
+				}
+			}
+			if (r != '\n')
+			{
+				break;
+			}
+			MASTER_shares(b, n);
+			COM_print_shares();
+		}
+		break;
+#endif
+#if (WL_GROUP_CMD)
+		case 'K':
+		{
+			// group command, mask in the same format as 'P'
+			if (COM_hex_parse(4 * 2, false) != '\0')
+			{
+				break;
+			}
+			uint32_t mask;
+			memcpy(&mask, com_hex, 4);
+			uint8_t ch = COM_getchar();
+			if ((ch != 'A') && (ch != 'M') && (ch != 'L'))
+			{
+				break;
+			}
+			if (COM_hex_parse(1 * 2, true) != '\0')
+			{
+				break;
+			}
+			MASTER_group_command(mask, ch, com_hex[0]);
+			print_s_p(PSTR("OK"));
+		}
+		break;
+#endif
+#if (OTA == 1)
+		case 'U':
+		{
+			if (COM_hex_parse(3 * 2, false) != '\0')
+			{
+				break;
+			}
+			uint8_t id = com_hex[0];
+			uint16_t chunk = ((uint16_t)com_hex[1] << 8) | com_hex[2];
+			uint8_t d[OTA_CHUNK];
+			uint8_t i;
+			char e = '\0';
+			for (i = 0; i < OTA_CHUNK; i++)
+			{
+				e = COM_hex_parse(1 * 2, false);
+				if (e != '\0')
+				{
+					break;
+				}
+				d[i] = com_hex[0];
+			}
+			if ((i == 0) && (e == '\n'))
+			{
+				OTA_announce(id, chunk); // no data: cccc is image size
+				print_s_p(PSTR("OK"));
+				break;
+			}
+			if ((i != OTA_CHUNK) || (COM_getchar() != '\n'))
+			{
+				break;
+			}
+			OTA_store(id, chunk, d);
+			print_s_p(PSTR("OK"));
+		}
+		break;
+#endif
 #endif
 		case ':': // intel hex for writing eeprom
 			if (COM_hex_parse(4 * 2, false) != '\0')
@@ -577,15 +946,29 @@ void COM_commad_parse(void)
 				break;
 			}
 			uint8_t addr = com_hex[0];
-			if (COM_getchar() != '-')
+			uint8_t tag = 0;
+			uint8_t sep = COM_getchar();
+			if (sep == '#')
 			{
-				break;
+				// command tag, reported back in ack line
+				if (COM_hex_parse(1 * 2, false) != '\0')
+				{
+					break;
+				}
+				tag = com_hex[0];
+			}
+			else if (sep == '-')
+			{
+				// bank digit is accepted for compatibility, queue do own packing
+				if (COM_hex_parse(1, false) != '\0')
+				{
+					break;
+				}
 			}
-			if (COM_hex_parse(1, false) != '\0')
+			else
 			{
 				break;
 			}
-			uint8_t bank = com_hex[0] >> 4;
 			if (COM_getchar() != ')')
 			{
 				break;
@@ -611,6 +994,7 @@ void COM_commad_parse(void)
 				len = 2;
 				break;
 			case 'W':
+			case 'U':
 				len = 3;
 				break;
 			default:
@@ -620,13 +1004,19 @@ void COM_commad_parse(void)
 			{
 				break;
 			}
-			uint8_t *d = Q_push(len + 1, addr, bank);
-			if (d == NULL)
+#if (OTA == 1)
+			if ((ch == 'U') && !OTA_announced(com_hex[0], ((uint16_t)com_hex[1] << 8) | com_hex[2]))
 			{
-				break;
+				break; // relay would not get the image, slave must not reboot for it
 			}
+#endif
+			uint8_t d[4];
 			d[0] = ch;
 			memcpy(d + 1, com_hex, len);
+			if (!Q_push(len + 1, addr, d, tag))
+			{
+				break;
+			}
 			print_s_p(PSTR("OK"));
 		}
 		break;
@@ -657,10 +1047,52 @@ void COM_commad_parse(void)
 		}
 		COM_flush();
 	}
+	if (com_ovf_report)
+	{
+		COM_print_flow();
+	}
+#if (STATUS_CACHE == 1)
+	COM_status_dump();
+#endif
+	COM_flush(); // restart output after XON
 }
 
 #define calc_temp(t) (((uint16_t)t) * 50)   // result unit is 1/100 C
 
+/*!
+ *******************************************************************************
+ *  \brief print D/A/M status record
+ *
+ *  \note d points to command char, it is not printed
+ ******************************************************************************/
+static void print_status_rec(uint8_t *d)
+{
+	print_s_p(PSTR(" m"));
+	print_decXX(d[1] & 0x3f);
+	print_s_p(PSTR(" s"));
+	print_decXX(d[2] & 0x3f);
+	COM_putchar(' ');
+	COM_putchar(((d[1] & 0x80) != 0) ? ((d[1] & 0x40) ? 'A' : '-') : 'M');
+	print_s_p(PSTR(" V"));
+	print_decXX(d[9]);
+	print_s_p(PSTR(" I"));
+	print_decXXXX(((uint16_t)d[4] << 8) | d[5]);
+	print_s_p(PSTR(" S"));
+	print_decXXXX(calc_temp(d[8]));
+	print_s_p(PSTR(" B"));
+	print_decXXXX(((uint16_t)d[6] << 8) | d[7]);
+	print_s_p(PSTR(" E"));
+	print_hexXX(d[3]);
+	if ((d[2] & 0x40) != 0)
+	{
+		print_s_p(PSTR(" W"));
+	}
+	if ((d[2] & 0x80) != 0)
+	{
+		print_s_p(PSTR(" L"));
+	}
+}
+
 /*!
  *******************************************************************************
  *  \brief dump data from *d length len
@@ -692,6 +1124,13 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok)
 			afc |= 0xf0;
 		}
 		print_hexXX(0 - afc);
+#endif
+#if (STATUS_CACHE == 1)
+#if (RFM_TUNING > 0)
+		STATUS_packet(addr, true, 0 - afc);
+#else
+		STATUS_packet(addr, true, 0);
+#endif
 #endif
 		len -= 6; // mac is correct and not needed
 		d += 2;
@@ -701,6 +1140,9 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok)
 	{
 		print_s_p(PSTR(" ERR"));
 		print_hexXXXX(seq++);
+#if (STATUS_CACHE == 1)
+		STATUS_packet(addr, false, 0);
+#endif
 		bool dots = false;
 		if (len > 10)
 		{
@@ -733,11 +1175,27 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok)
 		print_s_p(PSTR("{\n"));
 	}
 
+	uint8_t pos = 0;
+	uint8_t tag = 0;
 	while (len > 0)
 	{
+		if ((d[0] == ('#' | 0x80)) && (len >= 2))
+		{
+			tag = d[1]; // echoed tag of next command
+			d += 2;
+			len -= 2;
+			continue;
+		}
 		if (d[0] & 0x80)
 		{
 			COM_putchar('*');
+			tag = Q_ack(addr, d[0] & 0x7f, pos++, tag);
+			if (tag != 0)
+			{
+				COM_putchar('#');
+				print_hexXX(tag);
+				COM_putchar(' ');
+			}
 		}
 		else
 		{
@@ -772,35 +1230,16 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok)
 				print_incomplete_mark(len);
 				break;
 			}
-			print_s_p(PSTR(" m"));
-			print_decXX(d[1] & 0x3f);
-			print_s_p(PSTR(" s"));
-			print_decXX(d[2] & 0x3f);
-			COM_putchar(' ');
-			COM_putchar(((d[1] & 0x80) != 0) ? ((d[1] & 0x40) ? 'A' : '-') : 'M');
-			print_s_p(PSTR(" V"));
-			print_decXX(d[9]);
-			print_s_p(PSTR(" I"));
-			print_decXXXX(((uint16_t)d[4] << 8) | d[5]);
-			print_s_p(PSTR(" S"));
-			print_decXXXX(calc_temp(d[8]));
-			print_s_p(PSTR(" B"));
-			print_decXXXX(((uint16_t)d[6] << 8) | d[7]);
-			print_s_p(PSTR(" E"));
-			print_hexXX(d[3]);
-			if ((d[2] & 0x40) != 0)
-			{
-				print_s_p(PSTR(" W"));
-			}
-			if ((d[2] & 0x80) != 0)
-			{
-				print_s_p(PSTR(" L"));
-			}
+			print_status_rec(d);
+#if (STATUS_CACHE == 1)
+			STATUS_record(addr, d);
+#endif
 			d += 10;
 			break;
 		case 'T':
 		case 'R':
 		case 'W':
+		case 'U':
 			COM_putchar(d[0]);
 			len -= 4;
 			if (len < 0)
@@ -852,6 +1291,7 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok)
 			break;
 		}
 		COM_putchar('\n');
+		tag = 0;
 	}
 	print_s_p(PSTR("}\n"));
 	COM_flush();
@@ -910,6 +1350,25 @@ void COM_req_RTC(void)
 					return;
 				}
 			}
+#if (WL_SHARES)
+			else if (wl_force_addr1 == WL_FORCE_SHARES)
+			{
+				uint8_t i;
+				s++; // request is one second before slot
+				for (i = 0; i < WL_SHARE_N; i++)
+				{
+					if ((wl_share_mask(wl_shares[2 * i]) >> (s - 30)) & 1)
+					{
+						break;
+					}
+				}
+				if (i == WL_SHARE_N)
+				{
+					return;
+				}
+				s = wl_shares[2 * i];
+			}
+#endif
 			else
 			{
 				if (RTC_GetSecond() & 1)
@@ -48,3 +48,7 @@ void COM_req_RTC(void);
 void COM_commad_parse(void);
 
 void print_s_p(const char *s);
+
+#if (OTA == 1)
+void COM_ota_request(uint8_t addr, uint8_t id, uint16_t chunk, uint8_t count);
+#endif
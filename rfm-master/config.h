@@ -68,7 +68,15 @@
 #define VERSION_STRING  "V: OpenHR20 master SW version 1.1 build " __DATE__ " " __TIME__ " " REVISION
 
 // Parameters for the COMM-Port
-#define COM_BAUD_RATE 38400
+#ifndef COM_BAUD_RATE
+#define COM_BAUD_RATE 38400 //!< can be set by make COM_BAUD_RATE=..., 16MHz boards can use up to 500000
+#endif
+#ifndef COM_XONXOFF
+#define COM_XONXOFF 1 //!< send XOFF/XON when input buffer is almost full, stop output on XOFF from host
+#endif
+#ifndef Q_LOOKAHEAD
+#define Q_LOOKAHEAD 4 //!< host pushes commands of this many slots after requested one, 29 is whole minute (about 1.4 kB queue RAM)
+#endif
 // Note we should only enable of of the following at one time
 /* we support UART */
 #define COM_UART 1
@@ -106,9 +114,25 @@
 #if (RFM == 1)
 #define RFM_DEVICE_ADDRESS 0x00
 #define DISABLE_JTAG           0
+#ifndef STATUS_CACHE
+#define STATUS_CACHE           1 //!< keep last status of each slave in RAM, C command dumps it
+#endif
+#ifndef SYNC_ADAPTIVE
+#define SYNC_ADAPTIVE          STATUS_CACHE //!< skip sync packets when all slaves are in sync, needs STATUS_CACHE
+#endif
+#ifndef RATE_ADAPTIVE
+#define RATE_ADAPTIVE          STATUS_CACHE //!< data rate negotiation up to config.RFM_rate_max, needs STATUS_CACHE
+#endif
+#ifndef OTA
+#define OTA                    STATUS_CACHE //!< relay firmware images to slave bootloaders in idle seconds, needs STATUS_CACHE
+#endif
 #else
 #define DISABLE_JTAG           0
 #define RFM_TUNING             0
+#define STATUS_CACHE           0
+#define SYNC_ADAPTIVE          0
+#define RATE_ADAPTIVE          0
+#define OTA                    0
 #endif
 
 /* compiler compatibility */
@@ -48,9 +48,11 @@ typedef struct                                          // each variables must b
 {
  #if (RFM == 1)
 	/* 00...07 */ uint8_t security_key[8];          //!< key for encrypted radio messasges
+	/*      08 */ uint8_t RFM_rate;                 //!< data rate of network RFM_RATE_xxx, updated by rate negotiation
+	/*      09 */ uint8_t RFM_rate_max;             //!< highest data rate for rate negotiation
 #if (RFM_TUNING > 0)
-	/*      08 */ int8_t RFM_freqAdjust;            //!< RFM12 Frequency adjustment
-	/*      09 */ uint8_t RFM_tuning;               //!< RFM12 tuning mode
+	/*      0a */ int8_t RFM_freqAdjust;            //!< RFM12 Frequency adjustment
+	/*      0b */ uint8_t RFM_tuning;               //!< RFM12 tuning mode
 #endif
 #endif
 } config_t;
@@ -63,7 +65,7 @@ extern config_t config;
 
 extern uint8_t EEPROM ee_layout;
 
-#define EE_LAYOUT (0xE1) //!< EEPROM layout version (Experimental 1)
+#define EE_LAYOUT (0xE2) //!< EEPROM layout version (Experimental 2, RFM_rate before tuning)
 
 #ifdef __EEPROM_C__
 // this is definition, not just declaration
@@ -104,9 +106,11 @@ uint8_t EEPROM ee_config[][4] = {  // must be alligned to 4 bytes
 	/* 05 */ { SECURITY_KEY_5,  SECURITY_KEY_5,  0x00, 0xff },              //!< security_key[5] for encrypted radio messasges
 	/* 06 */ { SECURITY_KEY_6,  SECURITY_KEY_6,  0x00, 0xff },              //!< security_key[6] for encrypted radio messasges
 	/* 07 */ { SECURITY_KEY_7,  SECURITY_KEY_7,  0x00, 0xff },              //!< security_key[7] for encrypted radio messasges
+	/* 08 */ { RFM_RATE_DEFAULT, RFM_RATE_DEFAULT, 0x00, RFM_RATE_COUNT - 1 }, //!< RFM_rate: 0 = 9600, 1 = 19200, 2 = 38400, 3 = 57600 bps
+	/* 09 */ { RFM_RATE_DEFAULT, RFM_RATE_DEFAULT, 0x00, RFM_RATE_COUNT - 1 }, //!< RFM_rate_max: same as RFM_rate = no negotiation
 #if (RFM_TUNING > 0)
-	/*    */ {              0,               0,  0x00, 0xff },              //!< RFM12 Frequency adjustment, 2's complement
-	/*    */ { RFM_TUNING_MODE, RFM_TUNING_MODE, 0x00, 0xff },              //!< RFM12 tuning mode, 0 = tuning mode off (narrow, high data rate), 1 = tuning mode on (wide, low data rate)
+	/* 0a */ {              0,               0,  0x00, 0xff },              //!< RFM12 Frequency adjustment, 2's complement
+	/* 0b */ { RFM_TUNING_MODE, RFM_TUNING_MODE, 0x00, 0xff },              //!< RFM12 tuning mode, 0 = tuning mode off (narrow, high data rate), 1 = tuning mode on (wide, low data rate)
 #endif
 
 #endif
@@ -45,6 +45,7 @@
 // HR20 Project includes
 #include "config.h"
 #include "main.h"
+#include "master.h"
 #include "com.h"
 #include "task.h"
 #include "eeprom.h"
@@ -72,7 +73,6 @@ static inline void init(void);                  // init the whole thing
 
 
 volatile uint8_t task;
-uint8_t onsync = 0; // \todo comments, header
 
 /*!
  *******************************************************************************
@@ -128,117 +128,7 @@ int __attribute__ ((noreturn)) main(void)
 			asm volatile ("sei");
 		}
 
-#if (RFM == 1)
-		// RFM12
-		if (task & TASK_RFM)
-		{
-			task &= ~TASK_RFM;
-			// PORTE |= (1<<PE2);
-
-			if (rfm_mode == rfmmode_tx_done)
-			{
-				wirelessSendDone();
-			}
-			else if ((rfm_mode == rfmmode_rx) || (rfm_mode == rfmmode_rx_owf))
-			{
-				wirelessReceivePacket();
-			}
-			continue; // on most case we have only 1 task, iprove time to sleep
-		}
-#endif
-		if (task & TASK_RTC)
-		{
-			task &= ~TASK_RTC;
-			{
-#if (RFM == 1)
-				wl_packet_bank = 0;
-#endif
-				RTC_AddOneSecond();
-				bool minute = (RTC_GetSecond() == 0);
-				if (RTC_GetSecond() < 30)
-				{
-					Q_clean(RTC_GetSecond());
-				}
-				else
-				{
-					wdt_reset(); // spare WDT reset (notmaly it is in send data interrupt)
-#if (RFM == 1)
-					if (wl_force_addr1 != 0)
-					{
-						if (wl_force_addr1 == 0xff)
-						{
-							Q_clean(RTC_GetSecond() - 30);
-						}
-						else
-						{
-							if (RTC_GetSecond() & 1)
-							{
-								Q_clean(wl_force_addr1);
-							}
-							else
-							{
-								Q_clean(wl_force_addr2);
-							}
-						}
-					}
-#endif
-				}
-				if ((onsync) && (minute || RTC_GetSecond() == 30))
-				{
-					onsync--;
-#if (RFM == 1)
-					rfm_mode = rfmmode_stop;
-					wireless_buf_ptr = 0;
-					wireless_putchar(RTC_GetYearYY());
-					uint8_t d = RTC_GetDay();
-					wireless_putchar((RTC_GetMonth() << 4) + (d >> 3));
-					wireless_putchar((d << 5) + RTC_GetHour());
-					wireless_putchar((RTC_GetMinute() << 1) + ((RTC_GetSecond() == 30) ? 1 : 0));
-					if (wl_force_addr1 != 0xfe)
-					{
-						if (wl_force_addr1 == 0xff)
-						{
-							wireless_putchar(((uint8_t *)&wl_force_flags)[0]);
-							wireless_putchar(((uint8_t *)&wl_force_flags)[1]);
-							wireless_putchar(((uint8_t *)&wl_force_flags)[2]);
-							wireless_putchar(((uint8_t *)&wl_force_flags)[3]);
-						}
-						else
-						{
-							wireless_putchar(wl_force_addr1);
-							wireless_putchar(wl_force_addr2);
-						}
-					}
-					wirelessSendSync();
-#endif
-					COM_print_datetime();
-				}
-				COM_req_RTC();
-			}
-		}
-		if (task & TASK_TIMER)
-		{
-			task &= ~TASK_TIMER;
-#if (RFM == 1)
-			if (RTC_timer_done & _BV(RTC_TIMER_RFM))
-			{
-				cli(); RTC_timer_done &= ~_BV(RTC_TIMER_RFM); sei();
-				wirelessTimer();
-			}
-			if (RTC_timer_done & _BV(RTC_TIMER_RFM2))
-			{
-				cli(); RTC_timer_done &= ~_BV(RTC_TIMER_RFM2); sei();
-				wirelessTimer2();
-			}
-#endif
-		}
-		// serial communication
-		if (task & TASK_COM)
-		{
-			task &= ~TASK_COM;
-			COM_commad_parse();
-			continue; // on most case we have only 1 task, iprove time to sleep
-		}
+		MASTER_tasks();
 	} //End Main loop
 }
 
@@ -293,13 +183,13 @@ static inline void init(void)
 
 	RTC_Init();
 
+	eeprom_config_init(false); // RFM_init uses config
+
 #if (RFM == 1)
 	RFM_init();
 	RFM_OFF();
 #endif
 
-	eeprom_config_init(false);
-
 #if (RFM == 1)
 	crypto_init();
 	RFM_FIFO_ON();
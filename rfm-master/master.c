@@ -0,0 +1,584 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Dario Carluccio (hr20-at-carluccio-dot-de)
+ *				2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       master.c
+ * \brief      master task handling, shared by firmware and soft master
+ * \author     Dario Carluccio <hr20-at-carluccio-dot-de>; Jiri Dobry <jdobry-at-centrum-dot-cz>
+ * \date       $Date$
+ * $Rev$
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+// HR20 Project includes
+#include "config.h"
+#include "main.h"
+#include "master.h"
+#include "com.h"
+#include "task.h"
+#include "queue.h"
+#include "status.h"
+#include "eeprom.h"
+#include "common/rtc.h"
+#include "common/wireless.h"
+
+#if (RFM == 1)
+#include "rfm_config.h"
+#include "common/rfm.h"
+#endif
+
+uint8_t onsync = 0; //!< number of sync packets to send, reloaded by time setting
+
+#if (STATUS_CACHE == 1) && (RFM == 1)
+/*!
+ *******************************************************************************
+ *  \brief slave forced to send in second s of current minute
+ *
+ *  \note same rules as slot selection in HR20 main loop, 0 = none
+ ******************************************************************************/
+uint8_t MASTER_forced_addr(uint8_t s)
+{
+	if (onsync == 0)
+	{
+		return 0; // no sync packet, slaves don't know force flags
+	}
+	if (wl_force_addr1 == 0xff)
+	{
+		s %= 30;
+		return ((wl_force_flags >> s) & 1) ? s : 0;
+	}
+#if (WL_SHARES)
+	if (wl_force_addr1 == WL_FORCE_SHARES)
+	{
+		uint8_t i;
+		for (i = 0; (s > 30) && (i < WL_SHARE_N); i++)
+		{
+			if ((wl_share_mask(wl_shares[2 * i]) >> (s - 30)) & 1)
+			{
+				return wl_shares[2 * i];
+			}
+		}
+		return 0;
+	}
+#endif
+	if (s > 30)
+	{
+		return (s & 1) ? wl_force_addr1 : wl_force_addr2;
+	}
+	return 0;
+}
+#endif
+
+#if (RFM == 1)
+/*!
+ *******************************************************************************
+ *  \brief send time sync packet with force flags and group command
+ *
+ *  \param force_data false sends sync without force data, slaves skip next
+ *  \param force_data WL_SKIP_SYNC syncs; wl_force_addr* are kept
+ ******************************************************************************/
+static void MASTER_send_sync(bool force_data)
+{
+	rfm_mode = rfmmode_stop;
+	wireless_buf_ptr = 0;
+	wireless_putchar(RTC_GetYearYY());
+	uint8_t d = RTC_GetDay();
+	wireless_putchar((RTC_GetMonth() << 4) + (d >> 3));
+	wireless_putchar((d << 5) + RTC_GetHour());
+	wireless_putchar((RTC_GetMinute() << 1) + ((RTC_GetSecond() == 30) ? 1 : 0));
+	if (force_data)
+	{
+		if (wl_force_addr1 == 0xff)
+		{
+			wireless_putchar(((uint8_t *)&wl_force_flags)[0]);
+			wireless_putchar(((uint8_t *)&wl_force_flags)[1]);
+			wireless_putchar(((uint8_t *)&wl_force_flags)[2]);
+			wireless_putchar(((uint8_t *)&wl_force_flags)[3]);
+		}
+#if (WL_SHARES)
+		else if (wl_force_addr1 == WL_FORCE_SHARES)
+		{
+			uint8_t i;
+			for (i = 0; i < 2 * WL_SHARE_N; i++)
+			{
+				wireless_putchar(wl_shares[i]);
+			}
+		}
+#endif
+		else
+		{
+			wireless_putchar(wl_force_addr1);
+			wireless_putchar(wl_force_addr2);
+		}
+	}
+#if (WL_GROUP_CMD)
+	if (wl_group_repeat != 0)
+	{
+		wl_group_repeat--;
+		wireless_putchar(((uint8_t *)&wl_group_mask)[0]);
+		wireless_putchar(((uint8_t *)&wl_group_mask)[1]);
+		wireless_putchar(((uint8_t *)&wl_group_mask)[2]);
+		wireless_putchar(((uint8_t *)&wl_group_mask)[3]);
+		wireless_putchar(wl_group_cmd[0]);
+		wireless_putchar(wl_group_cmd[1]);
+		wireless_putchar(wl_group_cmd[2]);
+	}
+#endif
+	wirelessSendSync();
+}
+#endif
+
+#if (RFM == 1) && (WL_SHARES)
+/*!
+ *******************************************************************************
+ *  \brief deal seconds 31..59 to addresses by their backlog
+ *
+ *  \note backlog is n pairs address, queued commands from host
+ *  \note WL_SHARE_N biggest backlogs get seconds in proportion to it, at least
+ *  \note one and at most one per command; others keep only their own slot
+ ******************************************************************************/
+void MASTER_shares(const uint8_t *backlog, uint8_t n)
+{
+	uint8_t cnt[WL_SHARE_N];
+	uint16_t sum = 0;
+	uint8_t left = 29;
+	uint8_t i, j;
+
+	for (i = 0; i < WL_SHARE_N; i++)
+	{
+		wl_shares[2 * i] = 0;
+		cnt[i] = 0;
+	}
+	for (i = 0; i < n; i++)
+	{
+		uint8_t a = backlog[2 * i];
+		uint8_t c = backlog[2 * i + 1];
+		if ((a == 0) || (a > 29) || (c <= cnt[WL_SHARE_N - 1]))
+		{
+			continue;
+		}
+		// insert to list sorted by backlog, smallest falls out
+		for (j = WL_SHARE_N - 1; (j > 0) && (cnt[j - 1] < c); j--)
+		{
+			wl_shares[2 * j] = wl_shares[2 * j - 2];
+			cnt[j] = cnt[j - 1];
+		}
+		wl_shares[2 * j] = a;
+		cnt[j] = c;
+	}
+	for (i = 0; i < WL_SHARE_N; i++)
+	{
+		sum += cnt[i];
+	}
+	for (i = 0; i < WL_SHARE_N; i++)
+	{
+		uint8_t s = (sum == 0) ? 0 : (uint8_t)((uint16_t)cnt[i] * 29 / sum);
+		if ((s == 0) && (cnt[i] != 0))
+		{
+			s = 1;
+		}
+		s = MIN(s, MIN(left, cnt[i]));
+		wl_shares[2 * i + 1] = s;
+		left -= s;
+	}
+	// rounding rest to biggest backlog first
+	for (i = 0; (left > 0) && (i < WL_SHARE_N); i++)
+	{
+		uint8_t s = MIN(left, cnt[i] - wl_shares[2 * i + 1]);
+		wl_shares[2 * i + 1] += s;
+		left -= s;
+	}
+	wl_force_addr1 = (sum != 0) ? WL_FORCE_SHARES : 0;
+	wl_force_addr2 = 0;
+}
+#endif
+
+#if (SYNC_ADAPTIVE == 1)
+static uint8_t sync_skip = 0; //!< sync packets which slaves don't expect
+
+/*!
+ *******************************************************************************
+ *  \brief adaptive sync cadence
+ *
+ *  \note when all slaves are in sync, no slave is forced and queue is empty, sync
+ *  \note packet is send without force data, slaves skip next WL_SKIP_SYNC syncs
+ *  \note and master don't send them
+ *  \note force flags or group command raised during skipped syncs are send at
+ *  \note once but slaves hear them only with the (WL_SKIP_SYNC+1)th sync, up to
+ *  \note 2 minutes later; commands in own slot of slave are not delayed
+ *  \param force_data set false for sync without force data
+ *  \returns true if this sync packet is skipped
+ ******************************************************************************/
+static bool MASTER_sync_skip(bool *force_data)
+{
+	bool pending = (wl_force_addr1 == 0xff) ? (wl_force_flags != 0) :
+		       ((wl_force_addr1 != 0) || (wl_force_addr2 != 0));
+
+	*force_data = true;
+	if (Q_free() != Q_ITEMS)
+	{
+		pending = true; // commands of host wait, force can follow
+	}
+
+#if (WL_GROUP_CMD)
+	if (wl_group_repeat != 0)
+	{
+		pending = true;
+	}
+#endif
+	if (pending)
+	{
+		sync_skip = 0;
+		return false;
+	}
+	if (sync_skip != 0)
+	{
+		sync_skip--;
+		return true;
+	}
+	if (STATUS_sync_stable())
+	{
+		*force_data = false; // slaves skip next syncs
+		sync_skip = WL_SKIP_SYNC;
+	}
+	return false;
+}
+#endif
+
+#if (RFM == 1) && (WL_GROUP_CMD)
+static uint32_t group_wait_mask;        //!< group command of host waiting for rate switch
+static uint8_t group_wait_cmd;          //!< 0 = none
+static uint8_t group_wait_arg;
+
+/*!
+ *******************************************************************************
+ *  \brief put group command to next WL_GROUP_REPEAT sync packets
+ ******************************************************************************/
+static void MASTER_group_set(uint32_t mask, uint8_t cmd, uint8_t arg)
+{
+	wl_group_mask = mask;
+	// sequence from time of request is unique for all commands in air
+	wl_group_cmd[0] = RTC_GetMinute() * 2 + ((RTC_GetSecond() >= 30) ? 1 : 0) + 1;
+	wl_group_cmd[1] = cmd;
+	wl_group_cmd[2] = arg;
+	wl_group_repeat = WL_GROUP_REPEAT;
+}
+#endif
+
+#if (RATE_ADAPTIVE == 1) && (WL_RATE)
+#ifndef RATE_EVAL
+#define RATE_EVAL 30            //!< minutes of link statistics for one rate decision
+#endif
+#ifndef RATE_PROBE
+#define RATE_PROBE 15           //!< minutes for active slaves to answer after rate change
+#endif
+#ifndef RATE_HOLD
+#define RATE_HOLD 1440          //!< minutes without step up after failed or bad rate
+#endif
+#define RATE_MIN_PKT 30         //!< good packets needed for rate decision
+#define RATE_BAD_UP 2           //!< step up if bad packets are at most this % of good ones
+#define RATE_BAD_DOWN 10        //!< step down if bad packets are over this % of good ones
+
+static uint8_t rate_next = 0xff;        //!< announced change (group command argument), 0xff = none
+static bool rate_fallback;              //!< announced change returns to rate_prev
+static uint8_t rate_prev;               //!< data rate before last change
+static uint8_t rate_probe;              //!< minutes left for slaves in rate_wait to answer
+static uint32_t rate_wait;              //!< slaves active before change and not heard since
+static uint16_t rate_hold;              //!< minutes left without step up
+static uint8_t rate_minutes;            //!< length of statistics window
+static uint16_t rate_ok;                //!< good packets in statistics window
+static uint16_t rate_bad;               //!< bad packets and missed forced slots in window
+static uint8_t rate_snap[STATUS_ADDR_MAX][3]; //!< pkt_ok, pkt_err, missed on last minute
+
+/*!
+ *******************************************************************************
+ *  \brief announce data rate change by group command to all slaves
+ *
+ *  \note switch is done 3 minutes later, after WL_GROUP_REPEAT sync packets;
+ *  \note group commands of host wait until then, see \ref MASTER_group_command
+ ******************************************************************************/
+static void MASTER_rate_announce(uint8_t rate, bool fallback)
+{
+	if ((wl_group_repeat != 0) && (wl_group_cmd[1] != WL_RATE_CMD))
+	{
+		// fallback replaces command of host in air, it is repeated after switch
+		group_wait_mask = wl_group_mask;
+		group_wait_cmd = wl_group_cmd[1];
+		group_wait_arg = wl_group_cmd[2];
+	}
+	rate_next = WL_RATE_ARG((RTC_GetMinute() + 3) % 60, rate);
+	rate_fallback = fallback;
+	MASTER_group_set(0x3ffffffe, WL_RATE_CMD, rate_next); // slaves 1..29
+}
+
+/*!
+ *******************************************************************************
+ *  \brief keep current data rate for next power on
+ ******************************************************************************/
+static void MASTER_rate_store(void)
+{
+	config.RFM_rate = rfm_rate;
+	eeprom_config_save((uint8_t)(&config.RFM_rate - config_raw));
+}
+
+/*!
+ *******************************************************************************
+ *  \brief data rate negotiation, call it every minute before sync packet
+ *
+ *  \note error ratio of all links over RATE_EVAL minutes selects step up or
+ *  \note down; after change every slave active before must send a good packet
+ *  \note within RATE_PROBE minutes, otherwise the network returns to old rate
+ *  \note announced switch is always done, slaves which heard it switch too;
+ *  \note slaves which missed it are caught by the probe and the fallback
+ ******************************************************************************/
+static void MASTER_rate_minute(void)
+{
+	uint8_t i;
+	uint32_t active = 0;
+
+	for (i = 0; i < STATUS_ADDR_MAX; i++)
+	{
+		status_item_t *s = &STATUS_buf[i];
+		uint8_t ok = s->pkt_ok - rate_snap[i][0];
+		rate_ok += ok;
+		rate_bad += (uint8_t)(s->pkt_err - rate_snap[i][1]);
+		rate_bad += (uint8_t)(s->missed - rate_snap[i][2]);
+		rate_snap[i][0] = s->pkt_ok;
+		rate_snap[i][1] = s->pkt_err;
+		rate_snap[i][2] = s->missed;
+		if (ok != 0)
+		{
+			rate_wait &= ~((uint32_t)1 << (i + 1));
+		}
+		if ((s->cmd != 0) && (s->age < STATUS_STABLE_AGE))
+		{
+			active |= (uint32_t)1 << (i + 1);
+		}
+	}
+	if (rate_minutes < 0xff)
+	{
+		rate_minutes++;
+	}
+	if (rate_hold != 0)
+	{
+		rate_hold--;
+	}
+
+	if (rate_next != 0xff)
+	{
+		if ((rate_next >> 2) != RTC_GetMinute())
+		{
+			return; // announcement in progress
+		}
+		rate_prev = rfm_rate;
+		RFM_set_rate(rate_next & (RFM_RATE_COUNT - 1));
+		rate_probe = 0;
+		if (rate_fallback)
+		{
+			MASTER_rate_store();
+		}
+		else
+		{
+			rate_wait = active;
+			rate_probe = RATE_PROBE;
+		}
+		rate_minutes = 0;
+		rate_ok = 0;
+		rate_bad = 0;
+		rate_next = 0xff;
+		if (group_wait_cmd != 0)
+		{
+			MASTER_group_set(group_wait_mask, group_wait_cmd, group_wait_arg);
+			group_wait_cmd = 0;
+		}
+		return;
+	}
+	if (rate_probe != 0)
+	{
+		if (rate_wait == 0)
+		{
+			rate_probe = 0;
+			MASTER_rate_store();
+		}
+		else if (--rate_probe == 0)
+		{
+			rate_hold = RATE_HOLD;
+			MASTER_rate_announce(rate_prev, true);
+		}
+		return;
+	}
+	if ((onsync == 0) || (wl_group_repeat != 0))
+	{
+		return; // slaves would not get announcement
+	}
+	if ((rfm_rate > config.RFM_rate_max) && (rate_hold == 0))
+	{
+		MASTER_rate_announce(rfm_rate - 1, false);
+		return;
+	}
+	if (rate_minutes < RATE_EVAL)
+	{
+		return;
+	}
+	if (rate_ok >= RATE_MIN_PKT)
+	{
+		if (((uint32_t)rate_bad * 100 > (uint32_t)rate_ok * RATE_BAD_DOWN) && (rfm_rate > 0))
+		{
+			rate_hold = RATE_HOLD;
+			MASTER_rate_announce(rfm_rate - 1, false);
+		}
+		else if (((uint32_t)rate_bad * 100 <= (uint32_t)rate_ok * RATE_BAD_UP)
+			 && (rfm_rate < config.RFM_rate_max) && (rate_hold == 0) && STATUS_sync_stable())
+		{
+			MASTER_rate_announce(rfm_rate + 1, false);
+		}
+	}
+	rate_minutes = 0;
+	rate_ok = 0;
+	rate_bad = 0;
+}
+#endif
+
+#if (RFM == 1) && (WL_GROUP_CMD)
+/*!
+ *******************************************************************************
+ *  \brief group command of host
+ *
+ *  \note while data rate change is announced, command waits for the switch,
+ *  \note so announcement stays in all its sync packets; later command replaces
+ *  \note waiting one like it replaces one in air
+ ******************************************************************************/
+void MASTER_group_command(uint32_t mask, uint8_t cmd, uint8_t arg)
+{
+#if (RATE_ADAPTIVE == 1) && (WL_RATE)
+	if (rate_next != 0xff)
+	{
+		group_wait_mask = mask;
+		group_wait_cmd = cmd;
+		group_wait_arg = arg;
+		return;
+	}
+#endif
+	MASTER_group_set(mask, cmd, arg);
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  \brief process pending tasks
+ *
+ *  \note called from main loop after wake-up, the soft master calls it
+ *  after each simulated interrupt
+ ******************************************************************************/
+void MASTER_tasks(void)
+{
+#if (RFM == 1)
+	// RFM12
+	if (task & TASK_RFM)
+	{
+		task &= ~TASK_RFM;
+		// PORTE |= (1<<PE2);
+
+		if (rfm_mode == rfmmode_tx_done)
+		{
+			wirelessSendDone();
+		}
+		else if ((rfm_mode == rfmmode_rx) || (rfm_mode == rfmmode_rx_owf))
+		{
+			wirelessReceivePacket();
+		}
+		return; // on most case we have only 1 task, iprove time to sleep
+	}
+#endif
+	if (task & TASK_RTC)
+	{
+		task &= ~TASK_RTC;
+		{
+			RTC_AddOneSecond();
+#if (STATUS_CACHE == 1)
+#if (RFM == 1)
+			STATUS_tick(MASTER_forced_addr(RTC_GetSecond()));
+#else
+			STATUS_tick(0);
+#endif
+#endif
+			bool minute = (RTC_GetSecond() == 0);
+			Q_tick(minute);
+#if (RATE_ADAPTIVE == 1) && (WL_RATE)
+			if (minute)
+			{
+				MASTER_rate_minute();
+			}
+#endif
+			if (RTC_GetSecond() >= 30)
+			{
+				wdt_reset(); // spare WDT reset (notmaly it is in send data interrupt)
+			}
+			if ((onsync) && (minute || RTC_GetSecond() == 30))
+			{
+				onsync--;
+#if (RFM == 1)
+				bool force_data = true;
+#if (SYNC_ADAPTIVE == 1)
+				if (!MASTER_sync_skip(&force_data))
+#endif
+				{
+					MASTER_send_sync(force_data);
+				}
+#endif
+				COM_print_datetime();
+			}
+			COM_req_RTC();
+		}
+	}
+	if (task & TASK_TIMER)
+	{
+		task &= ~TASK_TIMER;
+#if (RFM == 1)
+		if (RTC_timer_done & _BV(RTC_TIMER_RFM))
+		{
+			cli(); RTC_timer_done &= ~_BV(RTC_TIMER_RFM); sei();
+			wirelessTimer();
+		}
+		if (RTC_timer_done & _BV(RTC_TIMER_RFM2))
+		{
+			cli(); RTC_timer_done &= ~_BV(RTC_TIMER_RFM2); sei();
+			wirelessTimer2();
+		}
+#endif
+	}
+	// serial communication
+	if (task & TASK_COM)
+	{
+		task &= ~TASK_COM;
+		COM_commad_parse();
+		return; // on most case we have only 1 task, iprove time to sleep
+	}
+}
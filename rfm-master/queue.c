@@ -38,80 +38,329 @@
 // HR20 Project includes
 #include "config.h"
 #include "queue.h"
+#include "common/rtc.h"
 
 static q_item_t Q_buf[Q_ITEMS];
+static uint8_t q_pos;   //!< position of next item in packet
 
 /*!
  *******************************************************************************
- *  \brief push one item si queue
+ *  \brief priority class of command
  *
  *  \note
  ******************************************************************************/
-uint8_t *Q_push(uint8_t len, uint8_t addr, uint8_t bank)
+static uint8_t Q_prio(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case 'A':
+	case 'M':
+	case 'L':
+	case 'B':
+		return Q_PRIO_HIGH;
+	case 'S':
+	case 'W':
+	case 'U':
+		return Q_PRIO_NORMAL;
+	default:
+		return Q_PRIO_LOW;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief expected size of reply to command
+ *
+ *  \note same weights as weights() in daemon.php
+ ******************************************************************************/
+static uint8_t Q_weight(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case 'S':
+	case 'W':
+	case 'U':
+		return 4;
+	case 'G':
+	case 'R':
+	case 'T':
+		return 2;
+	default:
+		return 10;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief move used items to begin of buffer
+ *
+ *  \note keeps order of items, free space is always on the end
+ ******************************************************************************/
+static void Q_compact(void)
 {
 	uint8_t i;
-	uint8_t free = 0xff;
+	uint8_t j = 0;
 
 	for (i = 0; i < Q_ITEMS; i++)
 	{
-		if ((Q_buf[i].addr == addr) && (Q_buf[i].bank == bank))
+		if (Q_buf[i].addr != 0)
 		{
-			free = 0xff;
+			if (i != j)
+			{
+				Q_buf[j] = Q_buf[i];
+				Q_buf[i].addr = 0;
+			}
+			j++;
 		}
-		else
-		if ((free == 0xff) && (Q_buf[i].addr == 0))
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief seconds to next slot request of addr
+ *
+ *  \note "(aa)?" is printed one second before slot of addr aa
+ ******************************************************************************/
+static uint8_t Q_distance(uint8_t addr)
+{
+	return (uint8_t)(((uint16_t)addr + 59 - RTC_GetSecond()) % 60);
+}
+
+/*!
+ *******************************************************************************
+ *  \brief free item for addr in full queue
+ *
+ *  \note not send item with priority class prio or lower is removed if its
+ *  \note slot is after slot of addr, host push it again before that slot;
+ *  \note lowest class first, then newest item of address with latest slot
+ *  \returns false if no item can be removed
+ ******************************************************************************/
+static bool Q_evict(uint8_t addr, uint8_t prio)
+{
+	uint8_t i;
+	uint8_t found = Q_ITEMS;
+	uint8_t dist = Q_distance(addr);
+
+	for (i = 0; i < Q_ITEMS; i++)
+	{
+		uint8_t p = Q_buf[i].flags & Q_PRIO_MASK;
+		uint8_t d = Q_distance(Q_buf[i].addr);
+		if (((Q_buf[i].flags & Q_SENT) != 0) || (Q_buf[i].addr == addr) || (p < prio) || (d < dist))
+		{
+			continue;
+		}
+		if ((found == Q_ITEMS) || (p > (Q_buf[found].flags & Q_PRIO_MASK))
+		    || ((p == (Q_buf[found].flags & Q_PRIO_MASK)) && (d >= Q_distance(Q_buf[found].addr))))
 		{
-			free = i;
+			found = i;
 		}
 	}
-	if (free == 0xff)
+	if (found == Q_ITEMS)
 	{
-		return NULL;
+		return false;
 	}
-	Q_buf[free].len = len;
-	Q_buf[free].addr = addr;
-	Q_buf[free].bank = bank;
-	return Q_buf[free].data;
+	Q_buf[found].addr = 0;
+	Q_compact();
+	return true;
 }
 
 /*!
  *******************************************************************************
- *  \brief clean buffer for addr
+ *  \brief push one item to queue
  *
- *  \note
+ *  \note same command with same tag for same addr is stored only once,
+ *  \note push again only restart expiry time
+ *  \note items stay in queue until ack or expiry
+ *  \note host push commands up to Q_LOOKAHEAD slots ahead, in full queue
+ *  \note commands of later slots give place to commands of earlier slots of
+ *  \note the same or higher priority class, otherwise push fails
  ******************************************************************************/
-void Q_clean(uint8_t addr_preserve)
+bool Q_push(uint8_t len, uint8_t addr, uint8_t *data, uint8_t tag)
 {
 	uint8_t i;
+	uint8_t prio = Q_prio(data[0]);
+	uint8_t ttl = (prio == Q_PRIO_HIGH) ? Q_TTL_HIGH :
+		      ((prio == Q_PRIO_NORMAL) ? Q_TTL_NORMAL : Q_TTL_LOW);
 
 	for (i = 0; i < Q_ITEMS; i++)
 	{
-		if (Q_buf[i].addr != addr_preserve)
+		if (Q_buf[i].addr == 0)
 		{
-			Q_buf[i].addr = 0;
+			break; // first free item, rest is free too
+		}
+		if ((Q_buf[i].addr == addr) && (Q_buf[i].len == len) && (Q_buf[i].tag == tag)
+		    && (memcmp(Q_buf[i].data, data, len) == 0))
+		{
+			Q_buf[i].ttl = ttl;
+			return true;
 		}
 	}
+	if (i == Q_ITEMS)
+	{
+		if (!Q_evict(addr, prio))
+		{
+			return false;
+		}
+		i = Q_ITEMS - 1; // compacted, last item is free
+	}
+	Q_buf[i].len = len;
+	Q_buf[i].addr = addr;
+	Q_buf[i].flags = prio;
+	Q_buf[i].ttl = ttl;
+	Q_buf[i].tag = tag;
+	memcpy(Q_buf[i].data, data, len);
+	return true;
 }
 
 /*!
  *******************************************************************************
- *  \brief get items for addr_bank
+ *  \brief queue time handling, call it once per second
  *
- *  \note
+ *  \note time slot is over, not acked items will be send again in next slot
+ *  \note expired items are removed once per minute
  ******************************************************************************/
-q_item_t *Q_get(uint8_t addr, uint8_t bank, uint8_t skip)
+void Q_tick(bool minute)
 {
 	uint8_t i;
 
 	for (i = 0; i < Q_ITEMS; i++)
 	{
-		if ((Q_buf[i].addr == addr) && (Q_buf[i].bank == bank))
+		Q_buf[i].flags &= Q_PRIO_MASK;
+		if (minute && (Q_buf[i].addr != 0))
 		{
-			if ((skip--) == 0)
+			if ((--Q_buf[i].ttl) == 0)
 			{
-				return Q_buf + i;
+				Q_buf[i].addr = 0;
+			}
+		}
+	}
+	if (minute)
+	{
+		Q_compact();
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief get next item for addr
+ *
+ *  \note returns highest priority item not send in current slot which fits
+ *  \note to reply size budget, *weight is used part of budget (0 on packet begin)
+ *  \note returned item is marked as send together with position in packet
+ ******************************************************************************/
+q_item_t *Q_get(uint8_t addr, uint8_t *weight)
+{
+	uint8_t i;
+	uint8_t prio;
+
+	if (*weight == 0)
+	{
+		q_pos = 0;
+	}
+	for (prio = Q_PRIO_HIGH; prio <= Q_PRIO_LOW; prio++)
+	{
+		for (i = 0; i < Q_ITEMS; i++)
+		{
+			if ((Q_buf[i].addr == addr) && (Q_buf[i].flags == prio)) // not send
+			{
+				uint8_t w = Q_weight(Q_buf[i].data[0]) + ((Q_buf[i].tag != 0) ? 2 : 0); // "#tt" echo
+				if ((*weight == 0) || (*weight + w <= Q_WEIGHT_MAX))
+				{
+					*weight += w;
+					Q_buf[i].flags |= Q_SENT | ((q_pos++ << Q_POS_SHIFT) & Q_POS_MASK);
+					return Q_buf + i;
+				}
 			}
 		}
 	}
 	return NULL;
 }
+
+/*!
+ *******************************************************************************
+ *  \brief acknowledge command
+ *
+ *  \note slave echo command char with bit 7 set in the same order as commands
+ *  \note was send, pos is index of echo in reply packet
+ *  \note echo with tag removes item with this tag, it can be item send in
+ *  \note earlier slot with lost reply
+ *  \note untagged echo removes send item on this position, oldest send item
+ *  \note with the same command if position does not match
+ *  \returns tag of acked item, 0 if none; echoed tag even without item
+ ******************************************************************************/
+uint8_t Q_ack(uint8_t addr, uint8_t cmd, uint8_t pos, uint8_t tag)
+{
+	uint8_t i;
+	uint8_t found = Q_ITEMS;
+
+	for (i = 0; i < Q_ITEMS; i++)
+	{
+		if ((Q_buf[i].addr != addr) || (Q_buf[i].data[0] != cmd))
+		{
+			continue;
+		}
+		if (tag != 0)
+		{
+			if (Q_buf[i].tag == tag)
+			{
+				found = i;
+				break;
+			}
+		}
+		else if ((Q_buf[i].flags & Q_SENT) != 0)
+		{
+			if (((Q_buf[i].flags & Q_POS_MASK) >> Q_POS_SHIFT) == pos)
+			{
+				found = i;
+				break;
+			}
+			if (found == Q_ITEMS)
+			{
+				found = i;
+			}
+		}
+	}
+	if (found == Q_ITEMS)
+	{
+		return tag; // acked before, host still gets it
+	}
+	tag = Q_buf[found].tag;
+	Q_buf[found].addr = 0;
+	Q_compact();
+	return tag;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief reply from addr was processed, send items without ack again
+ *
+ *  \note slave echo all commands from received packet, item without echo
+ *  \note was lost and it can go to next packet in the same time slot
+ ******************************************************************************/
+void Q_retry(uint8_t addr)
+{
+	uint8_t i;
+
+	for (i = 0; i < Q_ITEMS; i++)
+	{
+		if (Q_buf[i].addr == addr)
+		{
+			Q_buf[i].flags &= Q_PRIO_MASK;
+		}
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief number of free items
+ ******************************************************************************/
+uint8_t Q_free(void)
+{
+	uint8_t i = Q_ITEMS;
+
+	while ((i > 0) && (Q_buf[i - 1].addr == 0))
+	{
+		i--;
+	}
+	return Q_ITEMS - i;
+}
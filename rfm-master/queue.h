@@ -33,19 +33,53 @@
  */
 
 
-#define Q_ITEMS 50
+#define Q_SLOT_ITEMS    5       //!< items in one packet, Q_WEIGHT_MAX by lightest command
+
+#ifndef Q_ITEMS
+#define Q_ITEMS MAX(50, Q_SLOT_ITEMS * (Q_LOOKAHEAD + 1))
+#endif
+#if (Q_ITEMS > 254)
+#error Q_ITEMS must fit to uint8_t index with 0xff as end mark
+#endif
+
+// priority classes, lower is send first
+#define Q_PRIO_HIGH     0       //!< interactive commands A M L B
+#define Q_PRIO_NORMAL   1       //!< setting changes S W
+#define Q_PRIO_LOW      2       //!< maintenance reads D V G R T
+#define Q_PRIO_MASK     0x03
+#define Q_POS_SHIFT     2       //!< position of item in last send packet
+#define Q_POS_MASK      0x1c
+#define Q_SENT          0x80    //!< item was send in current time slot, waiting for ack
+
+// expiry time in minutes for each priority class
+#ifndef Q_TTL_HIGH
+#define Q_TTL_HIGH      15
+#endif
+#ifndef Q_TTL_NORMAL
+#define Q_TTL_NORMAL    60
+#endif
+#ifndef Q_TTL_LOW
+#define Q_TTL_LOW       5
+#endif
+
+#define Q_WEIGHT_MAX    10      //!< reply size budget for one packet, same weights as daemon.php
 
 typedef struct
 {
 	uint8_t len;
-	uint8_t addr;
-	uint8_t bank;
+	uint8_t addr;           //!< 0 = free item
+	uint8_t flags;          //!< priority class, position in packet and Q_SENT
+	uint8_t ttl;            //!< minutes to expiry
+	uint8_t tag;            //!< command id from host, reported in ack, 0 = none
 	uint8_t data[4];
 } q_item_t;
 
 // extern q_item_t Q_buf[Q_ITEMS];
 
 
-uint8_t *Q_push(uint8_t len, uint8_t addr, uint8_t bank);
-void Q_clean(uint8_t addr_preserve);
-q_item_t *Q_get(uint8_t addr, uint8_t bank, uint8_t skip);
+bool Q_push(uint8_t len, uint8_t addr, uint8_t *data, uint8_t tag);
+void Q_tick(bool minute);
+q_item_t *Q_get(uint8_t addr, uint8_t *weight);
+uint8_t Q_ack(uint8_t addr, uint8_t cmd, uint8_t pos, uint8_t tag);
+void Q_retry(uint8_t addr);
+uint8_t Q_free(void);
@@ -0,0 +1,249 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       relay.c
+ * \brief      firmware image relay for slaves in RF bootloader
+ *
+ * Master keeps few image chunks received from host by 'U' command and
+ * answers chunk requests of bootloaders. Transfer runs only in seconds
+ * without sync packet, status slot of known slave or forced slot, in
+ * other seconds the bootloader is put on hold. Chunks are requested from
+ * host in groups of half cache, next group ahead, by line
+ * "U: aa ii cccc nn" (address, image id, first chunk, count of chunks).
+ * Command 'U' for a slave is queued only for the image announced by host,
+ * a slave never reboots to the bootloader for an image the host lacks.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// HR20 Project includes
+#include "config.h"
+#include "master.h"
+#include "com.h"
+#include "status.h"
+#include "relay.h"
+#include "common/ota.h"
+#include "common/rtc.h"
+#include "common/wireless.h"
+
+#if (OTA == 1)
+
+typedef struct
+{
+	uint8_t id;             //!< image id, 0 = free item
+	uint16_t chunk;
+	uint8_t data[OTA_CHUNK];
+} ota_chunk_t;
+
+static ota_chunk_t ota_cache[OTA_CACHE];
+static uint8_t ota_victim = 0;          //!< next cache item to replace
+static uint8_t ota_req_id = 0;          //!< last request to host
+static uint16_t ota_req_chunk;
+static uint8_t ota_req_time;            //!< RTC second of last request
+static uint8_t ota_img_id = 0;          //!< image announced by host, 0 = none
+static uint16_t ota_img_size;
+
+/*!
+ *******************************************************************************
+ *  \brief find cached chunk
+ *
+ *  \note returns NULL if chunk is not in cache
+ ******************************************************************************/
+static ota_chunk_t *OTA_find(uint8_t id, uint16_t chunk)
+{
+	uint8_t i;
+
+	for (i = 0; i < OTA_CACHE; i++)
+	{
+		if ((ota_cache[i].id == id) && (ota_cache[i].chunk == chunk))
+		{
+			return &ota_cache[i];
+		}
+	}
+	return NULL;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief store chunk from host
+ *
+ *  \note oldest chunk is replaced, host sends chunks in order of request
+ ******************************************************************************/
+void OTA_store(uint8_t id, uint16_t chunk, uint8_t *data)
+{
+	ota_chunk_t *p = OTA_find(id, chunk);
+
+	if (id == 0)
+	{
+		return;
+	}
+	if (p == NULL)
+	{
+		p = &ota_cache[ota_victim];
+		ota_victim = (ota_victim + 1) % OTA_CACHE;
+	}
+	p->id = id;
+	p->chunk = chunk;
+	memcpy(p->data, data, OTA_CHUNK);
+}
+
+/*!
+ *******************************************************************************
+ *  \brief image of next update from host
+ ******************************************************************************/
+void OTA_announce(uint8_t id, uint16_t size)
+{
+	ota_img_id = id;
+	ota_img_size = size;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief update command of slave matches announced image
+ ******************************************************************************/
+bool OTA_announced(uint8_t id, uint16_t size)
+{
+	return (id != 0) && (id == ota_img_id) && (size == ota_img_size);
+}
+
+/*!
+ *******************************************************************************
+ *  \brief ask host for chunks
+ *
+ *  \note same request is repeated after OTA_REQ_REPEAT seconds
+ ******************************************************************************/
+static void OTA_request(uint8_t addr, uint8_t id, uint16_t chunk)
+{
+	uint8_t s = RTC_GetSecond();
+
+	if ((id == ota_req_id) && (chunk == ota_req_chunk)
+	    && ((uint8_t)((s + 60 - ota_req_time) % 60) < OTA_REQ_REPEAT))
+	{
+		return;
+	}
+	ota_req_id = id;
+	ota_req_chunk = chunk;
+	ota_req_time = s;
+	COM_ota_request(addr, id, chunk, OTA_CACHE / 2);
+}
+
+/*!
+ *******************************************************************************
+ *  \brief second is used by other communication
+ *
+ *  \note sync packet, status slot of known slave, forced slot
+ ******************************************************************************/
+static bool OTA_busy(uint8_t s)
+{
+	if (((s % 30) == 0) || ((s % 30) == 29))
+	{
+		return true; // sync packet and slaves waiting for it
+	}
+	if (s < 30)
+	{
+		status_item_t *st = STATUS_get(s);
+		return (st != NULL) && (st->cmd != 0);
+	}
+	return MASTER_forced_addr(s) != 0;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief time to next idle part of second
+ *
+ *  \returns 0 when transfer can continue, else hold time in 10 ms units
+ ******************************************************************************/
+static uint8_t OTA_hold(void)
+{
+	uint8_t s = RTC_GetSecond();
+	uint8_t t = s;
+	uint16_t hold;
+
+	if (!OTA_busy(s) && (RTC_s100 < OTA_IDLE_END))
+	{
+		return 0;
+	}
+	do
+	{
+		t = (t + 1) % 60;
+	} while (OTA_busy(t) && (t != s));
+	hold = ((t + 60 - s) % 60) * 100 + OTA_IDLE_START - RTC_s100;
+	return (hold > OTA_HOLD_MAX) ? OTA_HOLD_MAX : hold;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief process boot frame, prepare reply into wireless buffer
+ *
+ *  \param d address and data of frame (MAC is checked)
+ *  \returns true when reply is prepared
+ ******************************************************************************/
+bool OTA_packet(uint8_t *d, uint8_t len)
+{
+	uint8_t addr = d[0] & ~OTA_ADDR_FLAG;
+	uint8_t id = d[2];
+	uint16_t chunk = ((uint16_t)d[3] << 8) | d[4];
+	uint16_t group = chunk - (chunk % (OTA_CACHE / 2));
+	uint8_t hold;
+	ota_chunk_t *p = NULL;
+
+	if ((len < 1 + OTA_HDR) || (d[1] != OTA_REQ) || (id == 0))
+	{
+		return false;
+	}
+	hold = OTA_hold();
+	if (hold == 0)
+	{
+		p = OTA_find(id, chunk);
+		if (p == NULL)
+		{
+			OTA_request(addr, id, group);
+			hold = OTA_HOST_HOLD;
+		}
+		else if (OTA_find(id, group + OTA_CACHE / 2) == NULL)
+		{
+			OTA_request(addr, id, group + OTA_CACHE / 2); // next group ahead
+		}
+	}
+	wireless_buf_ptr = 0;
+	wireless_putchar((p != NULL) ? OTA_DATA : OTA_WAIT);
+	wireless_putchar(id);
+	wireless_putchar(chunk >> 8);
+	wireless_putchar(chunk & 0xff);
+	wireless_putchar(hold);
+	if (p != NULL)
+	{
+		uint8_t i;
+		for (i = 0; i < OTA_CHUNK; i++)
+		{
+			wireless_putchar(p->data[i]);
+		}
+	}
+	return true;
+}
+
+#endif
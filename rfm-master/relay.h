@@ -0,0 +1,48 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       relay.h
+ * \brief      firmware image relay for slaves in RF bootloader
+ */
+
+#pragma once
+
+#if (OTA == 1)
+
+#ifndef OTA_CACHE
+#define OTA_CACHE 8             //!< image chunks kept in RAM, half of it is requested ahead
+#endif
+#define OTA_IDLE_START 5        //!< 1/100 s, bootloader starts after sync of the second
+#define OTA_IDLE_END 85         //!< 1/100 s, no transfer started after it
+#define OTA_HOST_HOLD 20        //!< bootloader waits for chunk from host (10 ms units)
+#define OTA_REQ_REPEAT 3        //!< seconds before same chunk is requested from host again
+
+void OTA_store(uint8_t id, uint16_t chunk, uint8_t *data);
+void OTA_announce(uint8_t id, uint16_t size);
+bool OTA_announced(uint8_t id, uint16_t size);
+bool OTA_packet(uint8_t *d, uint8_t len);
+
+#endif
@@ -108,6 +108,23 @@
 #define RFM_SDO_PIN                 PINB
 #define RFM_SDO_BITPOS              6
 #endif
+// all master boards have RFM12 on hardware SPI pins (nSEL on SS pin, output)
+#ifndef RFM_HW_SPI
+#define RFM_HW_SPI 1
+#endif
+
+#if (RFM_HW_SPI == 1)
+// SPI mode 0, master; FIFO read must be slower than fref/4 (2.5MHz), other commands not
+#define RFM_SPI_CLK_FAST() (SPSR = _BV(SPI2X), SPCR = _BV(SPE) | _BV(MSTR))                 // F_CPU/2
+#if (F_CPU < 10000000UL)
+#define RFM_SPI_CLK_SLOW() (SPSR = 0, SPCR = _BV(SPE) | _BV(MSTR))                          // F_CPU/4
+#elif (F_CPU < 20000000UL)
+#define RFM_SPI_CLK_SLOW() (SPSR = _BV(SPI2X), SPCR = _BV(SPE) | _BV(MSTR) | _BV(SPR0))     // F_CPU/8
+#else
+#define RFM_SPI_CLK_SLOW() (SPSR = 0, SPCR = _BV(SPE) | _BV(MSTR) | _BV(SPR0))              // F_CPU/16
+#endif
+#endif
+
 /*
  * #define RFM_NIRQ_DDR		DDRE
  * #define RFM_NIRQ_PIN		PINE
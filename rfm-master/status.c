@@ -0,0 +1,190 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Dario Carluccio (hr20-at-carluccio-dot-de)
+ *				2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       status.c
+ * \brief      last known status of each slave
+ * \author     Jiri Dobry <jdobry-at-centrum-dot-cz>
+ * \date       $Date$
+ * $Rev$
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// HR20 Project includes
+#include "config.h"
+#include "status.h"
+#include "common/rtc.h"
+
+#if (STATUS_CACHE == 1)
+
+status_item_t STATUS_buf[STATUS_ADDR_MAX];
+
+static uint8_t status_expect = 0;       //!< slave forced to send in current second
+static bool status_heard = false;       //!< good packet from status_expect received
+static uint8_t status_phase_addr = 0;   //!< slave with phase measured in current second
+
+/*!
+ *******************************************************************************
+ *  \brief get cache item for addr
+ *
+ *  \note returns NULL for master and broadcast addresses
+ ******************************************************************************/
+status_item_t *STATUS_get(uint8_t addr)
+{
+	if ((addr == 0) || (addr > STATUS_ADDR_MAX))
+	{
+		return NULL;
+	}
+	return &STATUS_buf[addr - 1];
+}
+
+/*!
+ *******************************************************************************
+ *  \brief count received packet
+ *
+ *  \note for wrong MAC the addr is not authenticated, it is still best guess
+ ******************************************************************************/
+void STATUS_packet(uint8_t addr, bool mac_ok, int8_t afc)
+{
+	status_item_t *s = STATUS_get(addr);
+
+	if (s == NULL)
+	{
+		return;
+	}
+	if (mac_ok)
+	{
+		if ((s->pkt_ok == 0) && (s->afc_min == 0) && (s->afc_max == 0))
+		{
+			s->afc_min = afc; // first packet
+			s->afc_max = afc;
+		}
+		s->pkt_ok++;
+		s->afc = afc;
+		if (afc < s->afc_min)
+		{
+			s->afc_min = afc;
+		}
+		if (afc > s->afc_max)
+		{
+			s->afc_max = afc;
+		}
+		if (addr == status_expect)
+		{
+			status_heard = true;
+		}
+		if (addr != status_phase_addr)
+		{
+			s->phase = RTC_GetS100(); // first packet in this second
+			status_phase_addr = addr;
+		}
+	}
+	else
+	{
+		s->pkt_err++;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief store D/A/M record
+ *
+ *  \note d points to command char, record must be complete
+ ******************************************************************************/
+void STATUS_record(uint8_t addr, uint8_t *d)
+{
+	status_item_t *s = STATUS_get(addr);
+
+	if (s == NULL)
+	{
+		return;
+	}
+	s->cmd = d[0];
+	memcpy(s->rec, d + 1, STATUS_REC_SIZE);
+	s->age = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief age all records, call it once per second
+ *
+ *  \note expect is slave forced by sync packet to send in the new second,
+ *  \note missed counter of previous one is incremented if it was not heard
+ ******************************************************************************/
+void STATUS_tick(uint8_t expect)
+{
+	uint8_t i;
+	status_item_t *s = STATUS_get(status_expect);
+
+	if ((s != NULL) && !status_heard)
+	{
+		s->missed++;
+	}
+	status_expect = expect;
+	status_heard = false;
+	status_phase_addr = 0;
+
+	for (i = 0; i < STATUS_ADDR_MAX; i++)
+	{
+		if (STATUS_buf[i].age != 0xffff)
+		{
+			STATUS_buf[i].age++;
+		}
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief all slaves are in time sync
+ *
+ *  \note true when at least one slave sent status record recently and none
+ *  \note of recent ones reports sync error or transmits out of expected phase
+ ******************************************************************************/
+bool STATUS_sync_stable(void)
+{
+	uint8_t i;
+	bool any = false;
+
+	for (i = 0; i < STATUS_ADDR_MAX; i++)
+	{
+		status_item_t *s = &STATUS_buf[i];
+		if ((s->cmd == 0) || (s->age >= STATUS_STABLE_AGE))
+		{
+			continue;
+		}
+		if ((s->rec[2] & STATUS_ERR_RFM_SYNC)
+		    || (s->phase < STATUS_PHASE_MIN) || (s->phase > STATUS_PHASE_MAX))
+		{
+			return false;
+		}
+		any = true;
+	}
+	return any;
+}
+
+#endif
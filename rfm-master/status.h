@@ -0,0 +1,74 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Dario Carluccio (hr20-at-carluccio-dot-de)
+ *				2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       status.h
+ * \brief      last known status of each slave
+ * \author     Jiri Dobry <jdobry-at-centrum-dot-cz>
+ * \date       $Date$
+ * $Rev$
+ */
+
+#pragma once
+
+#if (STATUS_CACHE == 1)
+
+#define STATUS_ADDR_MAX 29 //!< slaves use address 1..29 (one time slot each)
+#define STATUS_REC_SIZE 9  //!< D/A/M record without command char
+
+// sync is good when first packet of slave time slot starts in this part of second
+#ifndef STATUS_PHASE_MIN
+#define STATUS_PHASE_MIN 10 //!< 1/100 s
+#endif
+#ifndef STATUS_PHASE_MAX
+#define STATUS_PHASE_MAX 40 //!< 1/100 s
+#endif
+#define STATUS_STABLE_AGE 900 //!< only slaves with status record younger than this (s) are evaluated
+#define STATUS_ERR_RFM_SYNC (1 << 4) //!< CTL_ERR_RFM_SYNC in error byte of status record
+
+typedef struct
+{
+	uint8_t cmd;                    //!< 'D','A','M' or 0 if no record received yet
+	uint8_t rec[STATUS_REC_SIZE];   //!< last status record, must follow cmd (printed as one record)
+	uint16_t age;                   //!< seconds since rec was received, 0xffff = too old
+	int8_t afc;                     //!< AFC of last good packet
+	int8_t afc_min;                 //!< AFC range of good packets since reset
+	int8_t afc_max;
+	uint8_t pkt_ok;                 //!< good packets counter (wrap around)
+	uint8_t pkt_err;                //!< packets with wrong MAC (wrap around)
+	uint8_t missed;                 //!< forced slots without good packet (wrap around)
+	uint8_t phase;                  //!< 1/100 s of first good packet in last time slot
+} status_item_t;
+
+extern status_item_t STATUS_buf[STATUS_ADDR_MAX];
+
+void STATUS_packet(uint8_t addr, bool mac_ok, int8_t afc);
+void STATUS_record(uint8_t addr, uint8_t *d);
+void STATUS_tick(uint8_t expect);
+bool STATUS_sync_stable(void);
+status_item_t *STATUS_get(uint8_t addr);
+
+#endif
@@ -49,6 +49,7 @@
 #include "controller.h"
 #include "menu.h"
 #include "common/wireless.h"
+#include "common/ota.h"
 #include "debug.h"
 
 
@@ -681,14 +682,86 @@ static void COM_wireless_word(uint16_t w)
 	wireless_putchar(w & 0xff);
 }
 
+#if (OTA == 1)
+/*!
+ *******************************************************************************
+ *  \brief store firmware update request for RF bootloader
+ *
+ *  \note bootloader does not know EEPROM layout of application, it gets copy
+ *  \note of radio settings; magic is written last
+ ******************************************************************************/
+static void COM_ota_request(uint8_t id, uint16_t size)
+{
+	uint8_t i;
+
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_ID, id);
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_SIZE_H, size >> 8);
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_SIZE_L, size & 0xff);
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_PAGES, 0);
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_DEVADDR, config.RFM_devaddr);
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_RATE, config.RFM_rate);
+#if (RFM_TUNING > 0)
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_FREQ, config.RFM_freqAdjust);
+#else
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_FREQ, 0);
+#endif
+	for (i = 0; i < 8; i++)
+	{
+		EEPROM_write(OTA_EE_ADDR + OTA_EE_KEY + i, config.security_key[i]);
+	}
+	EEPROM_write(OTA_EE_ADDR + OTA_EE_MAGIC, OTA_MAGIC);
+}
+
+/*!
+ *******************************************************************************
+ *  \brief image id was installed by RF bootloader and is running
+ *
+ *  \note bootloader leaves id and written pages after verified image, pages
+ *  \note are 0 when it kept old application
+ ******************************************************************************/
+static bool COM_ota_running(uint8_t id)
+{
+	uint8_t pages = EEPROM_read(OTA_EE_ADDR + OTA_EE_PAGES);
+
+	return (EEPROM_read(OTA_EE_ADDR + OTA_EE_MAGIC) != OTA_MAGIC)
+	       && (EEPROM_read(OTA_EE_ADDR + OTA_EE_ID) == id)
+	       && (pages != 0) && (pages != OTA_PAGES_RESTART);
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  \brief command with tag was not run yet
+ *
+ *  \note for commands which can not run twice (reboot), tag of last one is
+ *  \note kept in EEPROM over the reboot; tag 0 is always run
+ *******************************************************************************
+ */
+static bool COM_tag_new(uint8_t tag)
+{
+	if (tag == 0)
+	{
+		return true;
+	}
+	if ((uint8_t) ~EEPROM_read(EE_CMD_TAG_ADDR) == tag)
+	{
+		return false; // reply was lost, master sends it again
+	}
+	EEPROM_write(EE_CMD_TAG_ADDR, ~tag);
+	return true;
+}
+
 /*!
  *******************************************************************************
  *  \brief parse command from wireless
+ *
+ *  \note "#tt" before command is its tag from host, echoed like command
  *******************************************************************************
  */
 void COM_wireless_command_parse(uint8_t *rfm_framebuf, uint8_t rfm_framepos)
 {
 	uint8_t pos = 0;
+	uint8_t tag = 0;
 
 	while (rfm_framepos > pos)
 	{
@@ -696,6 +769,10 @@ void COM_wireless_command_parse(uint8_t *rfm_framebuf, uint8_t rfm_framepos)
 		wireless_putchar(c | 0x80);
 		switch (c)
 		{
+		case '#':
+			tag = rfm_framebuf[pos++];
+			wireless_putchar(tag);
+			continue; // tag belongs to next command
 		case 'V':
 			print_version(true);
 			break;
@@ -753,7 +830,7 @@ void COM_wireless_command_parse(uint8_t *rfm_framebuf, uint8_t rfm_framepos)
 			pos++;
 			break;
 		case 'B':
-			if ((rfm_framebuf[pos] == 0x13) && (rfm_framebuf[pos + 1] == 0x24))
+			if ((rfm_framebuf[pos] == 0x13) && (rfm_framebuf[pos + 1] == 0x24) && COM_tag_new(tag))
 			{
 				reboot = true;
 			}
@@ -785,10 +862,78 @@ void COM_wireless_command_parse(uint8_t *rfm_framebuf, uint8_t rfm_framepos)
 			wireless_putchar(menu_locked);
 			pos++;
 			break;
+#if (OTA == 1)
+		case 'U':
+		{
+			// firmware update, reboot to bootloader after reply
+			// reply is size, 0 for bad size, 0xffff when image is running already
+			uint16_t size = ((uint16_t)rfm_framebuf[pos + 1] << 8) | rfm_framebuf[pos + 2];
+			if ((size != 0) && (size <= OTA_APP_MAX) && COM_ota_running(rfm_framebuf[pos]))
+			{
+				size = 0xffff; // repeated request after update
+			}
+			else if ((size != 0) && (size <= OTA_APP_MAX))
+			{
+				if (COM_tag_new(tag))
+				{
+					COM_ota_request(rfm_framebuf[pos], size);
+					reboot = true;
+				}
+			}
+			else
+			{
+				size = 0;
+			}
+			wireless_putchar(rfm_framebuf[pos]);
+			COM_wireless_word(size);
+			pos += 3;
+		}
+		break;
+#endif
 		default:
 			break;
 		}
+		tag = 0;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  \brief apply group command from sync packet
+ *
+ *  \note no echo, new state is confirmed by status record in next own slot
+ *******************************************************************************
+ */
+void COM_wireless_group_command(uint8_t cmd, uint8_t arg)
+{
+	switch (cmd)
+	{
+	case 'M':
+		CTL_change_mode(arg);
+		break;
+	case 'A':
+		if ((arg < TEMP_MIN - 1) || (arg > TEMP_MAX + 1))
+		{
+			return;
+		}
+		CTL_set_temp(arg);
+		break;
+	case 'L':
+		if (arg > 1)
+		{
+			return;
+		}
+		menu_locked = arg;
+		break;
+#if (WL_RATE)
+	case WL_RATE_CMD:
+		wirelessRateSchedule(arg);
+		return; // radio setting, not visible in status
+#endif
+	default:
+		return;
 	}
+	COM_print_debug(1);
 }
 #endif
 
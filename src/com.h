@@ -46,6 +46,7 @@ void COM_print_debug(uint8_t type);
 void COM_commad_parse(void);
 #if RFM == 1
 void COM_wireless_command_parse(uint8_t *rfm_framebuf, uint8_t rfm_framepos);
+void COM_wireless_group_command(uint8_t cmd, uint8_t arg);
 #endif
 
 void COM_debug_print_motor(int8_t dir, uint16_t m, uint8_t pwm);
@@ -116,6 +116,7 @@ typedef struct                                                  // each variable
 #if (RFM == 1)
 	/*    */ uint8_t RFM_devaddr;                           //!< HR20's own device address in RFM radio networking. =0 mean disable radio
 	/*    */ uint8_t security_key[8];                       //!< key for encrypted radio messasges
+	/*    */ uint8_t RFM_rate;                              //!< RFM12 data rate, follows rate negotiation of master
 #if (RFM_TUNING > 0)
 	/*    */ int8_t RFM_freqAdjust;                         //!< RFM12 Frequency adjustment
 	/*    */ uint8_t RFM_tuning;                            //!< RFM12 tuning mode
@@ -132,6 +133,7 @@ extern config_t config;
 
 extern uint16_t EEPROM ee_timers[8][RTC_TIMERS_PER_DOW];
 extern uint8_t EEPROM ee_layout;
+#define EE_CMD_TAG_ADDR 0x094   //!< ee_cmd_tag, erased value 0xff reads as no tag
 
 // Boot Timeslots -> move to CONFIG.H
 // 10 Minutes after BOOT_hh:00
@@ -140,10 +142,11 @@ extern uint8_t EEPROM ee_layout;
 #define BOOT_ON2      (16 * 60 + 0x2000)        //!<  16:00
 #define BOOT_OFF2     (21 * 60 + 0x1000)        //!<  21:00
 
+// 0x16/0x17: layout 0x14/0x15 with RFM_rate after security_key
 #if (HW_WINDOW_DETECTION)
-#define EE_LAYOUT (0x15)
+#define EE_LAYOUT (0x17)
 #else
-#define EE_LAYOUT (0x14)
+#define EE_LAYOUT (0x16)
 #endif
 #if (BOOST_CONTROLER_AFTER_CHANGE) || (TEMP_COMPENSATE_OPTION)
 #define EE_LAYOUT (0xff)
@@ -183,15 +186,22 @@ uint16_t EEPROM ee_timers[8][RTC_TIMERS_PER_DOW] = { //128bytes
 	{ BOOT_ON1, BOOT_OFF1, BOOT_ON2, BOOT_OFF2, 0x2FFF, 0x1FFF, 0x2FFF, 0x1FFF }
 };
 
-uint8_t EEPROM ee_reserved2_60 [60] = {
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+/* eeprom address 0x084 */
+uint8_t EEPROM ee_ota[16] = { // update request for RF bootloader, see common/ota.h
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* eeprom address 0x094 */
+uint8_t EEPROM ee_cmd_tag = 0xff; // inverted tag of last 'B' / 'U' command from master, see COM_wireless_command_parse
+
+uint8_t EEPROM ee_reserved2_43 [43] = {
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff
+	0xff, 0xff, 0xff
 };
 
 ;                                       // reserved for future
@@ -283,6 +293,7 @@ uint8_t EEPROM ee_config[][4] = {       // must be alligned to 4 bytes
 	/*    */ {        SECURITY_KEY_5,        SECURITY_KEY_5,     0x00,                      0xff }, //!< security_key[5] for encrypted radio messasges
 	/*    */ {        SECURITY_KEY_6,        SECURITY_KEY_6,     0x00,                      0xff }, //!< security_key[6] for encrypted radio messasges
 	/*    */ {        SECURITY_KEY_7,        SECURITY_KEY_7,     0x00,                      0xff }, //!< security_key[7] for encrypted radio messasges
+	/*    */ {      RFM_RATE_DEFAULT,      RFM_RATE_DEFAULT,        0,    RFM_RATE_COUNT - 1 }, //!< RFM_rate: 0 = 9600, 1 = 19200, 2 = 38400, 3 = 57600 bps
  #if (RFM_TUNING > 0)
 	/*    */ {                     0,                     0,     0x00,                      0xff }, //!< RFM12 Frequency adjustment, 2's complement
 	/*    */ {       RFM_TUNING_MODE,                     0,     0x00,                      0x01 }, //!< RFM12 tuning mode, 0 = tuning mode off (narrow, high data rate),
@@ -306,6 +306,10 @@ int __attribute__ ((noreturn)) main(void)
 							    (wl_force_addr1 == 0xff) &&
 							    (RTC_GetSecond() % 30 == config.RFM_devaddr) &&
 							    ((wl_force_flags >> config.RFM_devaddr) & 1)
+						    ) || (
+							    (wl_force_addr1 == WL_FORCE_SHARES) &&
+							    (RTC_GetSecond() > 30) &&
+							    ((wl_force_flags >> (RTC_GetSecond() - 30)) & 1)
 						    )
 					    )
 					)       // collission protection: every HR20 shall send when the second counter is equal to it's own address.
@@ -315,6 +319,12 @@ int __attribute__ ((noreturn)) main(void)
 					}
 					if ((RTC_GetSecond() == 59) || (RTC_GetSecond() == 29))
 					{
+#if (WL_RATE)
+						if (RTC_GetSecond() == 59)
+						{
+							wirelessRateCheck();
+						}
+#endif
 #if (WL_SKIP_SYNC)
 						if (wl_skip_sync != 0)
 						{
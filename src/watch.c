@@ -41,6 +41,7 @@
 #include "motor.h"
 #include "watch.h"
 #include "debug.h"
+#include "common/wireless.h"
 
 #define B8 0x0000
 #define B16 0x8000
@@ -50,9 +51,9 @@ int16_t MOTOR_PosMax;
 
 
 #if DEBUG_MOTOR_COUNTER
-#define WATCH_LAYOUT 0x85
+#define WATCH_LAYOUT 0x86
 #else
-#define WATCH_LAYOUT 0x05
+#define WATCH_LAYOUT 0x06
 #endif
 
 
@@ -69,6 +70,12 @@ static const uint16_t watch_map[WATCH_N] PROGMEM = {
 #if DEBUG_MOTOR_COUNTER
 	/* 09 */ ((uint16_t)&MOTOR_counter) + B16,
 	/* 0a */ ((uint16_t)&MOTOR_counter) + 2 + B16,
+#else
+	/* 09 */ 0,
+	/* 0a */ 0,
+#endif
+#if (RFM == 1) && (WL_LBT)
+	/* 0b */ ((uint16_t)&wl_lbt_busy) + B8,
 #endif
 };
 
@@ -35,4 +35,4 @@
 
 uint16_t watch(uint8_t addr);
 
-#define WATCH_N (11)
+#define WATCH_N (12)
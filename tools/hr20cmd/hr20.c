@@ -28,6 +28,7 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include "hr20proto.h"
 #include "serial.h"
 #include "hr20.h"
 /*!
@@ -44,21 +45,19 @@ void hr20GetTimer(int day, int slot, char *value)
 {
 	char buffer[20];
 	char response[255];
-	char *result;
+	hr20_msg_t m;
 
 	sprintf(buffer,"\rR%d%d\r",day,slot);
 	
 	while(1)
 	{
 		serialCommand(buffer, response);
-		if(response[0] == 'R' )
+		if(hr20_parse(response, strcspn(response, "\r\n"), &m) == HR20_M_RECORD && m.cmd == 'R')
 			break;
 		usleep(1000);
 	}
 	
-	result = strtok(response,"=");
-	result = strtok(NULL,"=");
-	strcpy(value,result);
+	sprintf(value,"%04x",m.value);
 }
 
 int hexCharToInt(char c)
@@ -268,61 +267,38 @@ void hr20ParseStatusLine(char *line)
 	/* example line as we receive it:
 	  D: d6 10.01.09 22:19:14 M V: 54 I: 1975 S: 2000 B: 3171 Is: 00b9 X
 	 */
+	hr20_msg_t m;
 
 	if(!line)
 		return;
 
-	char *trenner = (char*)strtok(line," ");
-	if(!trenner)
-		return;
-
-	if(trenner[0] != 'D')
+	if(hr20_parse(line, strcspn(line, "\r\n"), &m) != HR20_M_STATUS)
 	{
 		printf("This is no status line\n");
 		return;
 	}
-	
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("Weekday: %d\n", trenner[1]-48);
 
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("Date:    %s\n", trenner);
+	printf("Weekday: %d\n", m.st.dow);
+	printf("Date:    %02d.%02d.%02d\n", m.st.day, m.st.month, m.st.year);
+	printf("Time:    %02d:%02d:%02d\n", m.st.hour, m.st.minute, m.st.second);
 
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("Time:    %s\n", trenner);
-
-	trenner = (char*)strtok(NULL," ");
-	if(trenner[0] == 'M')
+	if(m.st.mode == 'M')
 		printf("Mode:    manual\n");
-	else if(trenner[0] == 'A')
+	else if(m.st.mode == 'A' || m.st.mode == '-')
 		printf("Mode:    auto\n");
 	else
 		printf("Mode:    unknown\n");
 
-	trenner = (char*)strtok(NULL," ");
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("Valve:   %s%%\n",trenner);
-
-	trenner = (char*)strtok(NULL," ");
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("T is:    %.2f C\n",(float)atoi(trenner)/100);
-
-	trenner = (char*)strtok(NULL," ");
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("T set:   %.2f C\n",(float)atoi(trenner)/100);
-
-	trenner = (char*)strtok(NULL," ");
-	trenner = (char*)strtok(NULL," ");
-	if(trenner)
-		printf("Bat:     %.2f V\n",(float)atoi(trenner)/1000);
+	printf("Valve:   %d%%\n", m.st.valve);
+	printf("T is:    %.2f C\n", (float)m.st.real/100);
+	if(m.st.boot)
+		printf("T set:   boot\n");
+	else
+		printf("T set:   %.2f C\n", (float)m.st.wanted/100);
+	printf("Bat:     %.2f V\n", (float)m.st.battery/1000);
+	if(m.st.error)
+		printf("Error:   %02x\n", m.st.error);
 
 	return;
 }
 
-
@@ -0,0 +1,510 @@
+/*
+ *  Open HR20 - fleet analytics
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       hr20fit.c
+ * \brief      thermal model of each room from log table of daemon.php
+ *
+ * Streams log table once in time order (index log_time_addr) and fits
+ * per room
+ *
+ *	dT/dt = gain * valve - loss * T + c
+ *
+ * by least squares, normal equations are accumulated per sample pair, no
+ * sample is kept in memory. Rooms are ranked by energy waste (valve open
+ * while room is above wanted temperature), recommended P_Factor,
+ * I_Factor, valve_center and window thresholds are printed as S commands
+ * or queued to command_queue.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <time.h>
+#include <sqlite3.h>
+
+#define ADDR_MAX 256
+#define GAP_MIN 30              //!< shorter sample pairs are skipped [s]
+#define GAP_MAX 1800            //!< longer sample pairs are skipped [s]
+#define FIT_MIN 100             //!< sample pairs needed for recommendation
+#define WASTE_MARGIN 30         //!< room above wanted + margin is waste [1/100 C]
+
+// config_t index, same for all EEPROM layouts
+#define IDX_P_FACTOR 0x06
+#define IDX_I_FACTOR 0x07
+#define IDX_PID_INTERVAL 0x0a
+#define IDX_VALVE_MIN 0x0b
+#define IDX_VALVE_CENTER 0x0c
+#define IDX_VALVE_MAX 0x0d
+#define IDX_LAYOUT 0xff
+// layouts 0x14 and 0x16 only (no HW_WINDOW_DETECTION), see frontend/www/ee_layouts/14.php
+#define LAYOUT_SW_WINDOW(l) (((l) == 0x14) || ((l) == 0x16))
+#define IDX_WINDOW_OPEN_DIFF 0x26
+#define IDX_WINDOW_CLOSE_DIFF 0x27
+#define IDX_WINDOW_OPEN_TIME 0x28
+
+typedef struct
+{
+	// last sample
+	int32_t time;
+	int16_t real;
+	int16_t wanted;
+	uint8_t valve;
+	uint8_t valid;
+	// least squares, x = (valve, T, 1), y = dT/dt
+	uint32_t n;
+	double xx[3][3];
+	double xy[3];
+	double yy;
+	// cooling rate for window threshold
+	uint32_t cool_n;
+	double cool_sum;
+	double cool_sq;
+	// time weighted statistics
+	double hours;
+	double heat_hours;      //!< hours with wanted temperature
+	double wanted_sum;      //!< wanted * hours
+	double over_sum;        //!< overshoot * hours
+	double valve_sum;       //!< valve * hours
+	double waste_sum;       //!< valve * hours above wanted
+	// result
+	double gain;            //!< [C/h per %]
+	double loss;            //!< [1/h]
+	double c;               //!< [C/h]
+	double rms;             //!< residual [C/h]
+	double waste;           //!< [valve hours]
+	int fit;
+	int16_t ee[ADDR_MAX];   //!< config values from eeprom table, -1 unknown
+} room_t;
+
+static room_t *rooms[ADDR_MAX];
+static double lag = 0.25;       //!< dead time of radiator and sensor [h]
+static int verbose;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20fit [-d <db>] [-f <from>] [-t <to>] [-a <addr>] [-l <min>] [-q] [-v]\n"
+		"\t-d <db>\t\tsqlite database of daemon.php (default /tmp/openhr20.sqlite)\n"
+		"\t-f <time>\tfirst sample, unix time or days back when negative\n"
+		"\t-t <time>\tlast sample, unix time\n"
+		"\t-a <addr>\tonly this room\n"
+		"\t-l <min>\tdead time of radiator and sensor (default 15)\n"
+		"\t-q\t\tinsert recommended S commands to command_queue\n"
+		"\t-v\t\tprint model coefficients\n");
+	exit(1);
+}
+
+static room_t *room(int addr)
+{
+	if (rooms[addr] == NULL)
+	{
+		int i;
+		rooms[addr] = calloc(1, sizeof(room_t));
+		if (rooms[addr] == NULL)
+		{
+			perror("hr20fit");
+			exit(1);
+		}
+		for (i = 0; i < ADDR_MAX; i++)
+		{
+			rooms[addr]->ee[i] = -1;
+		}
+	}
+	return rooms[addr];
+}
+
+/*!
+ *******************************************************************************
+ *  add one sample, statistics are for interval from previous sample
+ ******************************************************************************/
+static void sample(room_t *r, int32_t time, int real, int wanted, int valve, int ok)
+{
+	double dt, h, x[3], y;
+	int i, j;
+
+	dt = time - r->time;
+	if (r->valid && ok && (dt >= GAP_MIN) && (dt <= GAP_MAX))
+	{
+		h = dt / 3600.0;
+		y = (real - r->real) / 100.0 / h;
+		x[0] = r->valve;
+		x[1] = -r->real / 100.0;
+		x[2] = 1.0;
+		for (i = 0; i < 3; i++)
+		{
+			for (j = i; j < 3; j++)
+			{
+				r->xx[i][j] += x[i] * x[j];
+			}
+			r->xy[i] += x[i] * y;
+		}
+		r->yy += y * y;
+		r->n++;
+		if (y < 0)
+		{
+			r->cool_n++;
+			r->cool_sum += -y;
+			r->cool_sq += y * y;
+		}
+		r->hours += h;
+		r->valve_sum += r->valve * h;
+		if (r->wanted > 0)
+		{
+			r->heat_hours += h;
+			r->wanted_sum += r->wanted / 100.0 * h;
+			if (r->real > r->wanted)
+			{
+				r->over_sum += (r->real - r->wanted) / 100.0 * h;
+			}
+			if (r->real > r->wanted + WASTE_MARGIN)
+			{
+				r->waste_sum += r->valve * h;
+			}
+		}
+	}
+	r->time = time;
+	r->real = real;
+	r->wanted = wanted;
+	r->valve = valve;
+	r->valid = ok;
+}
+
+/*!
+ *******************************************************************************
+ *  solve normal equations (3x3, symmetric) by gaussian elimination
+ *
+ *  \returns false for singular system
+ ******************************************************************************/
+static int solve(room_t *r)
+{
+	double a[3][4], b[3], f;
+	int i, j, k;
+
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			a[i][j] = (j >= i) ? r->xx[i][j] : r->xx[j][i];
+		}
+		a[i][3] = r->xy[i];
+	}
+	for (i = 0; i < 3; i++)
+	{
+		k = i;
+		for (j = i + 1; j < 3; j++)
+		{
+			if (fabs(a[j][i]) > fabs(a[k][i]))
+			{
+				k = j;
+			}
+		}
+		if (fabs(a[k][i]) < 1e-9)
+		{
+			return 0;
+		}
+		for (j = 0; j < 4; j++)
+		{
+			f = a[i][j];
+			a[i][j] = a[k][j];
+			a[k][j] = f;
+		}
+		for (j = i + 1; j < 3; j++)
+		{
+			f = a[j][i] / a[i][i];
+			for (k = i; k < 4; k++)
+			{
+				a[j][k] -= f * a[i][k];
+			}
+		}
+	}
+	for (i = 2; i >= 0; i--)
+	{
+		b[i] = a[i][3];
+		for (j = i + 1; j < 3; j++)
+		{
+			b[i] -= a[i][j] * b[j];
+		}
+		b[i] /= a[i][i];
+	}
+	r->gain = b[0];
+	r->loss = b[1];
+	r->c = b[2];
+	// residual sum of squares = yy - 2 b.xy + b.XX.b = yy - b.xy at the optimum
+	f = r->yy - (b[0] * r->xy[0] + b[1] * r->xy[1] + b[2] * r->xy[2]);
+	r->rms = sqrt(((f > 0) ? f : 0) / r->n);
+	return (r->gain > 0) && (r->loss > 0);
+}
+
+static int ee_get(room_t *r, int idx, int def)
+{
+	return (r->ee[idx] >= 0) ? r->ee[idx] : def;
+}
+
+static int clamp(double v, int min, int max)
+{
+	if (v < min)
+	{
+		return min;
+	}
+	if (v > max)
+	{
+		return max;
+	}
+	return (int)(v + 0.5);
+}
+
+static sqlite3 *db;
+static int queued;
+
+static void command(int addr, room_t *r, int idx, int value)
+{
+	char cmd[8];
+
+	if (ee_get(r, idx, -1) == value)
+	{
+		return;
+	}
+	snprintf(cmd, sizeof(cmd), "S%02x%02x", idx, value);
+	printf("%d %s\n", addr, cmd);
+	if (queued >= 0)
+	{
+		char *sql = sqlite3_mprintf("INSERT INTO command_queue (time,addr,data) VALUES (%d,%d,'%q')",
+					    (int)time(NULL), addr, cmd);
+		if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK)
+		{
+			fprintf(stderr, "hr20fit: %s\n", sqlite3_errmsg(db));
+			exit(1);
+		}
+		sqlite3_free(sql);
+		queued++;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  controller settings from model
+ *
+ *  First order process with dead time, SIMC rules with closed loop time
+ *  constant of at least half of open loop one (valve is very nonlinear).
+ *  Firmware (controller.c): valve% = P_Factor * e / 256 + integral, e in
+ *  1/100 C; integral grows by I_Factor * 8 * e / 65536 each PID_interval.
+ ******************************************************************************/
+static void recommend(int addr, room_t *r)
+{
+	double K = r->gain / r->loss;   // [C per %]
+	double tau = 1.0 / r->loss;     // [h]
+	double tauc = (lag > tau / 2) ? lag : tau / 2;
+	double kc = tau / (K * (tauc + lag)); // [% per C]
+	double ti = (tau < 4 * (tauc + lag)) ? tau : 4 * (tauc + lag);
+	double pid_s = ee_get(r, IDX_PID_INTERVAL, 240 / 5) * 5;
+	double tw = r->wanted_sum / r->heat_hours;
+	int vmin = ee_get(r, IDX_VALVE_MIN, 30);
+	int vmax = ee_get(r, IDX_VALVE_MAX, 80);
+
+	command(addr, r, IDX_P_FACTOR, clamp(kc * 256 / 100, 1, 255));
+	command(addr, r, IDX_I_FACTOR, clamp(kc / (ti * 3600) * pid_s * 65536 / 800, 0, 255));
+	// steady state valve for mean wanted temperature
+	command(addr, r, IDX_VALVE_CENTER, clamp((r->loss * tw - r->c) / r->gain, vmin, vmax));
+	if (LAYOUT_SW_WINDOW(ee_get(r, IDX_LAYOUT, 0x14)) && (r->cool_n > 0))
+	{
+		// fastest natural cooling (mean + 3 sigma) over detection time must not trigger
+		double m = r->cool_sum / r->cool_n;
+		double s = sqrt(fabs(r->cool_sq / r->cool_n - m * m));
+		double t = ee_get(r, IDX_WINDOW_OPEN_TIME, 8) * 15 / 3600.0;
+		int diff = clamp((m + 3 * s) * t * 100, 7, 255);
+		command(addr, r, IDX_WINDOW_OPEN_DIFF, diff);
+		command(addr, r, IDX_WINDOW_CLOSE_DIFF, diff);
+	}
+}
+
+static int by_waste(const void *a, const void *b)
+{
+	const room_t *x = rooms[*(const int *)a];
+	const room_t *y = rooms[*(const int *)b];
+
+	return (x->waste < y->waste) - (x->waste > y->waste);
+}
+
+static void prepare(const char *sql, sqlite3_stmt **st)
+{
+	if (sqlite3_prepare_v2(db, sql, -1, st, NULL) != SQLITE_OK)
+	{
+		fprintf(stderr, "hr20fit: %s\n", sqlite3_errmsg(db));
+		exit(1);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *db_name = "/tmp/openhr20.sqlite";
+	long from = 0, to = 0x7fffffff;
+	int only = -1;
+	int order[ADDR_MAX], count = 0;
+	sqlite3_stmt *st;
+	int opt, i;
+
+	queued = -1;
+	while ((opt = getopt(argc, argv, "d:f:t:a:l:qvh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			db_name = optarg;
+			break;
+		case 'f':
+			from = atol(optarg);
+			if (from < 0)
+			{
+				from = time(NULL) + from * 86400;
+			}
+			break;
+		case 't':
+			to = atol(optarg);
+			break;
+		case 'a':
+			only = atoi(optarg);
+			if ((only <= 0) || (only >= ADDR_MAX))
+			{
+				usage();
+			}
+			break;
+		case 'l':
+			lag = atof(optarg) / 60;
+			if (lag <= 0)
+			{
+				usage();
+			}
+			break;
+		case 'q':
+			queued = 0;
+			break;
+		case 'v':
+			verbose++;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc)
+	{
+		usage();
+	}
+	if (sqlite3_open_v2(db_name, &db, (queued < 0) ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE,
+			    NULL) != SQLITE_OK)
+	{
+		fprintf(stderr, "hr20fit: %s: %s\n", db_name, sqlite3_errmsg(db));
+		return 1;
+	}
+
+	prepare("SELECT addr,time,real,wanted,valve,window,error FROM log"
+		" WHERE time>=?1 AND time<=?2 ORDER BY time", &st);
+	sqlite3_bind_int64(st, 1, from);
+	sqlite3_bind_int64(st, 2, to);
+	while (sqlite3_step(st) == SQLITE_ROW)
+	{
+		int addr = sqlite3_column_int(st, 0);
+		int real = sqlite3_column_int(st, 2);
+		if ((addr <= 0) || (addr >= ADDR_MAX) || ((only > 0) && (addr != only)))
+		{
+			continue;
+		}
+		sample(room(addr), sqlite3_column_int(st, 1), real,
+		       sqlite3_column_int(st, 3), sqlite3_column_int(st, 4),
+		       (real > 0) && (sqlite3_column_int(st, 5) == 0) && (sqlite3_column_int(st, 6) == 0));
+	}
+	sqlite3_finalize(st);
+
+	// current config, table is missing in a fresh database
+	if (sqlite3_prepare_v2(db, "SELECT addr,idx,value FROM eeprom", -1, &st, NULL) == SQLITE_OK)
+	{
+		while (sqlite3_step(st) == SQLITE_ROW)
+		{
+			int addr = sqlite3_column_int(st, 0);
+			int idx = sqlite3_column_int(st, 1);
+			if ((addr > 0) && (addr < ADDR_MAX) && (rooms[addr] != NULL)
+			    && (idx >= 0) && (idx < ADDR_MAX))
+			{
+				rooms[addr]->ee[idx] = sqlite3_column_int(st, 2);
+			}
+		}
+		sqlite3_finalize(st);
+	}
+
+	for (i = 1; i < ADDR_MAX; i++)
+	{
+		room_t *r = rooms[i];
+		if ((r == NULL) || (r->n == 0))
+		{
+			continue;
+		}
+		r->fit = (r->n >= FIT_MIN) && (r->heat_hours > 0) && solve(r);
+		r->waste = r->waste_sum / 100;
+		order[count++] = i;
+	}
+	qsort(order, count, sizeof(order[0]), by_waste);
+
+	printf("addr   hours  valve%%  tau[h]  K[C/%%]  rms[C/h]  overshoot[C]  waste[vh]  waste%%\n");
+	for (i = 0; i < count; i++)
+	{
+		room_t *r = rooms[order[i]];
+		printf("%4d %7.0f %7.1f ", order[i], r->hours, r->valve_sum / r->hours);
+		if (r->fit)
+		{
+			printf("%7.2f %7.3f %9.3f ", 1 / r->loss, r->gain / r->loss, r->rms);
+		}
+		else
+		{
+			printf("%7s %7s %9s ", "-", "-", "-");
+		}
+		printf("%13.2f %10.1f %7.1f\n",
+		       (r->heat_hours > 0) ? r->over_sum / r->heat_hours : 0, r->waste,
+		       (r->valve_sum > 0) ? 100 * r->waste_sum / r->valve_sum : 0);
+		if (verbose && r->fit)
+		{
+			printf("     dT/dt = %.4f * valve - %.4f * T %+.3f  (%u pairs)\n",
+			       r->gain, r->loss, r->c, r->n);
+		}
+	}
+
+	printf("\n");
+	if (queued >= 0)
+	{
+		sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (rooms[order[i]]->fit)
+		{
+			recommend(order[i], rooms[order[i]]);
+		}
+	}
+	if (queued >= 0)
+	{
+		sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+		printf("%d commands queued\n", queued);
+	}
+	sqlite3_close(db);
+	return 0;
+}
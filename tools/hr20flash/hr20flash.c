@@ -0,0 +1,523 @@
+/*
+ *  Open HR20 - page delta flashing
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       hr20flash.c
+ * \brief      flash changed pages only through the serial bootloader
+ *
+ * Uses page delta command of playground/Bootloader_JSachs: bootloader
+ * sends CRC16 of each application page, pages of the new image with
+ * other CRC are sent and written, the others are left untouched.
+ * Frames start with DELTA_SOF and the page number twice (plain and
+ * inverted), the CRC covers page number and data. The bootloader skips
+ * bytes until a valid frame start, so after a lost byte the host fills
+ * the pending frame up and sends it again.
+ * Image is ELF, Intel hex or raw binary.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define FLASH_MAX 0x10000
+#define PASSWORD 0x64           //!< KEY[] of bootcfg.h
+#define DELTA_CMD 'P'
+#define DELTA_SOF 0x01          //!< frame start, XMODEM_SOH
+#define DELTA_END 0xff
+#define ACK 0x06
+#define NAK 0x15
+#define RETRIES 3
+
+static uint8_t image[FLASH_MAX];
+static uint32_t image_end;      //!< first byte after image
+static int verbose;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20flash [-p <port>] [-s <baud>] [-r] [-n] [-v] <image>\n"
+		"\t-p <port>\tserial port (default /dev/ttyUSB0)\n"
+		"\t-s <baud>\tbaud rate of bootloader (default 9600)\n"
+		"\t-r\t\treset application by command B1324 first\n"
+		"\t-n\t\tonly list changed pages\n"
+		"\t-v\t\tverbose\n"
+		"\t<image>\t\tELF, Intel hex or binary\n");
+	exit(1);
+}
+
+/*!
+ *******************************************************************************
+ *  CRC1021 with nibble table, same as crc16_update of bootldr.c
+ ******************************************************************************/
+static uint16_t crc16_update(uint16_t crc, uint8_t dat)
+{
+	static const uint16_t crctab[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+		0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+	};
+
+	crc = (crc << 4) ^ crctab[(crc >> 12) ^ (dat >> 4)];
+	crc = (crc << 4) ^ crctab[(crc >> 12) ^ (dat & 0x0f)];
+	return crc;
+}
+
+static void image_put(uint32_t addr, const uint8_t *d, uint32_t len)
+{
+	if (addr + len > FLASH_MAX)
+	{
+		fprintf(stderr, "hr20flash: data at 0x%x outside flash\n", addr);
+		exit(1);
+	}
+	memcpy(image + addr, d, len);
+	if (addr + len > image_end)
+	{
+		image_end = addr + len;
+	}
+}
+
+static uint32_t le(const uint8_t *p, int n)
+{
+	uint32_t v = 0;
+
+	while (n-- > 0)
+	{
+		v = (v << 8) | p[n];
+	}
+	return v;
+}
+
+/*!
+ *******************************************************************************
+ *  ELF32: loadable segments at their load address, data in RAM (0x800000)
+ *  and EEPROM (0x810000) are skipped
+ ******************************************************************************/
+static void load_elf(const uint8_t *f, long size)
+{
+	uint32_t phoff = le(f + 28, 4);
+	int phentsize = le(f + 42, 2);
+	int phnum = le(f + 44, 2);
+	int i;
+
+	if ((f[4] != 1) || (f[5] != 1))
+	{
+		fprintf(stderr, "hr20flash: only 32 bit little endian ELF\n");
+		exit(1);
+	}
+	for (i = 0; i < phnum; i++)
+	{
+		const uint8_t *ph = f + phoff + i * phentsize;
+		uint32_t offset, paddr, filesz;
+		if (phoff + (i + 1) * phentsize > (uint32_t)size)
+		{
+			break;
+		}
+		offset = le(ph + 4, 4);
+		paddr = le(ph + 12, 4);
+		filesz = le(ph + 16, 4);
+		if ((le(ph, 4) != 1) || (filesz == 0) || (paddr >= 0x800000))
+		{
+			continue; // not PT_LOAD to flash
+		}
+		if (offset + filesz > (uint32_t)size)
+		{
+			fprintf(stderr, "hr20flash: truncated ELF\n");
+			exit(1);
+		}
+		image_put(paddr, f + offset, filesz);
+	}
+}
+
+static int hex2(const char *s)
+{
+	unsigned v;
+
+	if (sscanf(s, "%2x", &v) != 1)
+	{
+		return -1;
+	}
+	return v;
+}
+
+/*!
+ *******************************************************************************
+ *  Intel hex: data, end of file, extended segment and linear address records
+ ******************************************************************************/
+static void load_hex(FILE *f)
+{
+	char line[600];
+	uint32_t base = 0;
+	int n = 0;
+
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		uint8_t d[256];
+		int len, type, sum, i;
+		uint32_t addr;
+		n++;
+		if (line[0] != ':')
+		{
+			continue;
+		}
+		len = hex2(line + 1);
+		addr = (hex2(line + 3) << 8) | hex2(line + 5);
+		type = hex2(line + 7);
+		sum = len + (addr >> 8) + (addr & 0xff) + type;
+		for (i = 0; i <= len; i++)
+		{
+			int b = hex2(line + 9 + 2 * i);
+			if ((len < 0) || (b < 0))
+			{
+				fprintf(stderr, "hr20flash: bad hex record in line %d\n", n);
+				exit(1);
+			}
+			if (i < len)
+			{
+				d[i] = b;
+			}
+			sum += b;
+		}
+		if (sum & 0xff)
+		{
+			fprintf(stderr, "hr20flash: checksum error in line %d\n", n);
+			exit(1);
+		}
+		switch (type)
+		{
+		case 0:
+			image_put(base + addr, d, len);
+			break;
+		case 1:
+			return;
+		case 2:
+			base = ((d[0] << 8) | d[1]) << 4;
+			break;
+		case 4:
+			base = ((d[0] << 8) | d[1]) << 16;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void load_image(const char *name)
+{
+	FILE *f = fopen(name, "rb");
+	uint8_t *d;
+	long size;
+
+	if (f == NULL)
+	{
+		perror(name);
+		exit(1);
+	}
+	memset(image, 0xff, sizeof(image));
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	d = malloc(size + 1);
+	if ((d == NULL) || (fread(d, 1, size, f) != (size_t)size))
+	{
+		perror(name);
+		exit(1);
+	}
+	if ((size > 52) && !memcmp(d, "\177ELF", 4))
+	{
+		load_elf(d, size);
+	}
+	else if ((size > 0) && (d[0] == ':'))
+	{
+		rewind(f);
+		load_hex(f);
+	}
+	else
+	{
+		image_put(0, d, size);
+	}
+	free(d);
+	fclose(f);
+	if (image_end == 0)
+	{
+		fprintf(stderr, "%s: empty image\n", name);
+		exit(1);
+	}
+}
+
+static speed_t baud(long b)
+{
+	switch (b)
+	{
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	default:
+		fprintf(stderr, "hr20flash: unsupported baud rate %ld\n", b);
+		exit(1);
+	}
+}
+
+static int serial_open(const char *port, long b)
+{
+	struct termios t;
+	int fd = open(port, O_RDWR | O_NOCTTY);
+
+	if (fd < 0)
+	{
+		perror(port);
+		exit(1);
+	}
+	if (tcgetattr(fd, &t) == 0)
+	{
+		cfmakeraw(&t);
+		cfsetispeed(&t, baud(b));
+		cfsetospeed(&t, baud(b));
+		t.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &t);
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+static void serial_write(int fd, const void *d, size_t len)
+{
+	if (write(fd, d, len) != (ssize_t)len)
+	{
+		perror("hr20flash: write");
+		exit(1);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  read exactly len bytes
+ *
+ *  \returns false on timeout
+ ******************************************************************************/
+static int serial_read(int fd, uint8_t *d, size_t len, int ms)
+{
+	struct pollfd p = { fd, POLLIN, 0 };
+
+	while (len > 0)
+	{
+		ssize_t r;
+		if (poll(&p, 1, ms) <= 0)
+		{
+			return 0;
+		}
+		r = read(fd, d, len);
+		if (r <= 0)
+		{
+			return 0;
+		}
+		d += r;
+		len -= r;
+	}
+	return 1;
+}
+
+/*!
+ *******************************************************************************
+ *  password until bootloader waits for data ('C')
+ ******************************************************************************/
+static void connect_boot(int fd)
+{
+	uint8_t c;
+	int i;
+
+	for (i = 0; i < 100; i++)
+	{
+		c = PASSWORD;
+		serial_write(fd, &c, 1);
+		while (serial_read(fd, &c, 1, 100))
+		{
+			if (c == 'C')
+			{
+				tcflush(fd, TCIFLUSH);
+				return;
+			}
+		}
+	}
+	fprintf(stderr, "hr20flash: no bootloader, reset device or use -r\n");
+	exit(1);
+}
+
+/*!
+ *******************************************************************************
+ *  send frame until bootloader acks it
+ *
+ *  \note without answer a byte was lost, zeros complete the frame which the
+ *  \note bootloader waits for (it answers nak) or are skipped by frame start
+ *  \returns false when not acked
+ ******************************************************************************/
+static int send_frame(int fd, const uint8_t *frame, size_t len)
+{
+	static const uint8_t fill[3 + 256 + 2];
+	uint8_t c;
+	int retry;
+
+	for (retry = 0; retry < RETRIES; retry++)
+	{
+		serial_write(fd, frame, len);
+		if (serial_read(fd, &c, 1, 2000))
+		{
+			if (c == ACK)
+			{
+				return 1;
+			}
+			continue; // nak, bootloader waits for next frame start
+		}
+		if (verbose)
+		{
+			printf("no answer, resync\n");
+		}
+		serial_write(fd, fill, len);
+		while (serial_read(fd, &c, 1, 500))
+		{
+			; // nak of filled frame
+		}
+		tcflush(fd, TCIFLUSH);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *port = "/dev/ttyUSB0";
+	long speed = 9600;
+	int reset = 0, dry = 0;
+	uint8_t hdr[2], crcs[2 * 256], c;
+	uint8_t end[5] = { DELTA_SOF, DELTA_END, (uint8_t)~DELTA_END };
+	unsigned pages, psize, page, changed = 0, used;
+	int fd, opt;
+
+	while ((opt = getopt(argc, argv, "p:s:rnvh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			port = optarg;
+			break;
+		case 's':
+			speed = atol(optarg);
+			break;
+		case 'r':
+			reset = 1;
+			break;
+		case 'n':
+			dry = 1;
+			break;
+		case 'v':
+			verbose++;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		usage();
+	}
+	load_image(argv[optind]);
+	fd = serial_open(port, speed);
+	if (reset)
+	{
+		serial_write(fd, "\nB1324\n", 7);
+		usleep(100000);
+		tcflush(fd, TCIFLUSH);
+	}
+	connect_boot(fd);
+
+	c = DELTA_CMD;
+	serial_write(fd, &c, 1);
+	if (!serial_read(fd, hdr, 2, 1000) || (hdr[0] == 0) || (hdr[1] == 0)
+	    || !serial_read(fd, crcs, 2 * hdr[0], 5000))
+	{
+		fprintf(stderr, "hr20flash: no page CRCs, bootloader without DELTAMODE?\n");
+		return 1;
+	}
+	pages = hdr[0];
+	psize = hdr[1] * 2;
+	used = (image_end + psize - 1) / psize;
+	if (used > pages)
+	{
+		fprintf(stderr, "hr20flash: image 0x%x bytes exceeds application section 0x%x\n",
+			image_end, pages * psize);
+		return 1;
+	}
+
+	for (page = 0; page < used; page++)
+	{
+		uint8_t frame[3 + 256 + 2];
+		uint16_t crc = 0;
+		unsigned i;
+		for (i = 0; i < psize; i++)
+		{
+			crc = crc16_update(crc, image[page * psize + i]);
+		}
+		if (crc == ((crcs[2 * page] << 8) | crcs[2 * page + 1]))
+		{
+			continue;
+		}
+		changed++;
+		if (verbose || dry)
+		{
+			printf("page %3u at 0x%04x changed\n", page, page * psize);
+		}
+		if (dry)
+		{
+			continue;
+		}
+		frame[0] = DELTA_SOF;
+		frame[1] = page;
+		frame[2] = ~page;
+		memcpy(frame + 3, image + page * psize, psize);
+		crc = crc16_update(0, page);
+		for (i = 0; i < psize; i++)
+		{
+			crc = crc16_update(crc, frame[3 + i]);
+		}
+		frame[3 + psize] = crc >> 8;
+		frame[4 + psize] = crc & 0xff;
+		if (!send_frame(fd, frame, psize + 5))
+		{
+			fprintf(stderr, "hr20flash: page %u not written\n", page);
+			return 1;
+		}
+	}
+	end[3] = crc16_update(0, DELTA_END) >> 8;
+	end[4] = crc16_update(0, DELTA_END) & 0xff;
+	if (!send_frame(fd, end, sizeof(end)))
+	{
+		fprintf(stderr, "hr20flash: bootloader did not ack end, application not started\n");
+		return 1;
+	}
+	printf("%u of %u pages %s, application started\n", changed, used, dry ? "differ" : "written");
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,344 @@
+/*
+ *  Open HR20 - protocol parser for host tools
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       bench.c
+ * \brief      hr20bench: parser throughput and mutation check on corpora
+ *
+ * Corpus files are captures of hr20cap (both directions are used) or raw
+ * logs of the serial link. Throughput is measured by feeding the corpus in
+ * serial sized chunks. With -f random pieces of the corpus are mutated and
+ * fed once whole and once in random chunks, both must give the same
+ * messages and every text field must lie inside its line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hr20proto.h"
+
+#define CAPTURE_HEADER "# openhr20 capture 1"
+#define FUZZ_PIECE 4096
+#define FUZZ_MSGS (FUZZ_PIECE + 1)
+#define BAD_SHOWN 10
+
+typedef struct
+{
+	unsigned long kinds[HR20_M_COMMAND + 1];
+	unsigned long shown;
+	int verbose;
+} count_t;
+
+typedef struct
+{
+	uint32_t h[FUZZ_MSGS];
+	int n;
+	unsigned long broken;
+} trace_t;
+
+static char *corpus;
+static size_t corpus_len, corpus_size;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20bench [-n <rounds>] [-c <chunk>] [-f <iterations>] [-s <seed>] [-v] <corpus>...\n"
+		"\t-n <rounds>\tparse corpus rounds times (default 20)\n"
+		"\t-c <chunk>\tbytes per feed, like reads of serial port (default 512)\n"
+		"\t-f <iterations>\tmutation check instead of throughput\n"
+		"\t-s <seed>\trandom seed of mutation check (default 1)\n"
+		"\t-v\t\tprint lines not recognized as protocol\n");
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void append(const char *s, size_t len)
+{
+	if (corpus_len + len > corpus_size)
+	{
+		corpus_size = (corpus_size ? 2 * corpus_size : 1 << 20) + len;
+		corpus = realloc(corpus, corpus_size);
+		if (corpus == NULL)
+		{
+			perror("hr20bench");
+			exit(1);
+		}
+	}
+	memcpy(corpus + corpus_len, s, len);
+	corpus_len += len;
+}
+
+/*!
+ *******************************************************************************
+ *  add file to corpus, captures without time and direction
+ ******************************************************************************/
+static void load(const char *name)
+{
+	char line[HR20_LINE_MAX + 64];
+	FILE *f = fopen(name, "r");
+	int capture;
+
+	if (f == NULL)
+	{
+		perror(name);
+		exit(1);
+	}
+	capture = (fgets(line, sizeof(line), f) != NULL) && !strncmp(line, CAPTURE_HEADER, strlen(CAPTURE_HEADER));
+	if (!capture)
+	{
+		rewind(f);
+	}
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		double t;
+		char dir;
+		int pos = 0;
+		if (capture && ((line[0] == '#') || (sscanf(line, "%lf %c %n", &t, &dir, &pos) < 2)))
+		{
+			continue;
+		}
+		append(line + pos, strlen(line + pos));
+	}
+	fclose(f);
+}
+
+static void count(const hr20_msg_t *m, void *ctx)
+{
+	count_t *c = ctx;
+
+	c->kinds[m->kind]++;
+	if (c->verbose && ((m->kind == HR20_M_BAD) || (m->kind == HR20_M_TEXT)) && (c->shown < BAD_SHOWN))
+	{
+		c->shown++;
+		printf("%s: %.*s\n", hr20_kind_name(m->kind), (int)m->line.len, m->line.p);
+	}
+}
+
+static uint32_t fnv(uint32_t h, const void *d, size_t len)
+{
+	const uint8_t *p = d;
+
+	while (len--)
+	{
+		h = (h ^ *p++) * 16777619u;
+	}
+	return h;
+}
+
+/*!
+ *******************************************************************************
+ *  hash of decoded fields, pointers are checked against line and not hashed
+ ******************************************************************************/
+static void trace(const hr20_msg_t *m, void *ctx)
+{
+	trace_t *t = ctx;
+	uint32_t h = 2166136261u;
+
+	if ((m->line.len > HR20_LINE_MAX)
+	    || ((m->text.len > 0)
+		&& ((m->text.p < m->line.p) || (m->text.p + m->text.len > m->line.p + m->line.len))))
+	{
+		t->broken++;
+	}
+	h = fnv(h, &m->kind, sizeof(m->kind));
+	h = fnv(h, &m->addr, offsetof(hr20_msg_t, arg) - offsetof(hr20_msg_t, addr));
+	h = fnv(h, m->arg, m->nargs);
+	h = fnv(h, m->text.p, m->text.len);
+	h = fnv(h, m->line.p, m->line.len);
+	if (t->n < FUZZ_MSGS)
+	{
+		t->h[t->n++] = h;
+	}
+}
+
+static void mutate(char *p, size_t *len)
+{
+	static const char alphabet[] = "0123456789abcdefABCDEF()[]{}#*-@:=?!. \n\rDAMSGRWTLVCPKOYHNBEIXUF";
+	int edits = 1 + rand() % 8;
+
+	while (edits--)
+	{
+		size_t at = *len ? (size_t)rand() % *len : 0;
+		switch (rand() % 5)
+		{
+		case 0:
+			if (*len)
+			{
+				p[at] ^= 1 << (rand() % 8);
+			}
+			break;
+		case 1:
+			if (*len)
+			{
+				p[at] = alphabet[rand() % (sizeof(alphabet) - 1)];
+			}
+			break;
+		case 2:
+			if (*len < 2 * FUZZ_PIECE)
+			{
+				memmove(p + at + 1, p + at, *len - at);
+				p[at] = alphabet[rand() % (sizeof(alphabet) - 1)];
+				(*len)++;
+			}
+			break;
+		case 3:
+			if (*len)
+			{
+				memmove(p + at, p + at + 1, *len - at - 1);
+				(*len)--;
+			}
+			break;
+		default:
+			*len = at; // truncated
+			break;
+		}
+	}
+}
+
+static int fuzz(long iterations)
+{
+	static char piece[2 * FUZZ_PIECE + 8];
+	static trace_t whole, split;
+	unsigned long differ = 0, broken = 0;
+	long i;
+
+	for (i = 0; i < iterations; i++)
+	{
+		hr20_stream_t s;
+		size_t len = (corpus_len < FUZZ_PIECE) ? corpus_len : 1 + rand() % FUZZ_PIECE;
+		size_t at = (corpus_len > len) ? (size_t)rand() % (corpus_len - len) : 0;
+		size_t pos;
+		memcpy(piece, corpus + at, len);
+		mutate(piece, &len);
+		piece[len++] = '\n'; // last line complete
+
+		whole.n = split.n = 0;
+		hr20_stream_init(&s);
+		hr20_stream_feed(&s, piece, len, trace, &whole);
+		hr20_stream_init(&s);
+		for (pos = 0; pos < len;)
+		{
+			size_t n = 1 + rand() % 64;
+			if (n > len - pos)
+			{
+				n = len - pos;
+			}
+			hr20_stream_feed(&s, piece + pos, n, trace, &split);
+			pos += n;
+		}
+		if ((whole.n != split.n) || memcmp(whole.h, split.h, whole.n * sizeof(uint32_t)))
+		{
+			differ++;
+		}
+	}
+	broken = whole.broken + split.broken;
+	printf("%ld mutated pieces: %lu differ by chunking, %lu messages outside of line\n", iterations,
+	       differ, broken);
+	return (differ || broken) ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	long rounds = 20, iterations = 0, r;
+	size_t chunk = 512;
+	count_t c = { .verbose = 0 };
+	hr20_stream_t s;
+	double t;
+	unsigned long lines = 0;
+	unsigned seed = 1;
+	int opt, k;
+
+	while ((opt = getopt(argc, argv, "n:c:f:s:vh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			rounds = atol(optarg);
+			break;
+		case 'c':
+			chunk = atol(optarg);
+			break;
+		case 'f':
+			iterations = atol(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			c.verbose = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if ((optind == argc) || (rounds <= 0) || (chunk == 0))
+	{
+		usage();
+	}
+	for (; optind < argc; optind++)
+	{
+		load(argv[optind]);
+	}
+	if (corpus_len == 0)
+	{
+		fprintf(stderr, "hr20bench: empty corpus\n");
+		return 1;
+	}
+	srand(seed);
+	if (iterations > 0)
+	{
+		return fuzz(iterations);
+	}
+
+	t = now();
+	for (r = 0; r < rounds; r++)
+	{
+		size_t pos;
+		hr20_stream_init(&s);
+		for (pos = 0; pos < corpus_len; pos += chunk)
+		{
+			hr20_stream_feed(&s, corpus + pos, (corpus_len - pos < chunk) ? corpus_len - pos : chunk, count, &c);
+		}
+		lines += s.lines;
+		c.verbose = 0; // unknown lines of first round only
+	}
+	t = now() - t;
+	printf("%lu lines, %.1f MB in %.3f s: %.1f MB/s, %.0f lines/s, %.0f ns/line\n", lines,
+	       rounds * corpus_len / 1e6, t, rounds * corpus_len / 1e6 / t, lines / t, 1e9 * t / lines);
+	for (k = 0; k <= HR20_M_COMMAND; k++)
+	{
+		if (c.kinds[k])
+		{
+			printf("\t%-10s %lu\n", hr20_kind_name(k), c.kinds[k] / rounds);
+		}
+	}
+	return 0;
+}
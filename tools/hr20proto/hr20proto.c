@@ -0,0 +1,797 @@
+/*
+ *  Open HR20 - protocol parser for host tools
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       hr20proto.c
+ * \brief      lines of master, slave and daemon on the serial link
+ *
+ * Forms follow the printing code of the firmware: COM_dump_packet,
+ * print_status_rec and COM_status_dump of rfm-master/com.c,
+ * COM_print_debug of src/com.c and the commands of COM_commad_parse.
+ * Hex is accepted in both cases, firmware prints lower case.
+ */
+
+#include <string.h>
+
+#include "hr20proto.h"
+
+typedef struct
+{
+	const char *p, *end;
+} cur_t;
+
+static int nibble(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/*!
+ *******************************************************************************
+ *  exactly digits hex digits
+ *
+ *  \returns false when not found, cursor is not moved then
+ ******************************************************************************/
+static int get_hex(cur_t *c, int digits, unsigned *v)
+{
+	unsigned r = 0;
+	int i;
+
+	if (c->end - c->p < digits)
+	{
+		return 0;
+	}
+	for (i = 0; i < digits; i++)
+	{
+		int n = nibble(c->p[i]);
+		if (n < 0)
+		{
+			return 0;
+		}
+		r = (r << 4) | n;
+	}
+	c->p += digits;
+	*v = r;
+	return 1;
+}
+
+/*!
+ *******************************************************************************
+ *  1 .. 5 decimal digits
+ ******************************************************************************/
+static int get_dec(cur_t *c, unsigned *v)
+{
+	unsigned r = 0;
+	int i;
+
+	for (i = 0; (i < 5) && (c->p < c->end) && (*c->p >= '0') && (*c->p <= '9'); i++)
+	{
+		r = r * 10 + (*c->p++ - '0');
+	}
+	*v = r;
+	return (i > 0) && ((c->p == c->end) || (*c->p < '0') || (*c->p > '9'));
+}
+
+static int lit(cur_t *c, const char *s)
+{
+	size_t n = strlen(s);
+
+	if (((size_t)(c->end - c->p) < n) || memcmp(c->p, s, n))
+	{
+		return 0;
+	}
+	c->p += n;
+	return 1;
+}
+
+static int at_end(cur_t *c)
+{
+	return c->p == c->end;
+}
+
+static void skip_spaces(cur_t *c)
+{
+	while ((c->p < c->end) && (*c->p == ' '))
+	{
+		c->p++;
+	}
+}
+
+static void skip_token(cur_t *c)
+{
+	while ((c->p < c->end) && (*c->p != ' '))
+	{
+		c->p++;
+	}
+}
+
+static void rest(cur_t *c, hr20_str_t *s)
+{
+	s->p = c->p;
+	s->len = c->end - c->p;
+}
+
+/*!
+ *******************************************************************************
+ *  fields of status, " m05 s30 A V30 I2150 S2100 B2730 E00 W L" of master or
+ *  "M V: 54 I: 1975 S: 2000 B: 3171 E:01 X W L" of slave (colon set)
+ ******************************************************************************/
+static int status_fields(cur_t *c, hr20_status_t *st, int colon)
+{
+	unsigned v;
+
+	while (1)
+	{
+		char k;
+		skip_spaces(c);
+		if (at_end(c))
+		{
+			break;
+		}
+		k = *c->p++;
+		if (((k == 'A') || (k == '-') || (k == 'M')) && (at_end(c) || (*c->p == ' ')))
+		{
+			st->mode = k;
+			continue;
+		}
+		if (!at_end(c) && (((*c->p >= 'a') && (*c->p <= 'z')) || ((*c->p >= 'A') && (*c->p <= 'Z'))))
+		{
+			// "Is: 00b9...", "Ib: 00" of DEBUG_PRINT_I_SUM
+			skip_token(c);
+			if (c->p[-1] == ':')
+			{
+				skip_spaces(c);
+				skip_token(c);
+			}
+			continue;
+		}
+		if (colon && lit(c, ":"))
+		{
+			skip_spaces(c);
+		}
+		switch (k)
+		{
+		case 'm':
+			if (!get_dec(c, &v))
+			{
+				return 0;
+			}
+			st->minute = v;
+			break;
+		case 's':
+			if (!get_dec(c, &v))
+			{
+				return 0;
+			}
+			st->second = v;
+			break;
+		case 'V':
+			if (!get_dec(c, &v))
+			{
+				return 0;
+			}
+			st->valve = v;
+			break;
+		case 'I':
+			if (!get_dec(c, &v))
+			{
+				return 0;
+			}
+			st->real = v;
+			break;
+		case 'S':
+			if (lit(c, "BOOT"))
+			{
+				st->boot = 1;
+				st->wanted = 0;
+			}
+			else if (get_dec(c, &v))
+			{
+				st->wanted = v;
+			}
+			else
+			{
+				return 0;
+			}
+			break;
+		case 'B':
+			if (!get_dec(c, &v))
+			{
+				return 0;
+			}
+			st->battery = v;
+			break;
+		case 'E':
+			if (!get_hex(c, 2, &v))
+			{
+				return 0;
+			}
+			st->error = v;
+			break;
+		case 'W':
+			st->window = 1;
+			break;
+		case 'L':
+			st->locked = 1;
+			break;
+		case 'X':
+			break;
+		default:
+			return 0;
+		}
+		if (!at_end(c) && (*c->p != ' '))
+		{
+			return 0;
+		}
+	}
+	return st->mode != 0;
+}
+
+/*!
+ *******************************************************************************
+ *  "d6 10.01.09 22:19:14" of COM_print_datetime, also head of status line
+ ******************************************************************************/
+static int datetime(cur_t *c, hr20_status_t *st)
+{
+	unsigned v[7];
+
+	if (!get_hex(c, 2, &v[0]) || !lit(c, " ") || !get_dec(c, &v[1]) || !lit(c, ".") || !get_dec(c, &v[2])
+	    || !lit(c, ".") || !get_dec(c, &v[3]) || !lit(c, " ") || !get_dec(c, &v[4]) || !lit(c, ":")
+	    || !get_dec(c, &v[5]) || !lit(c, ":") || !get_dec(c, &v[6]) || (v[0] < 0xd1) || (v[0] > 0xd7))
+	{
+		return 0;
+	}
+	st->dow = v[0] - 0xd0;
+	st->day = v[1];
+	st->month = v[2];
+	st->year = v[3];
+	st->hour = v[4];
+	st->minute = v[5];
+	st->second = v[6];
+	return 1;
+}
+
+/*!
+ *******************************************************************************
+ *  "D: d6 10.01.09 22:19:14 M V: 54 I: 1975 S: 2000 B: 3171 X" of COM_print_debug
+ ******************************************************************************/
+static hr20_kind_t status_line(cur_t *c, hr20_msg_t *m)
+{
+	if (!lit(c, "D: ") || !datetime(c, &m->st) || !status_fields(c, &m->st, 1))
+	{
+		return HR20_M_BAD;
+	}
+	m->cmd = 'D';
+	m->has_status = 1;
+	return HR20_M_STATUS;
+}
+
+/*!
+ *******************************************************************************
+ *  content of record after mark and tag, see COM_dump_packet
+ ******************************************************************************/
+static hr20_kind_t record(cur_t *c, hr20_msg_t *m)
+{
+	unsigned idx, v;
+	char k;
+
+	if (at_end(c))
+	{
+		return HR20_M_BAD;
+	}
+	k = *c->p++;
+	if (k == ' ')
+	{
+		rest(c, &m->text); // record of unknown type, bytes in hex
+		return HR20_M_RECORD;
+	}
+	m->cmd = k;
+	if (lit(c, "!"))
+	{
+		if (!get_hex(c, 2, &v) || !lit(c, "!"))
+		{
+			return HR20_M_BAD;
+		}
+		m->incomplete = 1;
+		m->value = v;
+		return HR20_M_RECORD;
+	}
+	switch (k)
+	{
+	case 'D':
+	case 'A':
+	case 'M':
+		if (!status_fields(c, &m->st, 0))
+		{
+			return HR20_M_BAD;
+		}
+		m->has_status = 1;
+		return HR20_M_RECORD;
+	case 'T':
+	case 'R':
+	case 'W':
+	case 'U':
+	case 'G':
+	case 'S':
+		if (!lit(c, "[") || !get_hex(c, 2, &idx) || !lit(c, "]=")
+		    || !get_hex(c, ((k == 'G') || (k == 'S')) ? 2 : 4, &v) || !at_end(c))
+		{
+			return HR20_M_BAD;
+		}
+		m->idx = idx;
+		m->value = v;
+		return HR20_M_RECORD;
+	case 'L':
+		if (!get_hex(c, 2, &v) || !at_end(c))
+		{
+			return HR20_M_BAD;
+		}
+		m->value = v;
+		return HR20_M_RECORD;
+	case 'V':
+		rest(c, &m->text);
+		return HR20_M_RECORD;
+	default:
+		return HR20_M_BAD;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  hex arguments of a command up to end of line
+ ******************************************************************************/
+static hr20_kind_t command_args(cur_t *c, hr20_msg_t *m)
+{
+	unsigned v;
+
+	rest(c, &m->text);
+	if (m->text.len & 1)
+	{
+		return HR20_M_BAD;
+	}
+	while (!at_end(c))
+	{
+		if (!get_hex(c, 2, &v))
+		{
+			return HR20_M_BAD;
+		}
+		if (m->nargs < HR20_ARG_MAX)
+		{
+			m->arg[m->nargs++] = v;
+		}
+	}
+	return HR20_M_COMMAND;
+}
+
+/*!
+ *******************************************************************************
+ *  "Xhex" command, other text starting with upper case char
+ ******************************************************************************/
+static hr20_kind_t command(cur_t *c, hr20_msg_t *m)
+{
+	hr20_kind_t k;
+
+	m->cmd = *c->p++;
+	k = command_args(c, m);
+	if (k != HR20_M_COMMAND)
+	{
+		m->cmd = 0; // version string or other text
+		m->nargs = 0;
+		k = HR20_M_TEXT;
+	}
+	return k;
+}
+
+/*!
+ *******************************************************************************
+ *  "N: 0a:12 03:08" shared seconds of master
+ ******************************************************************************/
+static hr20_kind_t shares(cur_t *c, hr20_msg_t *m)
+{
+	unsigned a, s;
+
+	while (!at_end(c))
+	{
+		if (!lit(c, " ") || !get_hex(c, 2, &a) || !lit(c, ":") || !get_hex(c, 2, &s))
+		{
+			return HR20_M_BAD;
+		}
+		if (m->nargs + 2 <= HR20_ARG_MAX)
+		{
+			m->arg[m->nargs++] = a;
+			m->arg[m->nargs++] = s;
+		}
+	}
+	return HR20_M_SHARES;
+}
+
+/*!
+ *******************************************************************************
+ *  lines starting with "(aa"
+ ******************************************************************************/
+static hr20_kind_t addressed(cur_t *c, hr20_msg_t *m)
+{
+	unsigned v;
+
+	if (!get_hex(c, 2, &v))
+	{
+		return HR20_M_BAD;
+	}
+	m->addr = v;
+	if (lit(c, ")?"))
+	{
+		return at_end(c) ? HR20_M_SLOT_REQ : HR20_M_BAD;
+	}
+	if (lit(c, "){"))
+	{
+		return at_end(c) ? HR20_M_BLOCK : HR20_M_BAD;
+	}
+	if (lit(c, ")C t"))
+	{
+		unsigned f[7];
+		if (!get_hex(c, 4, &v) || !lit(c, " p") || !get_hex(c, 2, &f[0]) || !lit(c, " e")
+		    || !get_hex(c, 2, &f[1]) || !lit(c, " x") || !get_hex(c, 2, &f[2]) || !lit(c, " f")
+		    || !get_hex(c, 2, &f[3]) || !lit(c, ":") || !get_hex(c, 2, &f[4]) || !lit(c, ":")
+		    || !get_hex(c, 2, &f[5]) || !lit(c, " @") || !get_hex(c, 2, &f[6]))
+		{
+			return HR20_M_BAD;
+		}
+		m->value = v;
+		m->pkt_ok = f[0];
+		m->pkt_err = f[1];
+		m->missed = f[2];
+		m->afc = (int8_t)f[3];
+		m->afc_min = (int8_t)f[4];
+		m->afc_max = (int8_t)f[5];
+		m->phase = f[6];
+		if (lit(c, " -"))
+		{
+			if (at_end(c))
+			{
+				return HR20_M_BAD;
+			}
+			m->cmd = *c->p++;
+			if (!status_fields(c, &m->st, 0))
+			{
+				return HR20_M_BAD;
+			}
+			m->has_status = 1;
+		}
+		return at_end(c) ? HR20_M_CACHE : HR20_M_BAD;
+	}
+	if (lit(c, ")"))
+	{
+		return record(c, m); // one line record "(aa)D m05 s30 ..." of old masters
+	}
+	if (lit(c, "#"))
+	{
+		if (!get_hex(c, 2, &v))
+		{
+			return HR20_M_BAD;
+		}
+		m->tag = v;
+	}
+	else if (lit(c, "-"))
+	{
+		if (!get_hex(c, 1, &v))
+		{
+			return HR20_M_BAD;
+		}
+		m->bank = v;
+	}
+	else
+	{
+		return HR20_M_BAD;
+	}
+	if (!lit(c, ")") || at_end(c))
+	{
+		return HR20_M_BAD;
+	}
+	m->cmd = *c->p++;
+	return command_args(c, m);
+}
+
+/*!
+ *******************************************************************************
+ *  "@ss.hh PKTnnnn AFCxx" / "@ss.hh ERRnnnn xx xx"
+ ******************************************************************************/
+static hr20_kind_t packet(cur_t *c, hr20_msg_t *m)
+{
+	unsigned s, h, v;
+	int err;
+
+	if (!get_dec(c, &s) || !lit(c, ".") || !get_dec(c, &h) || !lit(c, " "))
+	{
+		return HR20_M_BAD;
+	}
+	m->second = s;
+	m->s100 = h;
+	if (lit(c, "PKT"))
+	{
+		err = 0;
+	}
+	else if (lit(c, "ERR"))
+	{
+		err = 1;
+	}
+	else
+	{
+		return HR20_M_BAD;
+	}
+	if (!get_hex(c, 4, &v))
+	{
+		return HR20_M_BAD;
+	}
+	m->value = v;
+	if (err)
+	{
+		skip_spaces(c);
+		rest(c, &m->text);
+		return HR20_M_PKT_ERR;
+	}
+	if (lit(c, " AFC"))
+	{
+		if (!get_hex(c, 2, &v))
+		{
+			return HR20_M_BAD;
+		}
+		m->afc = (int8_t)v;
+		m->has_afc = 1;
+	}
+	return at_end(c) ? HR20_M_PKT : HR20_M_BAD;
+}
+
+/*!
+ *******************************************************************************
+ *  parse one line
+ *
+ *  \param line without '\n', a trailing '\r' is ignored
+ *  \param m is cleared, text fields point into line
+ *  \returns m->kind
+ ******************************************************************************/
+hr20_kind_t hr20_parse(const char *line, size_t len, hr20_msg_t *m)
+{
+	cur_t c;
+	hr20_kind_t k = HR20_M_TEXT;
+	unsigned v;
+
+	if ((len > 0) && (line[len - 1] == '\r'))
+	{
+		len--;
+	}
+	memset(m, 0, offsetof(hr20_msg_t, arg)); // arg is valid up to nargs only
+	m->nargs = 0;
+	m->text.p = NULL;
+	m->text.len = 0;
+	m->line.p = line;
+	m->line.len = len;
+	c.p = line;
+	c.end = line + len;
+	if (len == 0)
+	{
+		return m->kind = HR20_M_EMPTY;
+	}
+	switch (line[0])
+	{
+	case '(':
+		c.p++;
+		k = addressed(&c, m);
+		break;
+	case '@':
+		c.p++;
+		k = packet(&c, m);
+		break;
+	case '*':
+	case '-':
+		m->mark = *c.p++;
+		if ((m->mark == '*') && lit(&c, "#"))
+		{
+			if (!get_hex(&c, 2, &v) || !lit(&c, " "))
+			{
+				k = HR20_M_BAD;
+				break;
+			}
+			m->tag = v;
+		}
+		k = record(&c, m);
+		break;
+	case '}':
+		k = (len == 1) ? HR20_M_BLOCK_END : HR20_M_TEXT;
+		break;
+	case 'N':
+		if ((len == 3) && ((line[1] == '0') || (line[1] == '1')) && (line[2] == '?'))
+		{
+			m->value = line[1] - '0';
+			k = HR20_M_SYNC_REQ;
+		}
+		else if (lit(&c, "N:"))
+		{
+			k = shares(&c, m);
+		}
+		else
+		{
+			k = command(&c, m); // backlog for shared seconds
+		}
+		break;
+	case 'd':
+		k = (datetime(&c, &m->st) && at_end(&c)) ? HR20_M_DATETIME : HR20_M_TEXT;
+		break;
+	case ':':
+		c.p++;
+		m->cmd = ':';
+		k = command_args(&c, m); // intel hex for eeprom
+		if (k != HR20_M_COMMAND)
+		{
+			m->cmd = 0; // version line of slave
+			m->nargs = 0;
+			k = HR20_M_TEXT;
+		}
+		break;
+	default:
+		if ((len == 4) && !memcmp(line, "RTC?", 4))
+		{
+			k = HR20_M_RTC_REQ;
+		}
+		else if ((len == 2) && !memcmp(line, "OK", 2))
+		{
+			k = HR20_M_OK;
+		}
+		else if ((len >= 2) && !memcmp(line, "D:", 2))
+		{
+			k = status_line(&c, m);
+		}
+		else if ((len >= 2) && !memcmp(line, "F:", 2))
+		{
+			c.p += 2;
+			skip_spaces(&c);
+			rest(&c, &m->text);
+			k = HR20_M_FLOW;
+		}
+		else if (lit(&c, "C end r"))
+		{
+			if (get_hex(&c, 2, &v) && at_end(&c))
+			{
+				m->value = v;
+				k = HR20_M_CACHE_END;
+			}
+			else
+			{
+				k = HR20_M_BAD;
+			}
+		}
+		else if ((len >= 2) && (line[1] == '[') && (line[0] >= 'A') && (line[0] <= 'Z'))
+		{
+			k = record(&c, m); // reply of slave on its own serial port
+		}
+		else if ((line[0] >= 'A') && (line[0] <= 'Z'))
+		{
+			k = command(&c, m);
+		}
+		break;
+	}
+	if ((k == HR20_M_TEXT) || (k == HR20_M_BAD))
+	{
+		m->text = m->line;
+	}
+	return m->kind = k;
+}
+
+void hr20_stream_init(hr20_stream_t *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+static void stream_line(hr20_stream_t *s, const char *line, size_t len, hr20_cb_t cb, void *ctx)
+{
+	hr20_msg_t m;
+
+	switch (hr20_parse(line, len, &m))
+	{
+	case HR20_M_BLOCK:
+		s->block = m.addr;
+		break;
+	case HR20_M_BLOCK_END:
+		m.addr = s->block;
+		s->block = 0;
+		break;
+	case HR20_M_RECORD:
+		if (m.mark != 0)
+		{
+			m.addr = s->block;
+		}
+		break;
+	case HR20_M_BAD:
+		s->bad++;
+		break;
+	case HR20_M_EMPTY:
+		return;
+	default:
+		break;
+	}
+	s->lines++;
+	cb(&m, ctx);
+}
+
+/*!
+ *******************************************************************************
+ *  split data into lines, cb is called for each non empty line
+ *
+ *  \note lines complete in data are parsed in place, unfinished line is kept
+ *  \note records inside "(aa){" .. "}" get addr of block
+ ******************************************************************************/
+void hr20_stream_feed(hr20_stream_t *s, const char *data, size_t len, hr20_cb_t cb, void *ctx)
+{
+	const char *end = data + len;
+
+	while (data < end)
+	{
+		const char *nl = memchr(data, '\n', end - data);
+		size_t n = ((nl != NULL) ? nl : end) - data;
+		if ((s->len == 0) && (nl != NULL))
+		{
+			stream_line(s, data, (n < sizeof(s->buf)) ? n : sizeof(s->buf), cb, ctx);
+		}
+		else
+		{
+			size_t room = sizeof(s->buf) - s->len;
+			if (n > room)
+			{
+				n = room;
+				s->truncated = 1;
+			}
+			memcpy(s->buf + s->len, data, n);
+			s->len += n;
+			if (nl != NULL)
+			{
+				stream_line(s, s->buf, s->len, cb, ctx);
+				s->len = 0;
+				s->truncated = 0;
+			}
+			else
+			{
+				break;
+			}
+		}
+		data = nl + 1;
+	}
+}
+
+const char *hr20_kind_name(hr20_kind_t kind)
+{
+	static const char *const names[] = {
+		"empty", "text", "bad", "rtc_req", "slot_req", "sync_req", "pkt", "pkt_err",
+		"block", "block_end", "record", "status", "cache", "cache_end", "ok", "flow", "datetime",
+		"shares", "command"
+	};
+
+	return ((unsigned)kind < sizeof(names) / sizeof(names[0])) ? names[kind] : "?";
+}
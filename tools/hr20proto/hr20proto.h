@@ -0,0 +1,122 @@
+/*
+ *  Open HR20 - protocol parser for host tools
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       hr20proto.h
+ * \brief      lines of master, slave and daemon on the serial link
+ *
+ * Every line is decoded into one hr20_msg_t without allocation, text
+ * fields point into the parsed line. hr20_stream_feed splits a byte
+ * stream into lines, complete lines are parsed in place and only the
+ * unfinished tail is copied.
+ */
+
+#ifndef HR20PROTO_H
+#define HR20PROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HR20_LINE_MAX 1024      //!< longer lines are truncated
+#define HR20_ARG_MAX 40         //!< decoded argument bytes of a command
+
+typedef enum
+{
+	HR20_M_EMPTY = 0,
+	HR20_M_TEXT,            //!< not recognized, whole line in text
+	HR20_M_BAD,             //!< known form with bad content, whole line in text
+	HR20_M_RTC_REQ,         //!< "RTC?"
+	HR20_M_SLOT_REQ,        //!< "(aa)?"
+	HR20_M_SYNC_REQ,        //!< "N0?" / "N1?", value 0 / 1
+	HR20_M_PKT,             //!< "@ss.hh PKTnnnn[ AFCxx]"
+	HR20_M_PKT_ERR,         //!< "@ss.hh ERRnnnn xx xx ...", bytes in text
+	HR20_M_BLOCK,           //!< "(aa){"
+	HR20_M_BLOCK_END,       //!< "}"
+	HR20_M_RECORD,          //!< "*#tt X..." / "-X..." in block, "(aa)X..." or bare "X[ii]=vv" reply
+	HR20_M_STATUS,          //!< "D: d6 10.01.09 22:19:14 M V: 54 ..." of slave
+	HR20_M_CACHE,           //!< "(aa)C tXXXX pXX eXX xXX fXX:XX:XX @XX[ -D ...]"
+	HR20_M_CACHE_END,       //!< "C end rRR", value rate
+	HR20_M_OK,              //!< "OK"
+	HR20_M_FLOW,            //!< "F: ...", rest in text
+	HR20_M_DATETIME,        //!< "d6 10.01.09 22:19:14" of master, in st
+	HR20_M_SHARES,          //!< "N: aa:ss ...", address, seconds pairs in arg
+	HR20_M_COMMAND          //!< daemon to master "(aa#tt)Xhex", "(aa-b)Xhex" or "Xhex"
+} hr20_kind_t;
+
+typedef struct
+{
+	const char *p;
+	size_t len;
+} hr20_str_t;
+
+/*! D/A/M record and status line */
+typedef struct
+{
+	char mode;              //!< 'A' auto, '-' auto without timer, 'M' manual
+	uint8_t minute, second;
+	uint8_t valve;          //!< %
+	uint16_t real, wanted;  //!< 1/100 C, wanted 0 when "S: BOOT"
+	uint16_t battery;       //!< mV
+	uint8_t error;
+	uint8_t window, locked, boot;
+	uint8_t dow, day, month, year, hour; //!< status line and date only, dow 1 = monday
+} hr20_status_t;
+
+typedef struct
+{
+	hr20_kind_t kind;
+	uint8_t addr;           //!< slave, record gets it from block of stream
+	char mark;              //!< record: '*' ack, '-' unsolicited, 0 bare or "(aa)" prefix
+	uint8_t tag;            //!< record / command: #tt, 0 none
+	uint8_t bank;           //!< command: b of (aa-b)
+	char cmd;               //!< record / command char, 0 record of unknown type
+	uint8_t incomplete;     //!< record: "!xx!" mark of truncated packet
+	uint8_t idx;            //!< record X[ii]
+	uint16_t value;         //!< record, cache age, sync, packet seq, cache end rate
+	uint8_t second, s100;   //!< packet time
+	int8_t afc;             //!< packet with has_afc, cache
+	uint8_t has_afc, has_status;
+	uint8_t pkt_ok, pkt_err, missed, phase; //!< cache
+	int8_t afc_min, afc_max; //!< cache
+	hr20_status_t st;       //!< has_status
+	uint8_t arg[HR20_ARG_MAX]; //!< command, shares
+	uint8_t nargs;
+	hr20_str_t text;        //!< version, raw bytes, command hex, flow, unrecognized line
+	hr20_str_t line;        //!< whole line without end of line
+} hr20_msg_t;
+
+typedef void (*hr20_cb_t)(const hr20_msg_t *m, void *ctx);
+
+typedef struct
+{
+	char buf[HR20_LINE_MAX]; //!< unfinished line
+	size_t len;
+	int truncated;
+	uint8_t block;          //!< address of open "(aa){", 0 none
+	unsigned long lines, bad;
+} hr20_stream_t;
+
+extern hr20_kind_t hr20_parse(const char *line, size_t len, hr20_msg_t *m);
+extern void hr20_stream_init(hr20_stream_t *s);
+extern void hr20_stream_feed(hr20_stream_t *s, const char *data, size_t len, hr20_cb_t cb, void *ctx);
+extern const char *hr20_kind_name(hr20_kind_t kind);
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ *  Open HR20 - serial capture and replay
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       capture.c
+ * \brief      hr20cap: record traffic between master and daemon
+ *
+ * Sits between serial port of the master and a pty for the daemon,
+ * bytes are forwarded unchanged, every line is written to the capture
+ * file with its time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "pty.h"
+
+static volatile sig_atomic_t stop;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20cap [-s <serial>] [-b <baud>] [-p <pty>] -o <file>\n"
+		"\t-s <serial>\tserial port of master (default /dev/ttyUSB0)\n"
+		"\t-b <baud>\tbaud rate (default 38400)\n"
+		"\t-p <pty>\tsymlink to pty for the daemon (default /tmp/openhr20-cap)\n"
+		"\t-o <file>\tcapture file, appended\n");
+	exit(1);
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+/*!
+ *******************************************************************************
+ *  forward available bytes from one fd to the other, log complete lines
+ *
+ *  \returns false on hangup of source
+ ******************************************************************************/
+static int forward(int from, int to, line_buf_t *l, char dir, FILE *out, double t0)
+{
+	char buf[512];
+	ssize_t n = read(from, buf, sizeof(buf));
+	ssize_t i, w;
+
+	if (n <= 0)
+	{
+		return (n < 0) && ((errno == EAGAIN) || (errno == EIO)); // EIO: no daemon on pty yet
+	}
+	for (i = 0; i < n; i += w)
+	{
+		w = write(to, buf + i, n - i);
+		if (w < 0)
+		{
+			if (errno != EAGAIN)
+			{
+				perror("hr20cap: write");
+				return 0;
+			}
+			w = 0;
+			poll(NULL, 0, 1);
+		}
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (line_feed(l, buf[i]))
+		{
+			fprintf(out, "%.6f %c %s\n", now() - t0, dir, l->buf);
+			fflush(out);
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *serial = "/dev/ttyUSB0";
+	const char *pty_name = "/tmp/openhr20-cap";
+	const char *out_name = NULL;
+	long baud = 38400;
+	line_buf_t from_master = { .len = 0 }, to_master = { .len = 0 };
+	struct pollfd p[2];
+	FILE *out;
+	double t0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:b:p:o:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			serial = optarg;
+			break;
+		case 'b':
+			baud = atol(optarg);
+			break;
+		case 'p':
+			pty_name = optarg;
+			break;
+		case 'o':
+			out_name = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if ((out_name == NULL) || (optind != argc))
+	{
+		usage();
+	}
+	out = fopen(out_name, "a");
+	if (out == NULL)
+	{
+		perror(out_name);
+		return 1;
+	}
+	p[0].fd = serial_open(serial, baud);
+	p[1].fd = pty_open(pty_name);
+	p[0].events = p[1].events = POLLIN;
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	t0 = now();
+	fprintf(out, "%s\n", CAPTURE_HEADER);
+	while (!stop)
+	{
+		if (poll(p, 2, 1000) < 0)
+		{
+			continue;
+		}
+		if ((p[0].revents & (POLLIN | POLLHUP | POLLERR))
+		    && !forward(p[0].fd, p[1].fd, &from_master, '<', out, t0))
+		{
+			fprintf(stderr, "hr20cap: %s closed\n", serial);
+			break;
+		}
+		if ((p[1].revents & POLLIN) && !forward(p[1].fd, p[0].fd, &to_master, '>', out, t0))
+		{
+			break;
+		}
+	}
+	fclose(out);
+	unlink(pty_name);
+	return 0;
+}
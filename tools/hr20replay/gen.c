@@ -0,0 +1,676 @@
+/*
+ *  Open HR20 - serial capture and replay
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       gen.c
+ * \brief      hr20gen: synthetic master output for many virtual thermostats
+ *
+ * Each virtual master prints the same lines as rfm-master/com.c: RTC?
+ * each minute, "(aa)?" slot requests, N1? / N0?, forced slots after O/P/N,
+ * packet blocks "(aa){ ... }" with status records and acks of queued
+ * commands. Commands of the daemon are queued per room and answered in
+ * the next packet like the slave firmware does (src/com.c). Rooms follow
+ * a simple heat model with day schedule, windows and manual overrides.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hr20proto.h"
+#include "pty.h"
+
+#define ADDR_PER_MASTER 29      //!< slot requests of one master, see COM_req_RTC
+#define MASTER_MAX 16
+#define Q_MAX 10                //!< commands queued per room
+#define PKT_CMDS 4              //!< acks in one packet
+#define STATUS_INTERVAL 240     //!< s, PID_interval * 5 of default config
+#define SHARE_N 3               //!< WL_SHARE_N of master
+
+typedef struct
+{
+	char cmd;
+	uint8_t tag;
+	uint8_t arg[3];
+} cmd_t;
+
+typedef struct
+{
+	uint8_t addr;
+	double T;               //!< room temperature [C]
+	double gain, loss;      //!< heat model [C/h per %], [1/h]
+	double battery;         //!< [mV]
+	int valve;
+	int wanted;             //!< [0.5 C]
+	int manual;             //!< s of manual override left
+	int window;             //!< s of open window left
+	uint8_t error;
+	uint8_t lock;
+	long next_status;
+	long updated;
+	cmd_t q[Q_MAX];
+	int qn;
+	uint8_t ee[256];
+	uint16_t timers[8][8];
+} room_t;
+
+typedef struct
+{
+	int fd;
+	char *name;             //!< pty symlink
+	hr20_stream_t in;
+	char *out;
+	size_t out_len, out_size;
+	room_t rooms[ADDR_PER_MASTER];
+	int n;
+	uint8_t force[ADDR_PER_MASTER + 1]; //!< addresses of forced slots
+	int force_n, force_pos;
+	int force_pair;         //!< O command: two addresses alternate
+	uint16_t seq;
+	uint8_t requested;      //!< address of forced request in previous second
+} master_t;
+
+static master_t masters[MASTER_MAX];
+static int master_n = 1;
+static long sim;                //!< simulated unix time
+static volatile sig_atomic_t stop;
+static unsigned long st_lines, st_cmds, st_acks, st_bytes;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20gen [-n <rooms>] [-m <masters>] [-x <speed>] [-t <seconds>] [-p <pty>]\n"
+		"\t-n <rooms>\tvirtual thermostats (default 29), at most 29 per master\n"
+		"\t-m <masters>\tmasters, one pty each (default rooms / 29 rounded up)\n"
+		"\t-x <speed>\tsimulated seconds per second (default 1)\n"
+		"\t-t <seconds>\tstop after simulated time\n"
+		"\t-p <pty>\tsymlink to pty (default /tmp/openhr20-gen), masters\n"
+		"\t\t\tabove the first get suffix .1, .2, ...\n");
+	exit(1);
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static double rnd(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+static void out(master_t *m, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void out(master_t *m, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (m->out_size - m->out_len < LINE_MAX_LEN)
+	{
+		m->out_size = m->out_size ? 2 * m->out_size : 65536;
+		m->out = realloc(m->out, m->out_size);
+		if (m->out == NULL)
+		{
+			perror("hr20gen");
+			exit(1);
+		}
+	}
+	va_start(ap, fmt);
+	len = vsnprintf(m->out + m->out_len, LINE_MAX_LEN, fmt, ap);
+	va_end(ap);
+	if (len >= LINE_MAX_LEN)
+	{
+		len = LINE_MAX_LEN - 1;
+	}
+	m->out_len += len;
+	st_lines++;
+	st_bytes += len;
+}
+
+static void flush(master_t *m)
+{
+	ssize_t w;
+
+	if (m->out_len == 0)
+	{
+		return;
+	}
+	w = write(m->fd, m->out, m->out_len);
+	if (w > 0)
+	{
+		memmove(m->out, m->out + w, m->out_len - w);
+		m->out_len -= w;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  heat model from last update to sim, day program 21 C 6-8 and 17-22 h
+ ******************************************************************************/
+static void room_update(room_t *r)
+{
+	for (; r->updated < sim; r->updated += 60)
+	{
+		struct tm tm;
+		time_t t = r->updated;
+		double h, out_T;
+		localtime_r(&t, &tm);
+		h = tm.tm_hour + tm.tm_min / 60.0;
+		out_T = 3 + 5 * sin(2 * M_PI * (h - 9) / 24);
+		if (r->manual > 0)
+		{
+			r->manual -= 60;
+		}
+		else
+		{
+			r->wanted = (((h >= 6) && (h < 8)) || ((h >= 17) && (h < 22))) ? 42 : 34;
+			if (rnd() < 0.02 / 60)
+			{
+				r->manual = 7200; // occupant turns the wheel for two hours
+				r->wanted = 46;
+			}
+		}
+		if (r->window > 0)
+		{
+			r->window -= 60;
+		}
+		else if (rnd() < 0.03 / 60)
+		{
+			r->window = 900;
+		}
+		if (r->window > 0)
+		{
+			r->valve = 0;
+		}
+		else
+		{
+			int v = 30 + (int)(40 * (r->wanted / 2.0 - r->T));
+			r->valve = (v < 0) ? 0 : ((v > 100) ? 100 : v);
+		}
+		r->T += (r->gain * r->valve - r->loss * (r->T - out_T) - ((r->window > 0) ? 6 : 0)) / 60
+			+ (rnd() - 0.5) * 0.01;
+		r->battery -= 0.5 / 1440;
+		if (rnd() < 0.0001 / 60)
+		{
+			r->error |= 0x08; // motor error, cleared by M / A
+		}
+	}
+	r->error = (r->error & ~0xc0) | ((r->battery < 2400) ? 0x40 : 0) | ((r->battery < 2000) ? 0x80 : 0);
+}
+
+/*!
+ *******************************************************************************
+ *  status record without command char, see print_status_rec of master
+ ******************************************************************************/
+static void status_rec(master_t *m, room_t *r)
+{
+	struct tm tm;
+	time_t t = sim;
+
+	localtime_r(&t, &tm);
+	out(m, " m%02d s%02d %c V%02d I%04d S%04d B%04d E%02x%s\n", tm.tm_min, tm.tm_sec,
+	    (r->manual > 0) ? 'M' : 'A', r->valve, (int)(r->T * 100), r->wanted * 50, (int)r->battery,
+	    r->error, (r->window > 0) ? " W" : "");
+}
+
+/*!
+ *******************************************************************************
+ *  packet of one room: acks of queued commands, periodic status
+ ******************************************************************************/
+static void room_packet(master_t *m, room_t *r)
+{
+	int due = (sim >= r->next_status);
+	int i, n;
+	struct tm tm;
+	time_t t = sim;
+
+	if (!due && (r->qn == 0))
+	{
+		return;
+	}
+	room_update(r);
+	localtime_r(&t, &tm);
+	out(m, "@%02d.%02d PKT%04x\n", tm.tm_sec, (int)(rnd() * 100), m->seq++);
+	out(m, "(%02x){\n", r->addr);
+	n = (r->qn < PKT_CMDS) ? r->qn : PKT_CMDS;
+	for (i = 0; i < n; i++)
+	{
+		cmd_t *c = &r->q[i];
+		if (c->tag)
+		{
+			out(m, "*#%02x ", c->tag);
+		}
+		else
+		{
+			out(m, "*");
+		}
+		st_acks++;
+		switch (c->cmd)
+		{
+		case 'A':
+			r->wanted = c->arg[0];
+			r->manual = 0;
+			r->error &= ~0x08;
+		/* fall through */
+		case 'M':
+			if (c->cmd == 'M')
+			{
+				r->manual = c->arg[0] ? 0 : 24 * 3600;
+				r->error &= ~0x08;
+			}
+		/* fall through */
+		case 'D':
+			out(m, "%c", c->cmd);
+			status_rec(m, r);
+			break;
+		case 'S':
+			r->ee[c->arg[0]] = c->arg[1];
+		/* fall through */
+		case 'G':
+			out(m, "%c[%02x]=%02x\n", c->cmd, c->arg[0], (c->arg[0] == 0xff) ? 0x14 : r->ee[c->arg[0]]);
+			break;
+		case 'W':
+			r->timers[(c->arg[0] >> 4) & 7][c->arg[0] & 7] = (c->arg[1] << 8) | c->arg[2];
+		/* fall through */
+		case 'R':
+			out(m, "%c[%02x]=%04x\n", c->cmd, c->arg[0], r->timers[(c->arg[0] >> 4) & 7][c->arg[0] & 7]);
+			break;
+		case 'T':
+			out(m, "T[%02x]=%04x\n", c->arg[0], 0);
+			break;
+		case 'L':
+			r->lock = c->arg[0] & 1;
+			out(m, "L%02x\n", r->lock);
+			break;
+		case 'V':
+			out(m, "VOpenHR20 hr20gen\n");
+			break;
+		default:
+			out(m, " %02x %02x %02x\n", c->cmd, c->arg[0], c->arg[1]);
+			break;
+		}
+	}
+	memmove(r->q, r->q + n, (r->qn - n) * sizeof(cmd_t));
+	r->qn -= n;
+	if (due)
+	{
+		out(m, "-D");
+		status_rec(m, r);
+		r->next_status = sim + STATUS_INTERVAL;
+	}
+	out(m, "}\n");
+}
+
+/*!
+ *******************************************************************************
+ *  line of daemon, answers like COM_commad_parse of master
+ ******************************************************************************/
+/*!
+ *******************************************************************************
+ *  N command: seconds 31..59 by backlog like MASTER_shares, plan like wl_share_mask
+ ******************************************************************************/
+static void shares(master_t *m, const hr20_msg_t *c)
+{
+	uint8_t addr[SHARE_N] = { 0 }, cnt[SHARE_N] = { 0 }, sec[SHARE_N];
+	int credit[SHARE_N] = { 0 };
+	int i, j, n, sum = 0, left = 29, total = 0;
+
+	for (i = 0; i + 1 < c->nargs; i += 2)
+	{
+		if ((c->arg[i] == 0) || (c->arg[i] > 29) || (c->arg[i + 1] <= cnt[SHARE_N - 1]))
+		{
+			continue;
+		}
+		for (j = SHARE_N - 1; (j > 0) && (cnt[j - 1] < c->arg[i + 1]); j--)
+		{
+			addr[j] = addr[j - 1];
+			cnt[j] = cnt[j - 1];
+		}
+		addr[j] = c->arg[i];
+		cnt[j] = c->arg[i + 1];
+	}
+	for (i = 0; i < SHARE_N; i++)
+	{
+		sum += cnt[i];
+	}
+	for (i = 0; i < SHARE_N; i++)
+	{
+		int v = sum ? cnt[i] * 29 / sum : 0;
+		if ((v == 0) && cnt[i])
+		{
+			v = 1;
+		}
+		v = (v < left) ? v : left;
+		sec[i] = (v < cnt[i]) ? v : cnt[i];
+		left -= sec[i];
+	}
+	for (i = 0; (left > 0) && (i < SHARE_N); i++)
+	{
+		int v = (left < cnt[i] - sec[i]) ? left : cnt[i] - sec[i];
+		sec[i] += v;
+		left -= v;
+	}
+	for (i = 0; i < SHARE_N; i++)
+	{
+		total += sec[i];
+	}
+	m->force_n = 29;
+	m->force_pos = 0;
+	m->force_pair = 0;
+	for (n = 0; n < 29; n++)
+	{
+		int best = 0;
+		m->force[n] = 0;
+		if (n >= total)
+		{
+			continue;
+		}
+		for (i = 0; i < SHARE_N; i++)
+		{
+			credit[i] += sec[i];
+			if (credit[i] > credit[best])
+			{
+				best = i;
+			}
+		}
+		credit[best] -= total;
+		m->force[n] = addr[best];
+	}
+	out(m, "N:");
+	for (i = 0; i < SHARE_N; i++)
+	{
+		if (sec[i])
+		{
+			out(m, " %02x:%02x", addr[i], sec[i]);
+		}
+	}
+	out(m, "\n");
+}
+
+static void command(const hr20_msg_t *c, void *ctx)
+{
+	master_t *m = ctx;
+	int i;
+
+	if (c->kind != HR20_M_COMMAND)
+	{
+		return;
+	}
+	if (c->line.p[0] == '(')
+	{
+		// (aa#tt)Xargs or (aa-b)Xargs
+		cmd_t q = { .cmd = c->cmd, .tag = c->tag };
+		int len = strchr("DV", c->cmd) ? 0 : (strchr("MALTGR", c->cmd) ? 1 : (strchr("SB", c->cmd) ? 2 : 3));
+		if (c->nargs != len)
+		{
+			return;
+		}
+		memcpy(q.arg, c->arg, len);
+		for (i = 0; i < m->n; i++)
+		{
+			room_t *r = &m->rooms[i];
+			if ((r->addr == c->addr) && (r->qn < Q_MAX))
+			{
+				r->q[r->qn++] = q;
+				st_cmds++;
+				out(m, "OK\n");
+			}
+		}
+		return;
+	}
+	switch (c->cmd)
+	{
+	case 'O':
+		if (c->nargs == 2)
+		{
+			m->force[0] = c->arg[0];
+			m->force[1] = c->arg[1];
+			m->force_n = 2;
+			m->force_pair = 1;
+			out(m, "OK\n");
+		}
+		break;
+	case 'P':
+		if (c->nargs == 4)
+		{
+			m->force_n = 0;
+			m->force_pos = 0;
+			m->force_pair = 0;
+			for (i = 1; i <= ADDR_PER_MASTER; i++)
+			{
+				if (c->arg[i / 8] & (1 << (i % 8)))
+				{
+					m->force[m->force_n++] = i;
+				}
+			}
+			out(m, "OK\n");
+		}
+		break;
+	case 'N':
+		shares(m, c);
+		break;
+	case 'F':
+		out(m, "F: C3f T0000 R0000 Q32 W04 S\n"); // default master build
+		break;
+	case 'C':
+		for (i = 0; i < m->n; i++)
+		{
+			room_t *r = &m->rooms[i];
+			room_update(r);
+			long last = r->next_status - STATUS_INTERVAL; // random phase at start
+			out(m, "(%02x)C t%04x p10 e00 x00 f00:00:00 @00 -D", r->addr,
+			    (unsigned)((sim > last) ? sim - last : 0) & 0xffff);
+			status_rec(m, r);
+		}
+		out(m, "C end r00\n");
+		break;
+	case 'H':
+	case 'Y':
+	case 'K':
+	case 'U':
+		out(m, "OK\n");
+		break;
+	default:
+		break;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  one simulated second of every master, see COM_req_RTC
+ ******************************************************************************/
+static void second(void)
+{
+	int s = sim % 60;
+	int k, i;
+
+	for (k = 0; k < master_n; k++)
+	{
+		master_t *m = &masters[k];
+		uint8_t req = 0;
+		if (s == 0)
+		{
+			out(m, "RTC?\n");
+		}
+		if (s < 29)
+		{
+			out(m, "(%02x)?\n", s + 1);
+		}
+		else if ((s == 29) || (s == 59))
+		{
+			out(m, "N%c?\n", (s == 59) ? '0' : '1');
+			if (s == 59)
+			{
+				m->force_n = 0;
+			}
+		}
+		else if (m->force_n > 0)
+		{
+			req = m->force_pair ? m->force[s & 1] : m->force[m->force_pos++ % m->force_n];
+			if (req)
+			{
+				out(m, "(%02x)?\n", req);
+			}
+		}
+		// slave of slot (or of forced request in previous second) sends
+		for (i = 0; i < m->n; i++)
+		{
+			room_t *r = &m->rooms[i];
+			if (((s >= 1) && (s <= 29) && (r->addr == s)) || ((m->requested != 0) && (r->addr == m->requested)))
+			{
+				room_packet(m, r);
+			}
+		}
+		m->requested = req;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pty_name = "/tmp/openhr20-gen";
+	struct pollfd p[MASTER_MAX];
+	int rooms = ADDR_PER_MASTER, masters_set = 0;
+	double speed = 1, next, t0;
+	long duration = 0, sim0;
+	int opt, k, i;
+
+	while ((opt = getopt(argc, argv, "n:m:x:t:p:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			rooms = atoi(optarg);
+			break;
+		case 'm':
+			master_n = atoi(optarg);
+			masters_set = 1;
+			break;
+		case 'x':
+			speed = atof(optarg);
+			break;
+		case 't':
+			duration = atol(optarg);
+			break;
+		case 'p':
+			pty_name = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!masters_set)
+	{
+		master_n = (rooms + ADDR_PER_MASTER - 1) / ADDR_PER_MASTER;
+	}
+	if ((optind != argc) || (rooms <= 0) || (speed <= 0) || (master_n <= 0) || (master_n > MASTER_MAX)
+	    || (rooms > master_n * ADDR_PER_MASTER))
+	{
+		usage();
+	}
+	srand(1);
+	sim0 = sim = time(NULL);
+	for (k = 0; k < master_n; k++)
+	{
+		master_t *m = &masters[k];
+		char name[256];
+		if (k == 0)
+		{
+			snprintf(name, sizeof(name), "%s", pty_name);
+		}
+		else
+		{
+			snprintf(name, sizeof(name), "%s.%d", pty_name, k);
+		}
+		m->fd = pty_open(name);
+		hr20_stream_init(&m->in);
+		m->name = strdup(name);
+		p[k].fd = m->fd;
+		p[k].events = POLLIN;
+		m->n = rooms / master_n + ((k < rooms % master_n) ? 1 : 0);
+		for (i = 0; i < m->n; i++)
+		{
+			room_t *r = &m->rooms[i];
+			r->addr = i + 1;
+			r->T = 19 + 2 * rnd();
+			r->gain = 0.05 + 0.1 * rnd();
+			r->loss = 0.2 + 0.3 * rnd();
+			r->battery = 2600 + 400 * rnd();
+			r->wanted = 42;
+			r->updated = sim;
+			r->next_status = sim + (long)(rnd() * STATUS_INTERVAL);
+			memset(r->timers, 0xff, sizeof(r->timers));
+		}
+	}
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	t0 = next = now();
+	while (!stop && ((duration == 0) || (sim - sim0 < duration)))
+	{
+		double wait = next - now();
+		if (poll(p, master_n, (wait > 0) ? (int)(wait * 1000) : 0) > 0)
+		{
+			for (k = 0; k < master_n; k++)
+			{
+				char buf[512];
+				ssize_t n;
+				if (!(p[k].revents & POLLIN))
+				{
+					continue;
+				}
+				n = read(p[k].fd, buf, sizeof(buf));
+				if (n > 0)
+				{
+					hr20_stream_feed(&masters[k].in, buf, n, command, &masters[k]);
+				}
+			}
+		}
+		if (now() >= next)
+		{
+			second();
+			sim++;
+			next += 1 / speed;
+		}
+		for (k = 0; k < master_n; k++)
+		{
+			flush(&masters[k]);
+		}
+	}
+	t0 = now() - t0;
+	for (k = 0; k < master_n; k++)
+	{
+		unlink(masters[k].name);
+	}
+	fprintf(stderr, "hr20gen: %ld s simulated in %.1f s, %lu lines %lu bytes out, %lu commands, %lu acks\n",
+		sim - sim0, t0, st_lines, st_bytes, st_cmds, st_acks);
+	return 0;
+}
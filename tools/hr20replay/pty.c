@@ -0,0 +1,148 @@
+/*
+ *  Open HR20 - serial capture and replay
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       pty.c
+ * \brief      helpers shared by hr20cap and hr20replay
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pty.h"
+
+static int pty_slave_fd = -1;
+
+double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*!
+ *******************************************************************************
+ *  pseudo terminal for the daemon, symlinked to symlink_name
+ *
+ *  \returns master side fd, non blocking
+ ******************************************************************************/
+int pty_open(const char *symlink_name)
+{
+	struct termios tio;
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ((fd < 0) || (grantpt(fd) < 0) || (unlockpt(fd) < 0))
+	{
+		perror("pty");
+		exit(1);
+	}
+	// keep slave open, master side would report hangup without reader
+	pty_slave_fd = open(ptsname(fd), O_RDWR | O_NOCTTY);
+	if (pty_slave_fd < 0)
+	{
+		perror(ptsname(fd));
+		exit(1);
+	}
+	tcgetattr(pty_slave_fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(pty_slave_fd, TCSANOW, &tio);
+	unlink(symlink_name);
+	if (symlink(ptsname(fd), symlink_name) < 0)
+	{
+		perror(symlink_name);
+		exit(1);
+	}
+	fprintf(stderr, "pty %s -> %s\n", symlink_name, ptsname(fd));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+static speed_t baud_code(long baud)
+{
+	switch (baud)
+	{
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	default:
+		fprintf(stderr, "unsupported baud rate %ld\n", baud);
+		exit(1);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  serial port of master, raw mode; other files (pty of softmaster) as is
+ ******************************************************************************/
+int serial_open(const char *dev, long baud)
+{
+	struct termios tio;
+	int fd = open(dev, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+	if (fd < 0)
+	{
+		perror(dev);
+		exit(1);
+	}
+	if (tcgetattr(fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, baud_code(baud));
+		cfsetospeed(&tio, baud_code(baud));
+		tio.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+/*!
+ *******************************************************************************
+ *  add character to line
+ *
+ *  \returns true when l->buf holds complete line (without '\n', '\r')
+ ******************************************************************************/
+int line_feed(line_buf_t *l, char c)
+{
+	if (l->len < 0)
+	{
+		l->len = 0;     // previous line was returned
+	}
+	if (c == '\n')
+	{
+		l->buf[l->len] = '\0';
+		l->len = -1;
+		return 1;
+	}
+	if ((c != '\r') && (l->len < LINE_MAX_LEN - 1))
+	{
+		l->buf[l->len++] = c; // rest of too long line is dropped
+	}
+	return 0;
+}
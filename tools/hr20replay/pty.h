@@ -0,0 +1,53 @@
+/*
+ *  Open HR20 - serial capture and replay
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       pty.h
+ * \brief      helpers shared by hr20cap and hr20replay
+ *
+ * Capture file is text, one line per exchanged line:
+ *
+ *	<seconds> <direction> <line>
+ *
+ * seconds are monotonic time from start of capture with microseconds,
+ * direction '<' is master -> daemon and '>' is daemon -> master.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#define CAPTURE_HEADER "# openhr20 capture 1"
+#define LINE_MAX_LEN 1024       //!< longer lines are truncated
+
+/*!
+ *  line assembly for one direction
+ */
+typedef struct
+{
+	char buf[LINE_MAX_LEN];
+	int len;
+} line_buf_t;
+
+double now(void);
+int pty_open(const char *symlink_name);
+int serial_open(const char *dev, long baud);
+int line_feed(line_buf_t *l, char c);
@@ -0,0 +1,360 @@
+/*
+ *  Open HR20 - serial capture and replay
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       replay.c
+ * \brief      hr20replay: feed a capture to the daemon and measure ingestion
+ *
+ * Master lines of a capture are written to a pty at recorded time divided
+ * by speed (or as fast as the daemon reads them). Lines "RTC?" and "N0?"
+ * / "N1?" are always answered by the daemon (Y/H and P/O lines), time to
+ * the answer is the latency of that line including the backlog before it.
+ * At the end one more "RTC?" is sent, its answer means all lines are
+ * processed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hr20proto.h"
+#include "pty.h"
+
+#define PROBE_MAX 4096          //!< unanswered probe lines in flight
+#define START_TIMEOUT 30        //!< s, daemon must answer start up within
+#define DRAIN_TIMEOUT 600       //!< s, daemon must process backlog within
+
+typedef struct
+{
+	double t[PROBE_MAX];
+	int in, out;
+} probes_t;
+
+static probes_t rtc_probes, n_probes;
+static double *lat;             //!< latencies of answered probes
+static int lat_n, lat_size;
+static int pty_fd;
+static hr20_stream_t from_daemon;
+static int drained;
+static pid_t child;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: hr20replay [-p <pty>] [-x <speed>] [-d <db>] [-e <command>] <capture>\n"
+		"\t-p <pty>\tsymlink to pty for the daemon (default /tmp/openhr20-replay)\n"
+		"\t-x <speed>\t1 .. 1000 times real time, 0 as fast as possible (default 0)\n"
+		"\t-d <db>\t\tdatabase file, its growth is reported\n"
+		"\t-e <command>\tstart daemon by /bin/sh -c after pty is ready, stopped at end\n");
+	exit(1);
+}
+
+static void probe_put(probes_t *p, double t)
+{
+	if (p->in - p->out < PROBE_MAX)
+	{
+		p->t[p->in++ % PROBE_MAX] = t;
+	}
+}
+
+static void probe_answer(probes_t *p, double t)
+{
+	if (p->in == p->out)
+	{
+		return; // unsolicited, e.g. RTC at daemon start
+	}
+	if (lat_n == lat_size)
+	{
+		lat_size = lat_size ? 2 * lat_size : 4096;
+		lat = realloc(lat, lat_size * sizeof(double));
+		if (lat == NULL)
+		{
+			perror("hr20replay");
+			exit(1);
+		}
+	}
+	lat[lat_n++] = t - p->t[p->out++ % PROBE_MAX];
+	if ((p == &rtc_probes) && (drained < 0) && (p->in == p->out))
+	{
+		drained = 1; // answer of final probe
+	}
+}
+
+static void daemon_line(const hr20_msg_t *m, void *ctx)
+{
+	double t = now();
+
+	(void)ctx;
+	if (m->kind != HR20_M_COMMAND)
+	{
+		return;
+	}
+	if (m->cmd == 'Y')
+	{
+		probe_answer(&rtc_probes, t);
+	}
+	else if ((m->cmd == 'P') || (m->cmd == 'O'))
+	{
+		probe_answer(&n_probes, t);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  read daemon output, match answers to probes
+ *
+ *  \returns bytes read
+ ******************************************************************************/
+static int daemon_read(void)
+{
+	char buf[512];
+	ssize_t n = read(pty_fd, buf, sizeof(buf));
+
+	if (n > 0)
+	{
+		hr20_stream_feed(&from_daemon, buf, n, daemon_line, NULL);
+	}
+	return (n > 0) ? n : 0;
+}
+
+/*!
+ *******************************************************************************
+ *  write whole line, daemon output is read meanwhile
+ ******************************************************************************/
+static void daemon_write(const char *s, size_t len)
+{
+	struct pollfd p = { pty_fd, POLLIN | POLLOUT, 0 };
+
+	while (len > 0)
+	{
+		ssize_t w = write(pty_fd, s, len);
+		if (w > 0)
+		{
+			s += w;
+			len -= w;
+			continue;
+		}
+		if ((w < 0) && (errno != EAGAIN))
+		{
+			perror("hr20replay: write");
+			exit(1);
+		}
+		poll(&p, 1, 100);
+		daemon_read();
+	}
+}
+
+static void wait_output(double timeout)
+{
+	struct pollfd p = { pty_fd, POLLIN, 0 };
+	int ms = (int)(timeout * 1000);
+
+	poll(&p, 1, (ms > 0) ? ms : 0);
+	daemon_read();
+}
+
+static long file_size(const char *name)
+{
+	struct stat st;
+
+	return ((name != NULL) && (stat(name, &st) == 0)) ? (long)st.st_size : -1;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void on_exit_stop(void)
+{
+	if (child > 0)
+	{
+		kill(child, SIGTERM);
+		waitpid(child, NULL, 0);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pty_name = "/tmp/openhr20-replay";
+	const char *db_name = NULL;
+	const char *cmd = NULL;
+	double speed = 0, t0, start, end;
+	long db_before, db_after, lines = 0, bytes = 0;
+	char line[LINE_MAX_LEN + 32];
+	FILE *in;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:x:d:e:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			pty_name = optarg;
+			break;
+		case 'x':
+			speed = atof(optarg);
+			if ((speed < 0) || (speed > 1000))
+			{
+				usage();
+			}
+			break;
+		case 'd':
+			db_name = optarg;
+			break;
+		case 'e':
+			cmd = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		usage();
+	}
+	in = fopen(argv[optind], "r");
+	if (in == NULL)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	if ((fgets(line, sizeof(line), in) == NULL) || strncmp(line, CAPTURE_HEADER, strlen(CAPTURE_HEADER)))
+	{
+		fprintf(stderr, "%s: not a capture file\n", argv[optind]);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	pty_fd = pty_open(pty_name);
+	if (cmd != NULL)
+	{
+		child = fork();
+		if (child == 0)
+		{
+			execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+			_exit(127);
+		}
+		atexit(on_exit_stop);
+	}
+
+	// daemon start up writes RTC and requests, replay starts after it is quiet
+	start = now();
+	while (!daemon_read())
+	{
+		if (now() - start > START_TIMEOUT)
+		{
+			fprintf(stderr, "hr20replay: no daemon on %s\n", pty_name);
+			return 1;
+		}
+		poll(&(struct pollfd){ pty_fd, POLLIN, 0 }, 1, 100);
+	}
+	while (now() - start < START_TIMEOUT)
+	{
+		struct pollfd p = { pty_fd, POLLIN, 0 };
+		if (poll(&p, 1, 500) <= 0)
+		{
+			break;
+		}
+		daemon_read();
+	}
+
+	db_before = file_size(db_name);
+	start = now();
+	t0 = -1;
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		double t;
+		char dir;
+		int pos;
+		if ((line[0] == '#') || (sscanf(line, "%lf %c %n", &t, &dir, &pos) < 2) || (dir != '<'))
+		{
+			continue;
+		}
+		if (t0 < 0)
+		{
+			t0 = t;
+		}
+		if (speed > 0)
+		{
+			double due = start + (t - t0) / speed;
+			while (now() < due)
+			{
+				wait_output(due - now());
+			}
+		}
+		if (!strncmp(line + pos, "RTC?", 4))
+		{
+			probe_put(&rtc_probes, now());
+		}
+		else if (!strncmp(line + pos, "N0?", 3) || !strncmp(line + pos, "N1?", 3))
+		{
+			probe_put(&n_probes, now());
+		}
+		daemon_write(line + pos, strlen(line + pos));
+		daemon_read();
+		lines++;
+		bytes += strlen(line + pos);
+	}
+	fclose(in);
+
+	// final probe, its answer ends the measurement
+	end = now() + DRAIN_TIMEOUT;
+	probe_put(&rtc_probes, now());
+	drained = -1;
+	daemon_write("RTC?\n", 5);
+	while ((drained < 0) && (now() < end))
+	{
+		wait_output(1);
+		if ((child > 0) && (waitpid(child, NULL, WNOHANG) == child))
+		{
+			child = 0;
+			fprintf(stderr, "hr20replay: daemon exited\n");
+			break;
+		}
+	}
+	end = now();
+	db_after = file_size(db_name);
+
+	printf("lines %ld, %ld bytes in %.3f s: %.0f lines/s%s\n", lines, bytes, end - start,
+	       lines / (end - start), (drained > 0) ? "" : " (not drained)");
+	if (lat_n > 0)
+	{
+		qsort(lat, lat_n, sizeof(double), cmp_double);
+		printf("latency of %d answered lines [ms]: p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n", lat_n,
+		       1000 * lat[lat_n / 2], 1000 * lat[lat_n * 95 / 100], 1000 * lat[lat_n * 99 / 100],
+		       1000 * lat[lat_n - 1]);
+	}
+	if ((db_before >= 0) && (db_after >= 0))
+	{
+		printf("database %ld -> %ld bytes, %.1f bytes per line\n", db_before, db_after,
+		       lines ? (double)(db_after - db_before) / lines : 0.0);
+	}
+	unlink(pty_name);
+	return (drained > 0) ? 0 : 1;
+}
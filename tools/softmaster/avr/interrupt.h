@@ -0,0 +1,35 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       avr/interrupt.h
+ * \brief      host replacement of avr-libc interrupt.h
+ *
+ * The soft master is single threaded, "interrupts" are plain function calls
+ * from the event loop, so cli()/sei() have nothing to protect.
+ */
+
+#pragma once
+
+#define cli()
+#define sei()
+
+#define ISR(vector) void vector(void)
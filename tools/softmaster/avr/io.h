@@ -0,0 +1,88 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       avr/io.h
+ * \brief      host replacement of avr-libc io.h
+ *
+ * Only registers touched by rfm-master and common sources are provided. They
+ * are plain variables, exceptions are PINB (reflects RFM nIRQ/SDO of the radio
+ * backend), the SPI unit (RFM_HW_SPI=1 builds, see host.c) and the EEPROM
+ * registers which are not used by the soft master.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+extern volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+extern volatile uint8_t PINA, PINC, PIND;
+extern volatile uint8_t MCUCR, MCUCSR, MCUSR, GICR, ACSR;
+extern volatile uint8_t TCCR1B, TIFR, TIMSK, TCNT2;
+extern volatile uint16_t OCR1A;
+
+uint8_t host_pinb(void);
+#define PINB host_pinb()
+
+extern volatile uint8_t SPCR;
+volatile uint8_t *host_spsr(void);
+volatile uint8_t *host_spdr(void);
+#define SPSR (*host_spsr())
+#define SPDR (*host_spdr())
+
+/* ATmega32 bit positions */
+#define PA1  1
+#define PA2  2
+#define PB1  1
+#define PB2  2
+#define PB3  3
+#define PB4  4
+#define PB5  5
+#define PB6  6
+#define PB7  7
+#define PD0  0
+#define PD1  1
+#define PD2  2
+#define PD5  5
+#define PD6  6
+#define PD7  7
+
+#define INT2   5
+#define ISC2   6
+#define JTD    7
+#define ACD    7
+#define CS11   1
+#define WGM12  3
+#define OCF1A  4
+#define OCIE1A 4
+#define SPR0   0
+#define SPR1   1
+#define MSTR   4
+#define SPE    6
+#define SPI2X  0
+#define SPIF   7
@@ -0,0 +1,39 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       avr/wdt.h
+ * \brief      host replacement of avr-libc wdt.h
+ *
+ * Short watchdog timeout is used by the firmware as reboot request,
+ * the soft master leaves the process in this case.
+ */
+
+#pragma once
+
+#define WDTO_15MS 0
+#define WDTO_2S   7
+
+void host_wdt_enable(uint8_t timeout);
+
+#define wdt_enable(t) host_wdt_enable(t)
+#define wdt_disable()
+#define wdt_reset()
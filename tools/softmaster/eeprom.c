@@ -0,0 +1,142 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       eeprom.c
+ * \brief      EEPROM of the soft master, optionally backed by a file
+ *
+ * The image has the layout of the hardware master EEPROM, so intel hex
+ * records (':' command) address the same bytes.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#define __EEPROM_C__
+#include "eeprom.h"
+
+#define EE_SIZE 1024
+#define EE_CONFIG_OFFSET 0x40
+
+config_t config;
+
+static uint8_t ee_image[EE_SIZE];
+static const char *ee_file;
+
+/*!
+ *******************************************************************************
+ *  load EEPROM image, defaults are taken from eeprom.h
+ ******************************************************************************/
+void EEPROM_host_init(const char *file)
+{
+	FILE *f;
+
+	memset(ee_image, 0xff, sizeof(ee_image));
+	ee_image[0] = ee_reserved1;
+	ee_image[1] = ee_reserved2;
+	ee_image[2] = ee_reserved3;
+	ee_image[3] = ee_layout;
+	memcpy(ee_image + 4, ee_reserved2_60, sizeof(ee_reserved2_60));
+	memcpy(ee_image + EE_CONFIG_OFFSET, ee_config, sizeof(ee_config));
+	ee_file = file;
+	if ((file != NULL) && ((f = fopen(file, "rb")) != NULL))
+	{
+		if (fread(ee_image, 1, sizeof(ee_image), f) != sizeof(ee_image))
+		{
+			fprintf(stderr, "%s: short EEPROM image\n", file);
+		}
+		fclose(f);
+	}
+}
+
+uint8_t EEPROM_read(uint16_t address)
+{
+	return ee_image[address % EE_SIZE];
+}
+
+uint8_t config_read(uint8_t cfg_address, uint8_t cfg_type)
+{
+	return EEPROM_read(EE_CONFIG_OFFSET + (((uint16_t)cfg_address) << 2) + cfg_type);
+}
+
+void EEPROM_write(uint16_t address, uint8_t data)
+{
+	FILE *f;
+
+	ee_image[address % EE_SIZE] = data;
+	if ((ee_file != NULL) && ((f = fopen(ee_file, "wb")) != NULL))
+	{
+		fwrite(ee_image, 1, sizeof(ee_image), f);
+		fclose(f);
+	}
+}
+
+#define config_write(cfg_address, data) (EEPROM_write(EE_CONFIG_OFFSET + (((uint16_t)cfg_address) << 2) + CONFIG_VALUE, data))
+
+/*!
+ *******************************************************************************
+ *  Init configuration storage, same as common/eeprom.c
+ ******************************************************************************/
+void eeprom_config_init(bool restore_default)
+{
+	uint16_t i;
+	uint8_t *config_ptr = config_raw;
+
+	for (i = 0; i < CONFIG_RAW_SIZE; i++)
+	{
+		if (restore_default)
+		{
+			*config_ptr = config_default(i);
+		}
+		else
+		{
+			*config_ptr = config_value(i);
+			if ((*config_ptr < config_min(i))
+			    || (*config_ptr > config_max(i)))
+			{
+				*config_ptr = config_default(i);
+			}
+		}
+		eeprom_config_save(i);
+		config_ptr++;
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  Update configuration storage, same as common/eeprom.c
+ ******************************************************************************/
+void eeprom_config_save(uint8_t idx)
+{
+	if (idx < CONFIG_RAW_SIZE)
+	{
+		if (config_raw[idx] != config_value(idx))
+		{
+			if ((config_raw[idx] < config_min(idx))
+			    || (config_raw[idx] > config_max(idx)))
+			{
+				config_raw[idx] = config_default(idx);
+			}
+			config_write(idx, config_raw[idx]);
+		}
+	}
+}
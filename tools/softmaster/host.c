@@ -0,0 +1,160 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       host.c
+ * \brief      AVR environment of the master firmware emulated on Linux
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include <avr/wdt.h>
+#include "common/rtc.h"
+#include "rfm_config.h"
+#include "common/rfm.h"
+#include "common/uart.h"
+#include "com.h"
+#include "radio.h"
+#include "link.h"
+
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t PINA, PINC, PIND;
+volatile uint8_t MCUCR, MCUCSR, MCUSR, GICR, ACSR;
+volatile uint8_t TCCR1B, TIFR, TIMSK, TCNT2;
+volatile uint16_t OCR1A;
+
+volatile uint8_t task;
+
+const radio_backend_t *radio;
+int radio_verbose;
+
+/*!
+ *******************************************************************************
+ *  RFM SDO pin, it signals FFIT/RGIT while nSEL is low
+ ******************************************************************************/
+uint8_t host_pinb(void)
+{
+	return radio->irq() ? _BV(RFM_SDO_BITPOS) : 0;
+}
+
+#if (RFM_HW_SPI == 1)
+volatile uint8_t SPCR;
+static volatile uint8_t spsr, spdr_out, spdr_in;
+uint8_t (*host_spi)(uint8_t outval);    //!< byte transfer of SPI unit, set by spicheck
+
+/*!
+ *******************************************************************************
+ *  SPI status register, SPIF is read only and set: transfer ends at once
+ ******************************************************************************/
+volatile uint8_t *host_spsr(void)
+{
+	spsr |= _BV(SPIF);
+	return &spsr;
+}
+
+/*!
+ *******************************************************************************
+ *  SPI data register of hardware SPI backend in common/rfm.c
+ *
+ *  \note accesses of rfm_spi8 alternate between write of byte to send and
+ *  \note read of received byte, transfer by host_spi runs on the read
+ ******************************************************************************/
+volatile uint8_t *host_spdr(void)
+{
+	static int rd;
+
+	rd = !rd;
+	if (rd)
+	{
+		return &spdr_out;
+	}
+	spdr_in = host_spi(spdr_out);
+	return &spdr_in;
+}
+#else
+/*!
+ *******************************************************************************
+ *  RFM SPI access, replaces bit banging of common/rfm.c
+ ******************************************************************************/
+uint16_t rfm_spi16(uint16_t outval)
+{
+	uint16_t ret = radio->spi16(outval);
+
+	if (radio_verbose > 1)
+	{
+		fprintf(stderr, "SPI %02d.%02d %04x %04x\n", RTC_GetSecond(), RTC_GetS100(), outval, ret);
+	}
+	return ret;
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  watchdog, short timeout is reboot request from 'B' command
+ ******************************************************************************/
+void host_wdt_enable(uint8_t timeout)
+{
+	if (timeout == WDTO_15MS)
+	{
+		fprintf(stderr, "reboot requested, exit\n");
+		exit(EXIT_SUCCESS);
+	}
+}
+
+/*!
+ *******************************************************************************
+ *  UART replacement, whole output buffer goes to the host link at once
+ ******************************************************************************/
+void UART_init(void)
+{
+}
+
+void UART_startSend(void)
+{
+	char c;
+
+	while ((c = COM_tx_char_isr()) != '\0')
+	{
+		link_putchar(c);
+	}
+	link_flush();
+}
+
+/*!
+ *******************************************************************************
+ *  debug dump of frames on air
+ ******************************************************************************/
+void radio_dump(const char *dir, const uint8_t *d, int len)
+{
+	if (!radio_verbose)
+	{
+		return;
+	}
+	fprintf(stderr, "%s %02d.%02d", dir, RTC_GetSecond(), RTC_GetS100());
+	while (len-- > 0)
+	{
+		fprintf(stderr, " %02x", *d++);
+	}
+	fputc('\n', stderr);
+}
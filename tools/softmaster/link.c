@@ -0,0 +1,269 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       link.c
+ * \brief      connection between soft master and host daemon
+ *
+ * The daemon sees the same ASCII protocol as on the serial port of the
+ * hardware master. It can use stdin/stdout (pipe), a TCP connection or a
+ * pseudo terminal which replaces /dev/ttyUSB0 for unmodified daemons.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "config.h"
+#include "com.h"
+#include "task.h"
+#include "master.h"
+#include "link.h"
+
+#define LINK_OUT_MAX (1024 * 1024)
+
+static int listen_fd = -1;
+static int in_fd = -1;
+static int out_fd = -1;
+static int pty_slave_fd = -1;
+static bool link_is_stdio = false;
+
+static char *out_buf;
+static size_t out_len;
+static size_t out_size;
+
+int link_open_stdio(void)
+{
+	in_fd = STDIN_FILENO;
+	out_fd = STDOUT_FILENO;
+	link_is_stdio = true;
+	fcntl(out_fd, F_SETFL, fcntl(out_fd, F_GETFL) | O_NONBLOCK);
+	return 0;
+}
+
+int link_open_listen(const char *port)
+{
+	struct addrinfo hints, *res;
+	int on = 1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET6;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	if (getaddrinfo(NULL, port, &hints, &res) != 0)
+	{
+		hints.ai_family = AF_INET;
+		if (getaddrinfo(NULL, port, &hints, &res) != 0)
+		{
+			fprintf(stderr, "listen: invalid port %s\n", port);
+			return -1;
+		}
+	}
+	listen_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (listen_fd < 0)
+	{
+		perror("socket");
+		freeaddrinfo(res);
+		return -1;
+	}
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if ((bind(listen_fd, res->ai_addr, res->ai_addrlen) < 0) || (listen(listen_fd, 1) < 0))
+	{
+		perror("listen");
+		freeaddrinfo(res);
+		return -1;
+	}
+	freeaddrinfo(res);
+	return 0;
+}
+
+int link_open_pty(const char *symlink_name)
+{
+	struct termios tio;
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+	if ((fd < 0) || (grantpt(fd) < 0) || (unlockpt(fd) < 0))
+	{
+		perror("pty");
+		return -1;
+	}
+	// keep slave open, master side would report hangup without reader
+	pty_slave_fd = open(ptsname(fd), O_RDWR | O_NOCTTY);
+	if (pty_slave_fd < 0)
+	{
+		perror(ptsname(fd));
+		return -1;
+	}
+	tcgetattr(pty_slave_fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(pty_slave_fd, TCSANOW, &tio);
+	unlink(symlink_name);
+	if (symlink(ptsname(fd), symlink_name) < 0)
+	{
+		perror(symlink_name);
+		return -1;
+	}
+	fprintf(stderr, "pty %s -> %s\n", symlink_name, ptsname(fd));
+	in_fd = fd;
+	out_fd = fd;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return 0;
+}
+
+void link_poll_fds(struct pollfd *fds, int *n)
+{
+	if (listen_fd >= 0)
+	{
+		fds[*n].fd = listen_fd;
+		fds[*n].events = POLLIN;
+		(*n)++;
+	}
+	if (in_fd >= 0)
+	{
+		fds[*n].fd = in_fd;
+		fds[*n].events = POLLIN | ((out_len > 0) ? POLLOUT : 0);
+		(*n)++;
+	}
+}
+
+static void link_close_client(void)
+{
+	if (listen_fd >= 0)
+	{
+		if (in_fd >= 0)
+		{
+			close(in_fd);
+		}
+		in_fd = -1;
+		out_fd = -1;
+		out_len = 0;
+	}
+	else if (link_is_stdio)
+	{
+		exit(EXIT_SUCCESS);
+	}
+}
+
+void link_event(struct pollfd *fds, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (fds[i].revents == 0)
+		{
+			continue;
+		}
+		if (fds[i].fd == listen_fd)
+		{
+			int fd = accept(listen_fd, NULL, NULL);
+			if (fd >= 0)
+			{
+				link_close_client(); // only one daemon at a time
+				in_fd = fd;
+				out_fd = fd;
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			}
+		}
+		else if (fds[i].fd == in_fd)
+		{
+			if (fds[i].revents & POLLOUT)
+			{
+				link_flush();
+			}
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+			{
+				char buf[256];
+				ssize_t len = read(in_fd, buf, sizeof(buf));
+				ssize_t j;
+				if ((len < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+				{
+					continue;
+				}
+				if (len <= 0)
+				{
+					link_close_client();
+					continue;
+				}
+				for (j = 0; j < len; j++)
+				{
+					COM_rx_char_isr(buf[j]);
+					// serial is slow enough to process each line before next one
+					while (task & TASK_COM)
+					{
+						MASTER_tasks();
+					}
+				}
+			}
+		}
+	}
+}
+
+void link_putchar(char c)
+{
+	if (out_fd < 0)
+	{
+		return; // nobody listen, same as serial port without cable
+	}
+	if (out_len >= out_size)
+	{
+		if (out_size >= LINK_OUT_MAX)
+		{
+			return;
+		}
+		out_size = out_size ? out_size * 2 : 4096;
+		out_buf = realloc(out_buf, out_size);
+		if (out_buf == NULL)
+		{
+			abort();
+		}
+	}
+	out_buf[out_len++] = c;
+}
+
+void link_flush(void)
+{
+	ssize_t len;
+
+	if ((out_fd < 0) || (out_len == 0))
+	{
+		return;
+	}
+	len = write(out_fd, out_buf, out_len);
+	if (len < 0)
+	{
+		if ((errno != EAGAIN) && (errno != EINTR))
+		{
+			link_close_client();
+		}
+		return;
+	}
+	memmove(out_buf, out_buf + len, out_len - len);
+	out_len -= len;
+}
@@ -0,0 +1,39 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       link.h
+ * \brief      connection between soft master and host daemon
+ */
+
+#pragma once
+
+#include <poll.h>
+
+int link_open_stdio(void);
+int link_open_listen(const char *port);
+int link_open_pty(const char *symlink_name);
+
+void link_poll_fds(struct pollfd *fds, int *n);
+void link_event(struct pollfd *fds, int n);
+
+void link_putchar(char c);
+void link_flush(void);
@@ -0,0 +1,51 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       radio.h
+ * \brief      pluggable RFM12 backend for the soft master
+ *
+ * The firmware talks to the RFM12 only through rfm_spi16() and the
+ * nIRQ/SDO pin. A backend provides exactly these two things, plus a file
+ * descriptor the event loop waits on.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+	const char *name;
+	int (*open)(const char *arg);           //!< returns 0 on success
+	uint16_t (*spi16)(uint16_t outval);     //!< one 16 bit SPI transfer
+	int (*irq)(void);                       //!< non zero while nIRQ is active
+	int (*fd)(void);                        //!< descriptor to poll, -1 if none
+	void (*event)(void);                    //!< descriptor is readable
+} radio_backend_t;
+
+extern const radio_backend_t radio_sim;
+extern const radio_backend_t radio_spidev;
+
+extern const radio_backend_t *radio;
+extern int radio_verbose;
+
+void radio_dump(const char *dir, const uint8_t *d, int len);
@@ -0,0 +1,360 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       radio_sim.c
+ * \brief      simulated RFM12 on a virtual RF medium
+ *
+ * The medium is a directory, every node binds one unix datagram socket in
+ * it. A transmitted frame (everything written to the TX register between
+ * transmitter on and off) is sent to all other sockets of the directory.
+ * The receiver emulates the FIFO sync pattern search: bytes following
+ * 0x2dd4 are presented in the FIFO until the firmware restarts the search
+ * by FIFO fill disable, receiver off or transmitter on.
+ *
+ * Datagrams arrive at once, the medium stays occupied for the airtime of a
+ * frame (length and the data rate set by command 0xc6xx) after its arrival.
+ * Meanwhile the status read reports RSSI and a further frame is a collision.
+ * Frames are prefixed by the data rate command of the sender (0xc6, low
+ * byte), receiver set to other data rate ignores them. Frames without this
+ * prefix are received at any data rate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "radio.h"
+
+#define SIM_FRAME_MAX 256
+#define SIM_HDR 2       //!< data rate prefix of frame
+
+#define PM_ER 0x80
+#define PM_ET 0x20
+#define FIFO_FF 0x02
+#define STATUS_RSSI 0x0100
+
+static int sim_sock = -1;
+static char sim_dir[sizeof(((struct sockaddr_un *)0)->sun_path) - 32];
+static char sim_self[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static uint16_t sim_pm;         //!< last power management command
+static uint8_t sim_fifo_fill;   //!< FIFO fill enabled
+
+static uint8_t sim_tx[SIM_HDR + SIM_FRAME_MAX];
+static int sim_tx_len;
+
+static uint8_t sim_rx[SIM_FRAME_MAX];
+static int sim_rx_len;
+static int sim_rx_pos;
+
+static unsigned long sim_collisions;
+
+static uint16_t sim_rate = 0xc623;      //!< last data rate command, power on default
+static double sim_air_until;            //!< medium occupied until this time
+
+/*!
+ *******************************************************************************
+ *  monotonic time in seconds
+ ******************************************************************************/
+static double sim_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*!
+ *******************************************************************************
+ *  airtime of len bytes at data rate command rate
+ *
+ *  \note bit rate = 10MHz / 29 / (R + 1) / (1 + cs * 7), see RFM12 datasheet
+ ******************************************************************************/
+static double sim_airtime(int len, uint16_t rate)
+{
+	double bps = 10000000.0 / 29 / ((rate & 0x7f) + 1);
+
+	if (rate & 0x80)
+	{
+		bps /= 8;
+	}
+	return len * 8 / bps;
+}
+
+/*!
+ *******************************************************************************
+ *  send transmitted frame to all other nodes on the medium
+ ******************************************************************************/
+static void sim_emit(void)
+{
+	DIR *d;
+	struct dirent *e;
+	struct sockaddr_un to;
+
+	if (sim_tx_len == 0)
+	{
+		return;
+	}
+	radio_dump("TX", sim_tx + SIM_HDR, sim_tx_len);
+	sim_tx[0] = sim_rate >> 8;
+	sim_tx[1] = sim_rate & 0xff;
+	d = opendir(sim_dir);
+	if (d == NULL)
+	{
+		return;
+	}
+	memset(&to, 0, sizeof(to));
+	to.sun_family = AF_UNIX;
+	while ((e = readdir(d)) != NULL)
+	{
+		size_t l = strlen(e->d_name);
+		if ((l < 6) || strcmp(e->d_name + l - 5, ".sock"))
+		{
+			continue;
+		}
+		if (strlen(sim_dir) + 1 + l >= sizeof(to.sun_path))
+		{
+			continue;
+		}
+		strcpy(to.sun_path, sim_dir);
+		strcat(to.sun_path, "/");
+		strcat(to.sun_path, e->d_name);
+		if (!strcmp(to.sun_path, sim_self))
+		{
+			continue;
+		}
+		// stale sockets of stopped nodes return ECONNREFUSED, ignore it
+		sendto(sim_sock, sim_tx, SIM_HDR + sim_tx_len, MSG_DONTWAIT, (struct sockaddr *)&to, sizeof(to));
+	}
+	closedir(d);
+	sim_tx_len = 0;
+}
+
+/*!
+ *******************************************************************************
+ *  restart FIFO sync pattern search
+ ******************************************************************************/
+static void sim_rx_reset(void)
+{
+	sim_rx_len = 0;
+	sim_rx_pos = 0;
+}
+
+static int sim_open(const char *arg)
+{
+	struct sockaddr_un me;
+
+	if ((arg == NULL) || (strlen(arg) >= sizeof(sim_dir)))
+	{
+		fprintf(stderr, "sim: medium directory expected\n");
+		return -1;
+	}
+	strcpy(sim_dir, arg);
+	if ((mkdir(sim_dir, 0777) < 0) && (errno != EEXIST))
+	{
+		perror(sim_dir);
+		return -1;
+	}
+	sim_sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sim_sock < 0)
+	{
+		perror("socket");
+		return -1;
+	}
+	memset(&me, 0, sizeof(me));
+	me.sun_family = AF_UNIX;
+	snprintf(sim_self, sizeof(sim_self), "%s/master-%d.sock", sim_dir, (int)getpid());
+	strcpy(me.sun_path, sim_self);
+	unlink(sim_self);
+	if (bind(sim_sock, (struct sockaddr *)&me, sizeof(me)) < 0)
+	{
+		perror(sim_self);
+		return -1;
+	}
+	return 0;
+}
+
+/*!
+ *******************************************************************************
+ *  receive one datagram from the medium
+ *
+ *  \returns 0 when none was pending
+ ******************************************************************************/
+static int sim_receive(void)
+{
+	uint8_t frame[SIM_HDR + SIM_FRAME_MAX];
+	uint8_t *buf = frame;
+	ssize_t len = recv(sim_sock, frame, sizeof(frame), MSG_DONTWAIT);
+	uint16_t rate = sim_rate;
+	double now = sim_now();
+	int busy;
+	int i;
+
+	if (len <= 0)
+	{
+		return 0;
+	}
+	if ((len > SIM_HDR) && (frame[0] == (sim_rate >> 8)))
+	{
+		rate = (frame[0] << 8) | frame[1];
+		buf += SIM_HDR;
+		len -= SIM_HDR;
+	}
+	busy = now < sim_air_until;
+	if (!busy)
+	{
+		sim_air_until = now;
+	}
+	sim_air_until += sim_airtime(len, rate);
+	if (!(sim_pm & PM_ER) || !sim_fifo_fill || (rate != sim_rate))
+	{
+		return 1; // receiver is off or at other data rate
+	}
+	if (busy || (sim_rx_len != 0))
+	{
+		sim_collisions++;
+		if (radio_verbose)
+		{
+			fprintf(stderr, "sim: collision #%lu, frame dropped\n", sim_collisions);
+		}
+		return 1;
+	}
+	radio_dump("RX", buf, len);
+	for (i = 0; i + 1 < len; i++)
+	{
+		if ((buf[i] == 0x2d) && (buf[i + 1] == 0xd4))
+		{
+			sim_rx_len = len - i - 2;
+			memcpy(sim_rx, buf + i + 2, sim_rx_len);
+			sim_rx_pos = 0;
+			return 1;
+		}
+	}
+	return 1;
+}
+
+static uint16_t sim_spi16(uint16_t outval)
+{
+	switch (outval & 0xff00)
+	{
+	case 0x0000:    // status read
+	{
+		uint16_t status = 0;
+		while (sim_receive())
+		{
+			;       // medium state up to date
+		}
+		if (sim_pm & PM_ET)
+		{
+			status |= 0x8000;       // RGIT
+		}
+		else if (sim_rx_pos < sim_rx_len)
+		{
+			status |= 0x8000;       // FFIT
+		}
+		if (sim_rx_pos >= sim_rx_len)
+		{
+			status |= 0x0200;       // FFEM
+		}
+		if ((sim_pm & PM_ER) && !(sim_pm & PM_ET) && (sim_now() < sim_air_until))
+		{
+			status |= STATUS_RSSI;
+		}
+		return status;
+	}
+	case 0x8200:    // power management
+		if ((sim_pm & PM_ET) && !(outval & PM_ET))
+		{
+			sim_emit();
+		}
+		if (!(sim_pm & PM_ET) && (outval & PM_ET))
+		{
+			sim_tx_len = 0;
+		}
+		if (!(outval & PM_ER) || (outval & PM_ET))
+		{
+			sim_rx_reset();
+		}
+		sim_pm = outval;
+		break;
+	case 0xb800:    // TX register write
+		if ((sim_pm & PM_ET) && (sim_tx_len < SIM_FRAME_MAX))
+		{
+			sim_tx[SIM_HDR + sim_tx_len++] = outval & 0xff;
+		}
+		break;
+	case 0xb000:    // RX FIFO read
+		if (sim_rx_pos < sim_rx_len)
+		{
+			return sim_rx[sim_rx_pos++];
+		}
+		break;
+	case 0xc600:    // data rate
+		sim_rate = outval;
+		break;
+	case 0xca00:    // FIFO and reset mode
+		sim_fifo_fill = (outval & FIFO_FF) != 0;
+		if (!sim_fifo_fill)
+		{
+			sim_rx_reset();
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int sim_irq(void)
+{
+	if (sim_pm & PM_ET)
+	{
+		return 1;
+	}
+	return (sim_pm & PM_ER) && sim_fifo_fill && (sim_rx_pos < sim_rx_len);
+}
+
+static int sim_fd(void)
+{
+	return sim_sock;
+}
+
+static void sim_event(void)
+{
+	sim_receive();
+}
+
+const radio_backend_t radio_sim = {
+	"sim",
+	sim_open,
+	sim_spi16,
+	sim_irq,
+	sim_fd,
+	sim_event
+};
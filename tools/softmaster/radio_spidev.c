@@ -0,0 +1,166 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       radio_spidev.c
+ * \brief      RFM12 attached to Linux spidev, nIRQ on a sysfs GPIO
+ *
+ * Argument format: /dev/spidevB.C:GPIO, for example /dev/spidev0.0:25
+ * The GPIO is configured for falling edge, so poll() wakes the event loop
+ * when the RFM12 raises nIRQ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "radio.h"
+
+#define SPIDEV_SPEED_HZ 2500000
+
+static int spi_fd = -1;
+static int irq_fd = -1;
+
+/*!
+ *******************************************************************************
+ *  write string to sysfs file
+ ******************************************************************************/
+static int sysfs_write(const char *file, const char *value)
+{
+	int fd = open(file, O_WRONLY);
+	int ret;
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+	ret = (write(fd, value, strlen(value)) == (ssize_t)strlen(value)) ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+static int spidev_open(const char *arg)
+{
+	char dev[64];
+	char path[64];
+	const char *sep;
+	int gpio;
+	uint8_t mode = SPI_MODE_0;
+	uint8_t bits = 8;
+	uint32_t speed = SPIDEV_SPEED_HZ;
+
+	if ((arg == NULL) || ((sep = strchr(arg, ':')) == NULL) || ((size_t)(sep - arg) >= sizeof(dev)))
+	{
+		fprintf(stderr, "spidev: /dev/spidevB.C:GPIO expected\n");
+		return -1;
+	}
+	memcpy(dev, arg, sep - arg);
+	dev[sep - arg] = '\0';
+	gpio = atoi(sep + 1);
+
+	spi_fd = open(dev, O_RDWR);
+	if (spi_fd < 0)
+	{
+		perror(dev);
+		return -1;
+	}
+	if ((ioctl(spi_fd, SPI_IOC_WR_MODE, &mode) < 0)
+	    || (ioctl(spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0)
+	    || (ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0))
+	{
+		perror("spidev setup");
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%d", gpio);
+	sysfs_write("/sys/class/gpio/export", path);    // fails if already exported
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/direction", gpio);
+	sysfs_write(path, "in");
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/edge", gpio);
+	if (sysfs_write(path, "falling") < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", gpio);
+	irq_fd = open(path, O_RDONLY);
+	if (irq_fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static uint16_t spidev_spi16(uint16_t outval)
+{
+	uint8_t tx[2] = { outval >> 8, outval & 0xff };
+	uint8_t rx[2] = { 0, 0 };
+	struct spi_ioc_transfer t;
+
+	memset(&t, 0, sizeof(t));
+	t.tx_buf = (unsigned long)tx;
+	t.rx_buf = (unsigned long)rx;
+	t.len = 2;
+	t.speed_hz = SPIDEV_SPEED_HZ;
+	t.bits_per_word = 8;
+	if (ioctl(spi_fd, SPI_IOC_MESSAGE(1), &t) < 0)
+	{
+		perror("spidev transfer");
+		return 0;
+	}
+	return ((uint16_t)rx[0] << 8) | rx[1];
+}
+
+static int spidev_irq(void)
+{
+	char c = '1';
+
+	lseek(irq_fd, 0, SEEK_SET);
+	if (read(irq_fd, &c, 1) != 1)
+	{
+		return 0;
+	}
+	return c == '0';        // nIRQ is active low
+}
+
+static int spidev_fd(void)
+{
+	return irq_fd;
+}
+
+static void spidev_event(void)
+{
+	// edge is consumed by spidev_irq()
+}
+
+const radio_backend_t radio_spidev = {
+	"spidev",
+	spidev_open,
+	spidev_spi16,
+	spidev_irq,
+	spidev_fd,
+	spidev_event
+};
@@ -0,0 +1,201 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       simnoise.c
+ * \brief      interfering traffic on the virtual RF medium of radio_sim.c
+ *
+ * Sends frames without sync pattern to all nodes of the medium. They are
+ * never received but occupy the medium for their airtime, like a foreign
+ * network on the same channel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: simnoise [-d <dir>] [-i <ms>] [-o <ms>] [-n <bytes>] [-c <count>]\n"
+		"\t-d <dir>\tmedium directory (default /tmp/openhr20-air)\n"
+		"\t-i <ms>\t\tmean interval, random (exponential) spacing (default 500)\n"
+		"\t-o <ms>\t\tinstead send once per second at this offset, e.g. -o 0\n"
+		"\t\t\tcollides with the sync of the master\n"
+		"\t-n <bytes>\tframe length, 40 bytes are 33ms at 9600bps (default 40)\n"
+		"\t-c <count>\tstop after count frames (default endless)\n");
+	exit(1);
+}
+
+/*!
+ *******************************************************************************
+ *  send one frame to all nodes on the medium
+ ******************************************************************************/
+static void noise_emit(int sock, const char *dir, const uint8_t *buf, int len)
+{
+	DIR *d;
+	struct dirent *e;
+	struct sockaddr_un to;
+
+	d = opendir(dir);
+	if (d == NULL)
+	{
+		return;
+	}
+	memset(&to, 0, sizeof(to));
+	to.sun_family = AF_UNIX;
+	while ((e = readdir(d)) != NULL)
+	{
+		size_t l = strlen(e->d_name);
+		if ((l < 6) || strcmp(e->d_name + l - 5, ".sock"))
+		{
+			continue;
+		}
+		if (strlen(dir) + 1 + l >= sizeof(to.sun_path))
+		{
+			continue;
+		}
+		strcpy(to.sun_path, dir);
+		strcat(to.sun_path, "/");
+		strcat(to.sun_path, e->d_name);
+		sendto(sock, buf, len, MSG_DONTWAIT, (struct sockaddr *)&to, sizeof(to));
+	}
+	closedir(d);
+}
+
+/*!
+ *******************************************************************************
+ *  sleep until next frame
+ ******************************************************************************/
+static void noise_wait(long interval, long offset)
+{
+	struct timespec t;
+	double ms;
+
+	if (offset >= 0)
+	{
+		// to the next offset within the second
+		clock_gettime(CLOCK_REALTIME, &t);
+		ms = offset - t.tv_nsec / 1000000.0;
+		if (ms <= 0)
+		{
+			ms += 1000;
+		}
+	}
+	else
+	{
+		ms = -log(1.0 - drand48()) * interval;
+	}
+	t.tv_sec = (time_t)(ms / 1000);
+	t.tv_nsec = (long)((ms - t.tv_sec * 1000.0) * 1000000);
+	nanosleep(&t, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = "/tmp/openhr20-air";
+	long interval = 500;
+	long offset = -1;
+	long count = -1;
+	int len = 40;
+	uint8_t buf[256];
+	char self[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	struct sockaddr_un me;
+	int sock, opt;
+
+	while ((opt = getopt(argc, argv, "d:i:o:n:c:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			dir = optarg;
+			break;
+		case 'i':
+			interval = atol(optarg);
+			break;
+		case 'o':
+			offset = atol(optarg) % 1000;
+			break;
+		case 'n':
+			len = atoi(optarg);
+			break;
+		case 'c':
+			count = atol(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if ((len < 1) || (len > (int)sizeof(buf)) || (interval < 1))
+	{
+		usage();
+	}
+	if (strlen(dir) + 32 >= sizeof(self))
+	{
+		fprintf(stderr, "simnoise: medium directory name too long\n");
+		return 1;
+	}
+	if ((mkdir(dir, 0777) < 0) && (errno != EEXIST))
+	{
+		perror(dir);
+		return 1;
+	}
+	sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sock < 0)
+	{
+		perror("socket");
+		return 1;
+	}
+	// bound to a name without .sock, the noise source does not receive
+	memset(&me, 0, sizeof(me));
+	me.sun_family = AF_UNIX;
+	snprintf(self, sizeof(self), "%s/noise-%d", dir, (int)getpid());
+	strcpy(me.sun_path, self);
+	unlink(self);
+	if (bind(sock, (struct sockaddr *)&me, sizeof(me)) < 0)
+	{
+		perror(self);
+		return 1;
+	}
+	srand48(getpid() ^ time(NULL));
+	// preamble pattern only, never contains the sync pattern 0x2dd4
+	memset(buf, 0xaa, len);
+	while (count != 0)
+	{
+		noise_wait(interval, offset);
+		noise_emit(sock, dir, buf, len);
+		if (count > 0)
+		{
+			count--;
+		}
+	}
+	unlink(self);
+	return 0;
+}
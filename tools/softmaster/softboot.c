@@ -0,0 +1,280 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       softboot.c
+ * \brief      RF bootloader of the slave (rfboot.c) as a Linux process
+ *
+ * Flash and EEPROM of the slave are files, the radio is a backend of the
+ * soft master. Used to test firmware update through the soft master on
+ * the sim: medium without hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+
+#include "radio.h"
+#include "rfboot.h"
+#include "common/ota.h"
+
+#define FLASH_SIZE OTA_APP_MAX
+#define EE_SIZE 512
+
+const radio_backend_t *radio;
+int radio_verbose;
+
+unsigned char buf[OTA_PAGE];
+unsigned int FlashAddr;
+
+static int flash_fd = -1;
+static int ee_fd = -1;
+static uint8_t flash[FLASH_SIZE];
+static uint8_t ee[EE_SIZE];
+static double tick_next;
+static unsigned pages_written;
+
+static const uint8_t security_key[8] = {
+	SECURITY_KEY_0, SECURITY_KEY_1, SECURITY_KEY_2, SECURITY_KEY_3,
+	SECURITY_KEY_4, SECURITY_KEY_5, SECURITY_KEY_6, SECURITY_KEY_7
+};
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: softboot [-r <radio>] -f <flash> -e <eeprom> [-u <addr>:<id>:<size>] [-v]\n"
+		"\t-r sim:<dir>\tradio backend (default sim:/tmp/openhr20-air)\n"
+		"\t-f <file>\tapplication flash image, created when missing\n"
+		"\t-e <file>\tEEPROM image of the slave, created when missing\n"
+		"\t-u a:i:s\tstore update request like command 'U' of the application\n"
+		"\t-v\t\tdump radio frames to stderr\n");
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*!
+ *******************************************************************************
+ *  load image file, missing part is erased memory
+ ******************************************************************************/
+static int image_open(const char *name, uint8_t *image, int size)
+{
+	int fd = open(name, O_RDWR | O_CREAT, 0644);
+
+	if (fd < 0)
+	{
+		perror(name);
+		exit(1);
+	}
+	memset(image, 0xff, size);
+	if (read(fd, image, size) < 0)
+	{
+		perror(name);
+		exit(1);
+	}
+	return fd;
+}
+
+static void image_write(int fd, const uint8_t *d, int ofs, int len)
+{
+	if (pwrite(fd, d, len, ofs) != len)
+	{
+		perror("softboot: write");
+		exit(1);
+	}
+}
+
+void radio_dump(const char *dir, const uint8_t *d, int len)
+{
+	if (!radio_verbose)
+	{
+		return;
+	}
+	fprintf(stderr, "%s", dir);
+	while (len-- > 0)
+	{
+		fprintf(stderr, " %02x", *d++);
+	}
+	fputc('\n', stderr);
+}
+
+void write_one_page(unsigned char *page)
+{
+	if (FlashAddr + OTA_PAGE > FLASH_SIZE)
+	{
+		fprintf(stderr, "softboot: page 0x%04x outside application\n", FlashAddr);
+		exit(1);
+	}
+	memcpy(flash + FlashAddr, page, OTA_PAGE);
+	image_write(flash_fd, page, FlashAddr, OTA_PAGE);
+	pages_written++;
+	if (radio_verbose)
+	{
+		fprintf(stderr, "softboot: page 0x%04x written\n", FlashAddr);
+	}
+}
+
+void quit(void)
+{
+	printf("softboot: start application, %u pages written\n", pages_written);
+	exit(0);
+}
+
+void rfb_init(void)
+{
+	tick_next = now();
+}
+
+uint16_t rfm_spi16(uint16_t outval)
+{
+	return radio->spi16(outval);
+}
+
+uint8_t rfb_ee_read(uint8_t ofs)
+{
+	return ee[OTA_EE_ADDR + ofs];
+}
+
+void rfb_ee_write(uint8_t ofs, uint8_t val)
+{
+	ee[OTA_EE_ADDR + ofs] = val;
+	image_write(ee_fd, &val, OTA_EE_ADDR + ofs, 1);
+}
+
+uint8_t rfb_flash_read(uint16_t addr)
+{
+	return (addr < FLASH_SIZE) ? flash[addr] : 0xff;
+}
+
+void rfb_flash_enable(void)
+{
+}
+
+/*!
+ *******************************************************************************
+ *  10ms tick, waits shortly for radio between ticks instead of spinning
+ ******************************************************************************/
+bool rfb_tick(void)
+{
+	struct pollfd p;
+
+	if (now() >= tick_next)
+	{
+		tick_next += 1.0 / RFB_TICK_HZ;
+		return true;
+	}
+	p.fd = radio->fd();
+	p.events = POLLIN;
+	poll(&p, (p.fd >= 0) ? 1 : 0, 1);
+	return false;
+}
+
+/*!
+ *******************************************************************************
+ *  update request as stored by COM_ota_request of the application
+ ******************************************************************************/
+static void request(const char *arg)
+{
+	unsigned addr, id, size;
+	uint8_t *b = ee + OTA_EE_ADDR;
+
+	if ((sscanf(arg, "%u:%u:%u", &addr, &id, &size) != 3)
+	    || (addr == 0) || (addr > 0x7f) || (id == 0) || (id > 0xff)
+	    || (size == 0) || (size > OTA_APP_MAX))
+	{
+		usage();
+	}
+	b[OTA_EE_ID] = id;
+	b[OTA_EE_SIZE_H] = size >> 8;
+	b[OTA_EE_SIZE_L] = size & 0xff;
+	b[OTA_EE_PAGES] = 0;
+	b[OTA_EE_DEVADDR] = addr;
+	b[OTA_EE_RATE] = 0xff; // default rate
+	b[OTA_EE_FREQ] = 0;
+	memcpy(b + OTA_EE_KEY, security_key, 8);
+	b[OTA_EE_MAGIC] = OTA_MAGIC;
+	image_write(ee_fd, b, OTA_EE_ADDR, OTA_EE_LEN);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *radio_arg = "sim:/tmp/openhr20-air";
+	const char *flash_name = NULL;
+	const char *ee_name = NULL;
+	const char *req = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:f:e:u:vh")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r':
+			radio_arg = optarg;
+			break;
+		case 'f':
+			flash_name = optarg;
+			break;
+		case 'e':
+			ee_name = optarg;
+			break;
+		case 'u':
+			req = optarg;
+			break;
+		case 'v':
+			radio_verbose++;
+			break;
+		default:
+			usage();
+		}
+	}
+	if ((flash_name == NULL) || (ee_name == NULL) || strncmp(radio_arg, "sim:", 4))
+	{
+		usage();
+	}
+	flash_fd = image_open(flash_name, flash, sizeof(flash));
+	ee_fd = image_open(ee_name, ee, sizeof(ee));
+	if (req != NULL)
+	{
+		request(req);
+	}
+	radio = &radio_sim;
+	if (radio->open(radio_arg + 4) < 0)
+	{
+		return 1;
+	}
+	if (!rfboot_pending())
+	{
+		quit();
+	}
+	rfboot();
+	return 0;
+}
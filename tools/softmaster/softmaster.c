@@ -0,0 +1,254 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       softmaster.c
+ * \brief      RFM12 master firmware as Linux process
+ *
+ * rfm-master and common sources are compiled unchanged for the host. This
+ * file replaces main.c: it initializes the same modules and runs the task
+ * loop, interrupts are replaced by poll() on the radio and daemon link plus
+ * a 1/100 s tick calling the timer ISR of common/rtc.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <getopt.h>
+
+#include "config.h"
+#include "master.h"
+#include "com.h"
+#include "task.h"
+#include "eeprom.h"
+#include "common/rtc.h"
+#include "common/cmac.h"
+#include "common/wireless.h"
+#include "rfm_config.h"
+#include "common/rfm.h"
+#include "radio.h"
+#include "link.h"
+
+#define SOFTMASTER_VERSION "0.1"
+
+void TIMER1_COMPA_vect(void);
+void EEPROM_host_init(const char *file);
+
+static struct option long_options[] =
+{
+	{ "radio",   required_argument, 0, 'r' },
+	{ "listen",  required_argument, 0, 'l' },
+	{ "pty",     required_argument, 0, 'p' },
+	{ "eeprom",  required_argument, 0, 'e' },
+	{ "verbose", no_argument,       0, 'v' },
+	{ "help",    no_argument,       0, 'h' },
+	{ 0,         0,                 0, 0   }
+};
+
+static void printUsage(void)
+{
+	printf("softmaster version %s\n", SOFTMASTER_VERSION);
+	printf("Options:\n\n");
+	printf(" -r, --radio BACKEND:ARG   radio backend (default sim:/tmp/openhr20-air)\n");
+	printf("                           sim:DIR              virtual RF medium in DIR\n");
+	printf("                           spidev:/dev/spidevB.C:GPIO  RFM12 on spidev, nIRQ on GPIO\n");
+	printf(" -l, --listen PORT         daemon connects by TCP to PORT\n");
+	printf(" -p, --pty LINK            create pseudo terminal, LINK points to it\n");
+	printf("                           default daemon link is stdin/stdout\n");
+	printf(" -e, --eeprom FILE         keep EEPROM image in FILE\n");
+	printf(" -v, --verbose             dump frames on air to stderr, twice: also SPI words\n");
+	printf(" -h, --help                this help\n\n");
+}
+
+/*!
+ *******************************************************************************
+ *  monotonic time in 1/100 s
+ ******************************************************************************/
+static long long now_s100(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 100 + ts.tv_nsec / 10000000;
+}
+
+/*!
+ *******************************************************************************
+ *  start with system time, daemon sets it again with Y/H commands
+ ******************************************************************************/
+static void init_clock(void)
+{
+	struct timespec ts;
+	struct tm tm;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	localtime_r(&ts.tv_sec, &tm);
+	RTC_SetDate(tm.tm_mday, tm.tm_mon + 1, tm.tm_year - 100);
+	RTC_SetHour(tm.tm_hour);
+	RTC_SetMinute(tm.tm_min);
+	RTC_SetSecond(tm.tm_sec);
+	RTC_SetSecond100(ts.tv_nsec / 10000000);
+}
+
+/*!
+ *******************************************************************************
+ *  deliver pending RFM interrupts and run tasks until nothing is pending
+ ******************************************************************************/
+static void run_tasks(void)
+{
+	int guard = 10000;
+
+	while (guard-- > 0)
+	{
+		if ((GICR & _BV(INT2)) && radio->irq())
+		{
+			RFM_INT_vect();
+			continue;
+		}
+		if (task)
+		{
+			MASTER_tasks();
+			continue;
+		}
+		return;
+	}
+	fprintf(stderr, "task loop does not settle (rfm_mode %d)\n", rfm_mode);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *radio_arg = "sim:/tmp/openhr20-air";
+	const char *listen_port = NULL;
+	const char *pty_link = NULL;
+	const char *eeprom_file = NULL;
+	long long next_tick;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "r:l:p:e:vh", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+		case 'r':
+			radio_arg = optarg;
+			break;
+		case 'l':
+			listen_port = optarg;
+			break;
+		case 'p':
+			pty_link = optarg;
+			break;
+		case 'e':
+			eeprom_file = optarg;
+			break;
+		case 'v':
+			radio_verbose++;
+			break;
+		case 'h':
+			printUsage();
+			exit(EXIT_SUCCESS);
+		default:
+			printUsage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (!strncmp(radio_arg, "sim:", 4))
+	{
+		radio = &radio_sim;
+	}
+	else if (!strncmp(radio_arg, "spidev:", 7))
+	{
+		radio = &radio_spidev;
+	}
+	else
+	{
+		fprintf(stderr, "unknown radio backend %s\n", radio_arg);
+		exit(EXIT_FAILURE);
+	}
+	if (radio->open(strchr(radio_arg, ':') + 1) != 0)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	if (listen_port != NULL)
+	{
+		c = link_open_listen(listen_port);
+	}
+	else if (pty_link != NULL)
+	{
+		c = link_open_pty(pty_link);
+	}
+	else
+	{
+		c = link_open_stdio();
+	}
+	if (c != 0)
+	{
+		exit(EXIT_FAILURE);
+	}
+
+	// same order as init() and main() of rfm-master/main.c
+	init_clock();
+	RTC_Init();
+	EEPROM_host_init(eeprom_file);
+	eeprom_config_init(false);
+	RFM_init();
+	RFM_OFF();
+	crypto_init();
+	RFM_FIFO_ON();
+	RFM_RX_ON();
+	rfm_mode = rfmmode_rx;
+	COM_init();
+	RFM_INT_EN();
+
+	next_tick = now_s100() + 1;
+	for (;; )
+	{
+		struct pollfd fds[4];
+		int n = 0;
+		long long now = now_s100();
+		int timeout = (next_tick > now) ? (int)(next_tick - now) * 10 : 0;
+
+		if (radio->fd() >= 0)
+		{
+			fds[n].fd = radio->fd();
+			fds[n].events = POLLIN | POLLPRI;
+			n++;
+		}
+		link_poll_fds(fds, &n);
+		if (poll(fds, n, timeout) > 0)
+		{
+			if ((radio->fd() >= 0) && (fds[0].revents & (POLLIN | POLLPRI)))
+			{
+				radio->event();
+			}
+			run_tasks();
+			link_event(fds, n);
+		}
+		for (now = now_s100(); next_tick <= now; next_tick++)
+		{
+			TIMER1_COMPA_vect();
+			run_tasks();
+		}
+	}
+}
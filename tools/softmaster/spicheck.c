@@ -0,0 +1,137 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       spicheck.c
+ * \brief      hardware SPI backend of common/rfm.c against a recorded trace
+ *
+ * The trace is the -vv output ("SPI ss.hh out in") of the soft master on the
+ * sim radio. Every word of it goes through rfm_spi16 of the RFM_HW_SPI=1
+ * build; the SPI unit of avr/io.h answers with the recorded bytes. Bytes
+ * clocked out, word returned, nSEL and SPI clock of each byte are checked:
+ * receiver FIFO reads below fref/4, other commands at F_CPU/2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "rfm_config.h"
+#include "common/rfm.h"
+
+#define FREF_4 2500000UL        //!< Hz, RFM12 FIFO read clock limit
+
+extern uint8_t (*host_spi)(uint8_t outval);
+
+static uint8_t miso[2];         //!< recorded answer of current word
+static uint8_t mosi[2];         //!< bytes clocked out for current word
+static unsigned long clk[2];    //!< SPI clock of each byte
+static int pos, errors;
+
+static uint8_t spi_byte(uint8_t outval)
+{
+	static const uint8_t div[4] = { 4, 16, 64, 128 };
+	uint8_t d = div[SPCR & (_BV(SPR1) | _BV(SPR0))];
+
+	if (pos > 1)
+	{
+		pos = 1; // more than 2 bytes, shows as mismatch
+		errors++;
+	}
+	if (SPSR & _BV(SPI2X))
+	{
+		d /= 2;
+	}
+	if ((SPCR & (_BV(SPE) | _BV(MSTR))) != (_BV(SPE) | _BV(MSTR)))
+	{
+		d = 0; // SPI unit off or slave
+	}
+	if (RFM_NSEL_PORT & _BV(RFM_NSEL_BITPOS))
+	{
+		d = 0; // RFM not selected
+	}
+	clk[pos] = d ? F_CPU / d : 0;
+	mosi[pos] = outval;
+	return miso[pos++];
+}
+
+int main(int argc, char *argv[])
+{
+	char line[128];
+	unsigned long fifo_clk = 0;
+	int words = 0, fifo = 0, n = 0;
+	FILE *f;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: spicheck <trace>\n");
+		return 2;
+	}
+	f = fopen(argv[1], "r");
+	if (f == NULL)
+	{
+		perror(argv[1]);
+		return 2;
+	}
+	host_spi = spi_byte;
+	RFM_SPI_CLK_FAST(); // as RFM_init
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		unsigned out, in;
+		uint16_t ret;
+		int slow;
+
+		n++;
+		if (sscanf(line, "SPI %*s %x %x", &out, &in) != 2)
+		{
+			continue;
+		}
+		miso[0] = in >> 8;
+		miso[1] = in & 0xff;
+		pos = 0;
+		ret = rfm_spi16(out);
+		slow = ((out & 0xff00) == 0xb000);
+		words++;
+		fifo += slow;
+		if ((pos != 2) || (mosi[0] != (out >> 8)) || (mosi[1] != (out & 0xff)) || (ret != in))
+		{
+			fprintf(stderr, "%s:%d: %04x %04x: clocked out %02x %02x, returned %04x\n", argv[1], n, out, in,
+				mosi[0], mosi[1], ret);
+			errors++;
+		}
+		if (slow ? ((clk[0] == 0) || (clk[0] >= FREF_4) || (clk[1] != clk[0])) :
+		    ((clk[0] != F_CPU / 2) || (clk[1] != F_CPU / 2)))
+		{
+			fprintf(stderr, "%s:%d: %04x at %lu/%lu Hz\n", argv[1], n, out, clk[0], clk[1]);
+			errors++;
+		}
+		if (slow)
+		{
+			fifo_clk = clk[0];
+		}
+	}
+	fclose(f);
+	printf("spicheck: %d words, %d FIFO reads at %lu Hz (F_CPU %lu): %s\n", words, fifo, fifo_clk,
+	       (unsigned long)F_CPU, errors ? "FAILED" : "OK");
+	return ((errors == 0) && (words > 0)) ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+/*
+ *  Open HR20 - soft master
+ *
+ *  target:     Linux host
+ *
+ *  copyright:  2026 OpenHR20 project
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       xtea.c
+ * \brief      C version of common/xtea-asm.S for the soft master
+ *
+ * Same algorithm as the reference xtea.c of Crypto-avr-lib, which the AVR
+ * assembler version fits byte for byte (little endian words).
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "common/xtea.h"
+
+void xtea_enc(void *dest, const void *v, const void *k)
+{
+	uint32_t v0, v1, key[4];
+	uint32_t sum = 0, delta = 0x9E3779B9;
+	uint8_t i;
+
+	memcpy(&v0, (const uint8_t *)v, 4);
+	memcpy(&v1, (const uint8_t *)v + 4, 4);
+	memcpy(key, k, 16);
+	for (i = 0; i < 32; i++)
+	{
+		v0 += ((v1 << 4 ^ v1 >> 5) + v1) ^ (sum + key[sum & 3]);
+		sum += delta;
+		v1 += ((v0 << 4 ^ v0 >> 5) + v0) ^ (sum + key[sum >> 11 & 3]);
+	}
+	memcpy(dest, &v0, 4);
+	memcpy((uint8_t *)dest + 4, &v1, 4);
+}
+
+void xtea_dec(void *dest, const void *v, const void *k)
+{
+	uint32_t v0, v1, key[4];
+	uint32_t sum = 0xC6EF3720, delta = 0x9E3779B9;
+	uint8_t i;
+
+	memcpy(&v0, (const uint8_t *)v, 4);
+	memcpy(&v1, (const uint8_t *)v + 4, 4);
+	memcpy(key, k, 16);
+	for (i = 0; i < 32; i++)
+	{
+		v1 -= ((v0 << 4 ^ v0 >> 5) + v0) ^ (sum + key[sum >> 11 & 3]);
+		sum -= delta;
+		v0 -= ((v1 << 4 ^ v1 >> 5) + v1) ^ (sum + key[sum & 3]);
+	}
+	memcpy(dest, &v0, 4);
+	memcpy((uint8_t *)dest + 4, &v1, 4);
+}